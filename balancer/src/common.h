@@ -1,12 +1,81 @@
 #pragma once
 
-#include <common/src/remote-server.h>
-#include <proto/src/init-message.h>
+#include "route-map/route-map.h"
+#include "route-map/route-map-holder.h"
+#include "routing-policy/routing-policy.h"
+#include "health/backend-health.h"
 
-#include <map>
+#include <proto/src/stream-parser.h>
+#include <common/src/timeouts.h>
+
+#include <chrono>
 
 namespace balancer {
 
-    using route_map = std::map<proto::init_message::client_id_t, common::remote_server>;
+    enum class forwarding_mode {
+        parse,      // every message is decoded and logged before forwarding
+        zero_copy   // only headers are validated, chains are moved to the server as is
+    };
+
+    enum class batch_mode {
+        forward,    // batch messages are sent to the server as is
+        unpack      // every payload of a batch is sent as a regular message
+    };
+
+    struct session_options {
+        forwarding_mode forwarding{forwarding_mode::parse};
+        batch_mode batches{batch_mode::forward};
+        // longer values of typed messages close the session
+        std::size_t max_value_length{proto::stream_parser::default_max_value_length};
+        // messages are kept in the client input buffer until the upstream
+        // connection is established, reading is paused above this size
+        std::size_t max_pending_bytes{1024 * 1024};
+        // a failed connect is retried after a jittered exponential backoff,
+        // on another backend of the group if one is available
+        std::uint32_t connect_retries{3};
+        std::chrono::milliseconds retry_delay{100};
+        std::chrono::milliseconds max_retry_delay{2000};
+        // streams of trusted clients are moved to dedicated uncompressed upstream
+        // connections by splice() without checking frames, other sessions and
+        // modes that need every frame (parse, batch unpacking) use evbuffers
+        bool splice_trusted{false};
+    };
+
+    struct upstream_options {
+        std::size_t pool_size{0};   // zero means dedicated connection per session
+        std::chrono::seconds idle_timeout{30};
+        // reading from clients is paused when output buffer of their upstream
+        // connection goes over high watermark and is resumed below low watermark,
+        // zero high watermark disables flow control
+        std::size_t high_watermark{4 * 1024 * 1024};
+        std::size_t low_watermark{1024 * 1024};
+        // passive failure detection, active checks and ejection of backends
+        health_options health;
+    };
+
+    enum class io_engine {
+        libevent,   // bufferevents on the event loop of every worker
+        uring       // io_uring with multishot accept and receive into provided buffers
+    };
+
+    struct uring_options {
+        // submission queue size of a worker ring
+        unsigned entries{4096};
+        // receive buffers shared by the sessions of a worker, a power of two
+        unsigned buffers{4096};
+        std::size_t buffer_size{16 * 1024};
+    };
+
+    struct balancer_options {
+        io_engine engine{io_engine::libevent};
+        uring_options uring;
+        session_options session;
+        upstream_options upstream;
+        routing_policy_type routing_policy{routing_policy_type::round_robin};
+        // handshake and idle apply to clients, connect and write to backends
+        common::timeouts timeouts;
+        // zero disables the metrics endpoint
+        std::uint16_t metrics_port{0};
+    };
 
 }
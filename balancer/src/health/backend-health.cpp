@@ -0,0 +1,95 @@
+#include "backend-health.h"
+
+#include <algorithm>
+
+namespace balancer {
+
+    const char *health_state_name(health_state state) noexcept
+    {
+        switch(state) {
+        case health_state::healthy:
+            return "healthy";
+        case health_state::ejected:
+            return "ejected";
+        case health_state::half_open:
+            return "half_open";
+        }
+        return "unknown";
+    }
+
+    bool backend_health::is_available(clock_t::time_point now) const noexcept
+    {
+        return health_state::healthy == state_.load(std::memory_order_acquire)
+                || now.time_since_epoch().count() >= until_.load(std::memory_order_relaxed);
+    }
+
+    void backend_health::on_routed(clock_t::time_point now) noexcept
+    {
+        auto state{state_.load(std::memory_order_acquire)};
+        if(health_state::healthy == state || now.time_since_epoch().count() < until_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        // a trial that did not report in time is replaced by this one
+        if(health_state::half_open == state
+                || state_.compare_exchange_strong(state, health_state::half_open, std::memory_order_acq_rel)) {
+            until_.store((now + clock_t::duration{ejection_time_.load(std::memory_order_relaxed)}).time_since_epoch().count(),
+                         std::memory_order_relaxed);
+        }
+    }
+
+    bool backend_health::on_success() noexcept
+    {
+        failures_.store(0, std::memory_order_relaxed);
+        if(health_state::healthy == state_.exchange(health_state::healthy, std::memory_order_acq_rel)) {
+            return false;
+        }
+        ejections_in_row_.store(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool backend_health::on_failure(clock_t::time_point now, const health_options &options) noexcept
+    {
+        if(0 == options.max_failures) {
+            return false;
+        }
+        const std::uint32_t failures{failures_.fetch_add(1, std::memory_order_relaxed) + 1};
+        const auto state{state_.load(std::memory_order_acquire)};
+        // failures of connections opened before an ejection do not prolong it
+        if(health_state::half_open == state || (health_state::healthy == state && failures >= options.max_failures)) {
+            eject(state, now, options);
+            return true;
+        }
+        return false;
+    }
+
+    void backend_health::eject(health_state from, clock_t::time_point now, const health_options &options) noexcept
+    {
+        const std::uint32_t in_row{std::min<std::uint32_t>(ejections_in_row_.load(std::memory_order_relaxed), 16)};
+        const auto ejection_time{std::min(options.base_ejection_time * (1 << in_row), options.max_ejection_time)};
+        const auto duration{std::chrono::duration_cast<clock_t::duration>(ejection_time)};
+        ejection_time_.store(duration.count(), std::memory_order_relaxed);
+        until_.store((now + duration).time_since_epoch().count(), std::memory_order_relaxed);
+        if(state_.compare_exchange_strong(from, health_state::ejected, std::memory_order_acq_rel)) {
+            ejections_in_row_.fetch_add(1, std::memory_order_relaxed);
+            ejections_.fetch_add(1, std::memory_order_relaxed);
+        }
+        failures_.store(0, std::memory_order_relaxed);
+    }
+
+    health_state backend_health::state() const noexcept
+    {
+        return state_.load(std::memory_order_acquire);
+    }
+
+    std::uint64_t backend_health::ejections() const noexcept
+    {
+        return ejections_.load(std::memory_order_relaxed);
+    }
+
+    std::chrono::milliseconds backend_health::ejection_time() const noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                    clock_t::duration{ejection_time_.load(std::memory_order_relaxed)});
+    }
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace balancer {
+
+    struct health_options {
+        // consecutive failed connects or connections closed by a backend
+        // that eject it, 0 - backends are never ejected
+        std::uint32_t max_failures{3};
+        // the first ejection in a row, every next one is twice as long
+        std::chrono::milliseconds base_ejection_time{5000};
+        std::chrono::milliseconds max_ejection_time{300000};
+        // active probes connect to every backend of the route map, 0 - disabled
+        std::chrono::milliseconds check_interval{5000};
+        std::chrono::milliseconds check_timeout{2000};
+    };
+
+    enum class health_state : std::uint32_t {
+        healthy,    // closed circuit, sessions are routed to the backend
+        ejected,    // open circuit, sessions are not routed until the ejection is over
+        half_open   // the next connection is a trial that decides the state
+    };
+
+    const char *health_state_name(health_state state) noexcept;
+
+    /*
+     * Circuit breaker of a backend, shared by all workers without locking.
+     * Consecutive failures eject the backend for a time that doubles with every
+     * ejection in a row. When it is over, the backend is half-open: one session
+     * is routed to it and the result of its connection either closes the circuit
+     * or ejects the backend again. Active probes report to the same breaker,
+     * a successful probe closes the circuit at once.
+     * Races between workers can let a second trial through, it is harmless.
+     */
+    class backend_health {
+        using clock_t = std::chrono::steady_clock;
+
+    public:
+        // true if a session can be routed to the backend now
+        bool is_available(clock_t::time_point now) const noexcept;
+        // the backend is chosen for a session, starts a trial when the ejection is over
+        void on_routed(clock_t::time_point now) noexcept;
+        // Both return true if the state of the backend has changed
+        bool on_success() noexcept;
+        bool on_failure(clock_t::time_point now, const health_options &options) noexcept;
+
+        health_state state() const noexcept;
+        std::uint64_t ejections() const noexcept;
+        // duration of the current or the last ejection
+        std::chrono::milliseconds ejection_time() const noexcept;
+
+    private:
+        void eject(health_state from, clock_t::time_point now, const health_options &options) noexcept;
+
+    private:
+        std::atomic<health_state> state_{health_state::healthy};
+        std::atomic<std::uint32_t> failures_{0};
+        std::atomic<std::uint32_t> ejections_in_row_{0};
+        std::atomic<std::uint64_t> ejections_{0};
+        std::atomic<clock_t::rep> ejection_time_{0};
+        // the end of the ejection or the deadline of the trial
+        std::atomic<clock_t::rep> until_{0};
+    };
+
+}
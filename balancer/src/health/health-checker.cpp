@@ -0,0 +1,141 @@
+#include "health-checker.h"
+#include <common/src/utils.h>
+
+#include <stdexcept>
+#include <log4cplus/loggingmacros.h>
+
+namespace balancer {
+
+    health_checker::health_checker(event_base *base,
+                                   const route_map_holder &route_map,
+                                   const health_options &options,
+                                   const common::common_timeouts &timeouts,
+                                   common::async_resolver &resolver)
+        : base_{base}
+        , route_map_{route_map}
+        , options_{options}
+        , timeouts_{timeouts}
+        , resolver_{resolver}
+        , logger_{common::make_logger("health_checker")}
+    { }
+
+    health_checker::~health_checker()
+    {
+        stop();
+    }
+
+    void health_checker::start()
+    {
+        const auto on_timer = [](evutil_socket_t /*fd*/, short /*what*/, void *ctx)
+        {
+            auto *self{static_cast<health_checker *>(ctx)};
+            self->run_checks();
+        };
+        timer_ = common::event_ptr(event_new(base_, -1, EV_PERSIST, on_timer, this));
+        if(!timer_ || -1 == evtimer_add(timer_.get(), timeouts_.get(options_.check_interval))) {
+            timer_.reset();
+            throw std::runtime_error{"Can not start health check timer"};
+        }
+        LOG4CPLUS_INFO(logger_, "Backends are checked every " << options_.check_interval.count() << " ms");
+    }
+
+    void health_checker::stop()
+    {
+        timer_.reset();
+        for(auto &probe : probes_) {
+            if(0 != probe.second->resolve_request) {
+                resolver_.cancel(probe.second->resolve_request);
+            }
+        }
+        probes_.clear();
+    }
+
+    void health_checker::run_checks()
+    {
+        // the snapshot keeps backends of a reloaded map alive until the checks are started
+        const auto route_map{route_map_.load()};
+        for(const auto &backend : route_map->backends()) {
+            if(0 == probes_.count(backend.second.get())) {
+                start_probe(backend.second);
+            }
+        }
+    }
+
+    void health_checker::start_probe(const backend_ptr &backend)
+    {
+        auto new_probe{std::make_unique<probe>()};
+        new_probe->checker = this;
+        new_probe->backend = backend;
+        new_probe->buffer = common::bufferevent_ptr(bufferevent_socket_new(base_, -1, BEV_OPT_CLOSE_ON_FREE));
+        if(!new_probe->buffer) {
+            LOG4CPLUS_ERROR(logger_, "Can not create probe bufferevent for server " << backend->server());
+            return;
+        }
+        auto &probe{*probes_.emplace(backend.get(), std::move(new_probe)).first->second};
+        auto *buff{probe.buffer.get()};
+        bufferevent_setcb(buff, nullptr, nullptr, health_checker::on_probe_event_cb, &probe);
+        // the write timeout of a connecting bufferevent limits the connect
+        if(-1 == bufferevent_enable(buff, EV_WRITE)
+                || -1 == bufferevent_set_timeouts(buff, nullptr, timeouts_.get(options_.check_timeout))) {
+            LOG4CPLUS_ERROR(logger_, "Can not prepare probe of server " << backend->server());
+            probes_.erase(backend.get());
+            return;
+        }
+
+        const auto *address{backend->address()};
+        if(nullptr != address) {
+            connect_probe(probe, *address);
+            return;
+        }
+        sockaddr_in sock;
+        const auto on_resolved{[&probe](int error, const sockaddr_in &sock) {
+            probe.resolve_request = 0;
+            if(0 != error) {
+                LOG4CPLUS_ERROR(probe.checker->logger_, "Can not resolve server " << probe.backend->server()
+                                << ", error: " << common::async_resolver::error_message(error));
+                probe.checker->finish_probe(probe, false);
+                return;
+            }
+            probe.checker->connect_probe(probe, sock);
+        }};
+        try {
+            if(resolver_.resolve(backend->server(), sock, on_resolved, probe.resolve_request)) {
+                connect_probe(probe, sock);
+            }
+        } catch (const std::exception &ex) {
+            // the probe is started from a timer callback, nothing above can handle it
+            LOG4CPLUS_ERROR(logger_, ex.what());
+            finish_probe(probe, false);
+        }
+    }
+
+    void health_checker::connect_probe(probe &probe, const sockaddr_in &sock)
+    {
+        // a refused connect is reported by the event callback, -1 means the probe was not started
+        if(-1 == bufferevent_socket_connect(probe.buffer.get(), reinterpret_cast<const sockaddr *>(&sock), sizeof(sock))) {
+            finish_probe(probe, false);
+        }
+    }
+
+    void health_checker::finish_probe(probe &probe, bool success)
+    {
+        const auto &backend{probe.backend};
+        auto &health{backend->health()};
+        if(success) {
+            if(health.on_success()) {
+                LOG4CPLUS_INFO(logger_, "Server " << backend->server() << " is healthy again");
+            }
+        } else if(health.on_failure(std::chrono::steady_clock::now(), options_)) {
+            LOG4CPLUS_ERROR(logger_, "Server " << backend->server() << " failed health check and is ejected for "
+                            << health.ejection_time().count() << " ms");
+        }
+        probes_.erase(backend.get());
+    }
+
+    void health_checker::on_probe_event_cb(bufferevent */*bev*/, short what, void *ctx)
+    {
+        auto *probe{static_cast<health_checker::probe *>(ctx)};
+        probe->checker->finish_probe(*probe, 0 != (what & BEV_EVENT_CONNECTED));
+    }
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "backend-health.h"
+#include "../route-map/route-map-holder.h"
+#include <common/src/types.h>
+#include <common/src/timeouts.h>
+#include <common/src/async-resolver.h>
+
+#include <map>
+#include <memory>
+
+namespace balancer {
+
+    /*
+     * Active health checks: every check interval a probe connection is opened
+     * to every backend of the current route map and closed as soon as it is
+     * established. Results go to the circuit breakers of the backends, so an
+     * ejected backend comes back after the first successful probe and a dead
+     * backend without traffic is ejected before sessions are routed to it.
+     * It is served by an event loop of a worker, like the metrics endpoint.
+     */
+    class health_checker {
+    public:
+        health_checker(event_base *base,
+                       const route_map_holder &route_map,
+                       const health_options &options,
+                       const common::common_timeouts &timeouts,
+                       common::async_resolver &resolver);
+        ~health_checker();
+
+    public:
+        void start();
+        void stop();
+
+    private:
+        struct probe {
+            health_checker *checker;
+            backend_ptr backend;
+            common::bufferevent_ptr buffer;
+            common::async_resolver::request_id_t resolve_request{0};
+        };
+
+    private:
+        void run_checks();
+        void start_probe(const backend_ptr &backend);
+        void connect_probe(probe &probe, const sockaddr_in &sock);
+        // frees the probe, must be the last call on it
+        void finish_probe(probe &probe, bool success);
+        static void on_probe_event_cb(bufferevent */*bev*/, short what, void *ctx);
+
+    private:
+        event_base *base_;
+        const route_map_holder &route_map_;
+        const health_options &options_;
+        const common::common_timeouts &timeouts_;
+        common::async_resolver &resolver_;
+        common::event_ptr timer_;
+        // one probe at a time per backend, a slow backend is not probed again until it answers
+        std::map<const backend *, std::unique_ptr<probe>> probes_;
+        log4cplus::Logger logger_;
+    };
+
+}
@@ -1,12 +1,17 @@
 #include "common.h"
-#include "tcp-server/tcp-server.h"
+#include "worker-pool/worker-pool.h"
+#include "route-map/route-map-reloader.h"
 
+#include <common/src/async-appender.h>
+#include <common/src/log-sampler.h>
+#include <common/src/utils.h>
+
+#include <algorithm>
 #include <stdexcept>
-#include <sstream>
 #include <signal.h>
-#include <fstream>
 #include <iostream>
 #include <boost/program_options.hpp>
+#include <log4cplus/loggingmacros.h>
 
 boost::program_options::variables_map parse_command_line(int argc, const char* const *argv)
 {
@@ -17,7 +22,67 @@ boost::program_options::variables_map parse_command_line(int argc, const char* c
     try {
         desc.add_options()
         ("help,h", "Help message")
-        ("route_map,r", po::value<std::string>()->default_value("./route-map.txt"), "File with route map");
+        ("route_map,r", po::value<std::string>()->default_value("./route-map.txt"), "File with route map")
+        ("route_map_check_interval", po::value<std::uint32_t>()->default_value(5),
+         "Seconds between checks of route map file changes, 0 - reload on SIGHUP only")
+        ("threads,t", po::value<std::size_t>()->default_value(1), "Worker threads count")
+        ("io_engine", po::value<std::string>()->default_value("libevent"),
+         "I/O engine of workers: libevent or uring")
+        ("uring_entries", po::value<unsigned>()->default_value(4096),
+         "Submission queue entries of an io_uring worker")
+        ("uring_buffers", po::value<unsigned>()->default_value(4096),
+         "Provided receive buffers of an io_uring worker, a power of two up to 32768")
+        ("uring_buffer_size", po::value<std::size_t>()->default_value(16 * 1024),
+         "Bytes of a provided receive buffer")
+        ("forwarding_mode,f", po::value<std::string>()->default_value("parse"), "Forwarding mode: parse or zero_copy")
+        ("routing_policy,p", po::value<std::string>()->default_value("round_robin"),
+         "Backend choice: round_robin, least_outstanding, ewma_latency or power_of_two")
+        ("upstream_pool_size", po::value<std::size_t>()->default_value(0),
+         "Persistent connections per backend, 0 - dedicated connection per session")
+        ("upstream_idle_timeout", po::value<std::uint32_t>()->default_value(30),
+         "Seconds before unused pooled connection is closed")
+        ("handshake_timeout_ms", po::value<std::uint32_t>()->default_value(10000),
+         "Milliseconds for a client to send its init message, 0 - no limit")
+        ("idle_timeout_ms", po::value<std::uint32_t>()->default_value(300000),
+         "Milliseconds a client may send nothing before its session is closed, 0 - no limit")
+        ("connect_timeout_ms", po::value<std::uint32_t>()->default_value(5000),
+         "Milliseconds to establish a backend connection, 0 - no limit")
+        ("write_timeout_ms", po::value<std::uint32_t>()->default_value(30000),
+         "Milliseconds a backend may take no queued data before its connection is closed, 0 - no limit")
+        ("dns_ttl", po::value<std::uint32_t>()->default_value(60), "Seconds to keep resolved backend addresses")
+        ("splice", po::bool_switch(),
+         "Forward streams of trusted clients with splice() without checking their frames")
+        ("max_pending_bytes", po::value<std::size_t>()->default_value(1024 * 1024),
+         "Bytes read from a client while its backend connection is established, 0 - no limit")
+        ("connect_retries", po::value<std::uint32_t>()->default_value(3),
+         "Retries of a failed backend connect before the session is closed")
+        ("retry_delay_ms", po::value<std::uint32_t>()->default_value(100),
+         "Milliseconds before the first connect retry, doubled for every next one and jittered")
+        ("max_retry_delay_ms", po::value<std::uint32_t>()->default_value(2000),
+         "Max milliseconds between connect retries")
+        ("max_failures", po::value<std::uint32_t>()->default_value(3),
+         "Consecutive failed connects or broken connections that eject a backend, 0 - never eject")
+        ("ejection_time_ms", po::value<std::uint32_t>()->default_value(5000),
+         "Milliseconds of the first ejection of a backend, doubled for every next ejection in a row")
+        ("max_ejection_time_ms", po::value<std::uint32_t>()->default_value(300000),
+         "Max milliseconds a backend stays ejected")
+        ("health_check_interval_ms", po::value<std::uint32_t>()->default_value(5000),
+         "Milliseconds between active health checks of backends, 0 - disabled")
+        ("health_check_timeout_ms", po::value<std::uint32_t>()->default_value(2000),
+         "Milliseconds to connect to a backend during a health check")
+        ("upstream_high_watermark", po::value<std::size_t>()->default_value(4 * 1024 * 1024),
+         "Bytes queued for a backend connection before reading from its clients is paused, 0 - no limit")
+        ("upstream_low_watermark", po::value<std::size_t>()->default_value(1024 * 1024),
+         "Bytes queued for a backend connection below which reading from its clients is resumed")
+        ("batch_mode", po::value<std::string>()->default_value("forward"),
+         "Batch messages handling: forward as is or unpack to regular messages")
+        ("max_value_length", po::value<std::size_t>()->default_value(proto::stream_parser::default_max_value_length),
+         "Max length of a typed message value, longer messages close the session")
+        ("message_log_rate", po::value<std::uint32_t>()->default_value(100),
+         "Max per-message log records per second and worker thread, 0 - no limit")
+        ("message_log_sample", po::value<std::uint32_t>()->default_value(1), "Log one of every N messages")
+        ("metrics_port", po::value<std::uint16_t>()->default_value(8889),
+         "Port of the Prometheus metrics endpoint on 127.0.0.1, 0 - disabled");
         po::store(po::parse_command_line(argc, argv, desc), vm);
         po::notify(vm);
     } catch (const po::required_option &ex) {
@@ -30,42 +95,135 @@ boost::program_options::variables_map parse_command_line(int argc, const char* c
     return vm;
 }
 
-balancer::route_map read_route_map(const std::string &file_path)
+balancer::forwarding_mode read_forwarding_mode(const std::string &mode)
 {
-    balancer::route_map route_map;
-    std::ifstream in_file{file_path};
-    if(in_file) {
-        std::cout << "Route map:" << std::endl;
-        std::string line;
-        while(std::getline(in_file, line)) {
-            std::cout << line << std::endl;
-            std::stringstream stream{line};
-            std::uint32_t client_id; std::string host; std::uint16_t port;
-            stream >> client_id >> host >> port;
-            route_map.emplace(std::make_pair(client_id, common::remote_server{host, port}));
-        }
+    if("parse" == mode) {
+        return balancer::forwarding_mode::parse;
+    }
+    if("zero_copy" == mode) {
+        return balancer::forwarding_mode::zero_copy;
+    }
+    throw std::invalid_argument{"Unknown forwarding mode: " + mode};
+}
+
+balancer::batch_mode read_batch_mode(const std::string &mode)
+{
+    if("forward" == mode) {
+        return balancer::batch_mode::forward;
     }
-    return route_map;
+    if("unpack" == mode) {
+        return balancer::batch_mode::unpack;
+    }
+    throw std::invalid_argument{"Unknown batch mode: " + mode};
+}
+
+balancer::io_engine read_io_engine(const std::string &engine)
+{
+    if("libevent" == engine) {
+        return balancer::io_engine::libevent;
+    }
+    if("uring" == engine) {
+        return balancer::io_engine::uring;
+    }
+    throw std::invalid_argument{"Unknown I/O engine: " + engine};
+}
+
+balancer::routing_policy_type read_routing_policy(const std::string &policy)
+{
+    if("round_robin" == policy) {
+        return balancer::routing_policy_type::round_robin;
+    }
+    if("least_outstanding" == policy) {
+        return balancer::routing_policy_type::least_outstanding;
+    }
+    if("ewma_latency" == policy) {
+        return balancer::routing_policy_type::ewma_latency;
+    }
+    if("power_of_two" == policy) {
+        return balancer::routing_policy_type::power_of_two;
+    }
+    throw std::invalid_argument{"Unknown routing policy: " + policy};
 }
 
 int main(int argc, char **argv)
 {
     signal(SIGPIPE, SIG_IGN);
+    balancer::route_map_reloader::block_reload_signal();
+    const common::async_logging logging;
     try {
         const auto params{parse_command_line(argc, argv)};
         if(params.count("help")) {
             return 0;
         }
 
+        common::log_limits message_log_limits;
+        message_log_limits.max_per_second = params["message_log_rate"].as<std::uint32_t>();
+        message_log_limits.sample_every = std::max<std::uint32_t>(params["message_log_sample"].as<std::uint32_t>(), 1);
+        common::set_log_limits(common::log_category::message, message_log_limits);
+
         const std::string route_map_file_path{params["route_map"].as<std::string>()};
-        const auto route_map{read_route_map(route_map_file_path)};
-        if(route_map.empty()) {
+        const auto route_map{std::make_shared<const balancer::route_map>(balancer::read_route_map(route_map_file_path))};
+        if(route_map->empty()) {
             throw std::invalid_argument{"Empty route map"};
         }
+        LOG4CPLUS_INFO(common::make_logger("balancer"), "Route map: " << route_map->routes_count() << " route(s) to "
+                       << route_map->backends_count() << " backend(s)");
+        balancer::route_map_holder route_map_holder{route_map};
+        const std::chrono::seconds check_interval{params["route_map_check_interval"].as<std::uint32_t>()};
+        balancer::route_map_reloader reloader{route_map_file_path, route_map_holder, check_interval};
+        reloader.start();
+
+        balancer::balancer_options options;
+        options.session.forwarding = read_forwarding_mode(params["forwarding_mode"].as<std::string>());
+        options.session.batches = read_batch_mode(params["batch_mode"].as<std::string>());
+        options.session.max_value_length = params["max_value_length"].as<std::size_t>();
+        options.session.max_pending_bytes = params["max_pending_bytes"].as<std::size_t>();
+        options.session.splice_trusted = params["splice"].as<bool>();
+        options.session.connect_retries = params["connect_retries"].as<std::uint32_t>();
+        options.session.retry_delay = std::chrono::milliseconds{params["retry_delay_ms"].as<std::uint32_t>()};
+        options.session.max_retry_delay = std::chrono::milliseconds{params["max_retry_delay_ms"].as<std::uint32_t>()};
+        options.routing_policy = read_routing_policy(params["routing_policy"].as<std::string>());
+        options.metrics_port = params["metrics_port"].as<std::uint16_t>();
+        options.upstream.pool_size = params["upstream_pool_size"].as<std::size_t>();
+        options.upstream.idle_timeout = std::chrono::seconds{params["upstream_idle_timeout"].as<std::uint32_t>()};
+        options.upstream.high_watermark = params["upstream_high_watermark"].as<std::size_t>();
+        options.upstream.low_watermark = params["upstream_low_watermark"].as<std::size_t>();
+        if(0 != options.upstream.high_watermark && options.upstream.low_watermark >= options.upstream.high_watermark) {
+            throw std::invalid_argument{"Upstream low watermark must be less than high watermark"};
+        }
+        options.timeouts.handshake = std::chrono::milliseconds{params["handshake_timeout_ms"].as<std::uint32_t>()};
+        options.timeouts.idle = std::chrono::milliseconds{params["idle_timeout_ms"].as<std::uint32_t>()};
+        options.timeouts.connect = std::chrono::milliseconds{params["connect_timeout_ms"].as<std::uint32_t>()};
+        options.timeouts.write = std::chrono::milliseconds{params["write_timeout_ms"].as<std::uint32_t>()};
+        auto &health{options.upstream.health};
+        health.max_failures = params["max_failures"].as<std::uint32_t>();
+        health.base_ejection_time = std::chrono::milliseconds{params["ejection_time_ms"].as<std::uint32_t>()};
+        health.max_ejection_time = std::chrono::milliseconds{params["max_ejection_time_ms"].as<std::uint32_t>()};
+        health.check_interval = std::chrono::milliseconds{params["health_check_interval_ms"].as<std::uint32_t>()};
+        health.check_timeout = std::chrono::milliseconds{params["health_check_timeout_ms"].as<std::uint32_t>()};
+        if(health.max_ejection_time < health.base_ejection_time) {
+            throw std::invalid_argument{"Max ejection time must not be less than ejection time"};
+        }
+
+        options.engine = read_io_engine(params["io_engine"].as<std::string>());
+        options.uring.entries = params["uring_entries"].as<unsigned>();
+        options.uring.buffers = params["uring_buffers"].as<unsigned>();
+        options.uring.buffer_size = params["uring_buffer_size"].as<std::size_t>();
+        if(balancer::io_engine::uring == options.engine
+                && (0 != options.upstream.pool_size
+                    || balancer::batch_mode::forward != options.session.batches
+                    || options.session.splice_trusted)) {
+            throw std::invalid_argument{"io_uring engine supports dedicated upstream connections "
+                                        "and forwarded batches only, without splice"};
+        }
+
+        common::dns_cache dns_cache{std::chrono::seconds{params["dns_ttl"].as<std::uint32_t>()}};
 
-        balancer::tcp_server server{8888, route_map};
+        const std::size_t threads_count{params["threads"].as<std::size_t>()};
+        balancer::worker_pool server{threads_count, 8888, route_map_holder, options, dns_cache};
         server.start();
         server.stop();
+        reloader.stop();
     } catch (const std::exception &ex) {
         std::cerr << "Server failed with error: " << ex.what() << std::endl;
     } catch (...) {
@@ -0,0 +1,229 @@
+#include "metrics-collector.h"
+#include "metrics-writer.h"
+
+#include <map>
+#include <sstream>
+
+namespace {
+
+    using namespace balancer;
+
+    struct client_totals {
+        std::uint64_t frames_in{0};
+        std::uint64_t bytes_in{0};
+        std::uint64_t frames_out{0};
+        std::uint64_t bytes_out{0};
+
+        void add(const client_stats &stats) noexcept
+        {
+            frames_in += stats.frames_in.load(std::memory_order_relaxed);
+            bytes_in += stats.bytes_in.load(std::memory_order_relaxed);
+            frames_out += stats.frames_out.load(std::memory_order_relaxed);
+            bytes_out += stats.bytes_out.load(std::memory_order_relaxed);
+        }
+    };
+
+    struct backend_totals {
+        std::uint64_t frames_out{0};
+        std::uint64_t bytes_out{0};
+        std::uint64_t sent_bytes{0};
+
+        void add(const backend_traffic &traffic) noexcept
+        {
+            frames_out += traffic.frames_out.load(std::memory_order_relaxed);
+            bytes_out += traffic.bytes_out.load(std::memory_order_relaxed);
+            sent_bytes += traffic.sent_bytes.load(std::memory_order_relaxed);
+        }
+    };
+
+    template<typename value_op_t>
+    std::uint64_t sum_up(const std::vector<const worker_stats *> &workers, const value_op_t &value_op)
+    {
+        std::uint64_t sum{0};
+        for(const auto *worker : workers) {
+            sum += value_op(*worker);
+        }
+        return sum;
+    }
+
+    void write_sessions(metrics_writer &writer, const std::vector<const worker_stats *> &workers)
+    {
+        writer.family("balancer_sessions_accepted_total", "counter", "Accepted client connections");
+        writer.sample("balancer_sessions_accepted_total", "", sum_up(workers, [](const worker_stats &stats) {
+            return stats.sessions_accepted.load(std::memory_order_relaxed);
+        }));
+
+        std::int64_t active_sessions{0};
+        for(const auto *worker : workers) {
+            active_sessions += worker->active_sessions.load(std::memory_order_relaxed);
+        }
+        writer.family("balancer_sessions_active", "gauge", "Open client sessions");
+        writer.sample("balancer_sessions_active", "", active_sessions);
+
+        writer.family("balancer_sessions_closed_total", "counter", "Closed client sessions by reason");
+        for(std::size_t reason_idx = 0; reason_idx < static_cast<std::size_t>(close_reason::count); ++reason_idx) {
+            const auto reason{static_cast<close_reason>(reason_idx)};
+            writer.sample("balancer_sessions_closed_total",
+                          std::string{"reason=\""} + close_reason_name(reason) + "\"",
+                          sum_up(workers, [reason_idx](const worker_stats &stats) {
+                              return stats.sessions_closed[reason_idx].load(std::memory_order_relaxed);
+                          }));
+        }
+
+        writer.family("balancer_session_pauses_total", "counter", "Times reading from a client was paused by its upstream");
+        writer.sample("balancer_session_pauses_total", "", sum_up(workers, [](const worker_stats &stats) {
+            return stats.session_pauses.load(std::memory_order_relaxed);
+        }));
+    }
+
+    void write_clients(metrics_writer &writer, const std::vector<const worker_stats *> &workers)
+    {
+        // sessions of one client can be served by several workers
+        std::map<std::uint32_t, client_totals> clients;
+        client_totals overflow;
+        for(const auto *worker : workers) {
+            worker->clients.for_each([&clients](std::uint32_t client_id, const client_stats &stats) {
+                clients[client_id].add(stats);
+            });
+            overflow.add(worker->clients.overflow());
+        }
+
+        const auto write_family{[&writer, &clients, &overflow](const std::string &name, const std::string &help,
+                                                                std::uint64_t client_totals::*value) {
+            writer.family(name, "counter", help);
+            for(const auto &client : clients) {
+                writer.sample(name, "client_id=\"" + std::to_string(client.first) + "\"", client.second.*value);
+            }
+            if(0 != overflow.frames_in) {
+                writer.sample(name, "client_id=\"other\"", overflow.*value);
+            }
+        }};
+        write_family("balancer_client_frames_in_total", "Frames received from a client", &client_totals::frames_in);
+        write_family("balancer_client_bytes_in_total", "Frame bytes received from a client", &client_totals::bytes_in);
+        write_family("balancer_client_frames_out_total", "Frames of a client forwarded to backends", &client_totals::frames_out);
+        write_family("balancer_client_bytes_out_total", "Frame bytes of a client forwarded to backends", &client_totals::bytes_out);
+    }
+
+    void write_backends(metrics_writer &writer, const std::vector<const worker_stats *> &workers,
+                        const route_map &route_map)
+    {
+        std::vector<std::pair<std::string, const backend *>> backends;
+        for(const auto &backend : route_map.backends()) {
+            std::ostringstream server;
+            server << backend.first;
+            backends.emplace_back("backend=\"" + metrics_writer::escape(server.str()) + "\"", backend.second.get());
+        }
+
+        // every worker counts its own traffic to a backend
+        std::map<std::uint64_t, backend_totals> traffic;
+        backend_totals overflow;
+        for(const auto *worker : workers) {
+            worker->backends.for_each([&traffic](std::uint64_t backend_id, const backend_traffic &backend_traffic) {
+                traffic[backend_id].add(backend_traffic);
+            });
+            overflow.add(worker->backends.overflow());
+        }
+        const auto write_traffic_family{[&writer, &backends, &traffic, &overflow](const std::string &name,
+                                                                                   const std::string &help,
+                                                                                   std::uint64_t backend_totals::*value) {
+            writer.family(name, "counter", help);
+            for(const auto &backend : backends) {
+                const auto traffic_it{traffic.find(backend.second->id())};
+                writer.sample(name, backend.first, traffic.cend() == traffic_it ? 0 : traffic_it->second.*value);
+            }
+            // backends beyond the worker tables, including gone ones
+            if(0 != overflow.bytes_out) {
+                writer.sample(name, "backend=\"other\"", overflow.*value);
+            }
+        }};
+
+        const auto write_family{[&writer, &backends](const std::string &name, const char *type, const std::string &help,
+                                                      const auto &value_op) {
+            writer.family(name, type, help);
+            for(const auto &backend : backends) {
+                writer.sample(name, backend.first, value_op(backend.second->stats()));
+            }
+        }};
+        const auto write_health_family{[&writer, &backends](const std::string &name, const char *type,
+                                                             const std::string &help, const auto &value_op) {
+            writer.family(name, type, help);
+            for(const auto &backend : backends) {
+                writer.sample(name, backend.first, value_op(backend.second->health()));
+            }
+        }};
+        write_traffic_family("balancer_backend_frames_out_total", "Frames forwarded to a backend",
+                             &backend_totals::frames_out);
+        write_traffic_family("balancer_backend_bytes_out_total", "Frame bytes forwarded to a backend",
+                             &backend_totals::bytes_out);
+        write_traffic_family("balancer_backend_sent_bytes_total", "Bytes written to backend sockets, compressed if enabled",
+                             &backend_totals::sent_bytes);
+        write_family("balancer_backend_queued_bytes", "gauge", "Bytes waiting in output buffers of a backend",
+                     [](const backend_stats &stats) { return stats.queued_bytes.load(std::memory_order_relaxed); });
+        write_family("balancer_backend_active_sessions", "gauge", "Sessions routed to a backend",
+                     [](const backend_stats &stats) {
+                         return static_cast<std::int64_t>(stats.active_sessions.load(std::memory_order_relaxed));
+                     });
+        write_family("balancer_backend_connect_latency_microseconds", "gauge", "Average time to connect to a backend",
+                     [](const backend_stats &stats) { return stats.connect_latency_us.load(std::memory_order_relaxed); });
+        write_health_family("balancer_backend_healthy", "gauge", "1 if sessions are routed to a backend, 0 if it is ejected",
+                            [](const backend_health &health) {
+                                return static_cast<std::uint64_t>(health_state::healthy == health.state());
+                            });
+        write_health_family("balancer_backend_ejections_total", "counter", "Times a backend was ejected after failures",
+                            [](const backend_health &health) { return health.ejections(); });
+    }
+
+    void write_upstreams(metrics_writer &writer, const std::vector<const worker_stats *> &workers)
+    {
+        writer.family("balancer_upstream_throttles_total", "counter", "Times an upstream connection went over high watermark");
+        writer.sample("balancer_upstream_throttles_total", "", sum_up(workers, [](const worker_stats &stats) {
+            return stats.upstream_throttles.load(std::memory_order_relaxed);
+        }));
+
+        writer.family("balancer_upstream_timeouts_total", "counter", "Upstream connections closed by connect or write timeout");
+        writer.sample("balancer_upstream_timeouts_total", "", sum_up(workers, [](const worker_stats &stats) {
+            return stats.upstream_timeouts.load(std::memory_order_relaxed);
+        }));
+
+        writer.family("balancer_upstream_connect_retries_total", "counter", "Failed upstream connects retried by sessions");
+        writer.sample("balancer_upstream_connect_retries_total", "", sum_up(workers, [](const worker_stats &stats) {
+            return stats.connect_retries.load(std::memory_order_relaxed);
+        }));
+
+        writer.family("balancer_uring_enters_total", "counter", "io_uring_enter calls of the io_uring engine");
+        writer.sample("balancer_uring_enters_total", "", sum_up(workers, [](const worker_stats &stats) {
+            return stats.uring_enters.load(std::memory_order_relaxed);
+        }));
+
+        writer.family("balancer_uring_completions_total", "counter", "Completions reaped by the io_uring engine");
+        writer.sample("balancer_uring_completions_total", "", sum_up(workers, [](const worker_stats &stats) {
+            return stats.uring_completions.load(std::memory_order_relaxed);
+        }));
+
+        std::vector<const histogram *> connect_latencies;
+        std::vector<const histogram *> queue_lengths;
+        for(const auto *worker : workers) {
+            connect_latencies.push_back(&worker->connect_latency_us);
+            queue_lengths.push_back(&worker->upstream_queue_bytes);
+        }
+        writer.histograms("balancer_upstream_connect_latency_microseconds",
+                          "Time to establish an upstream connection", connect_latencies);
+        writer.histograms("balancer_upstream_queue_bytes",
+                          "Output buffer length of an upstream connection after a write", queue_lengths);
+    }
+
+}
+
+namespace balancer {
+
+    std::string collect_metrics(const std::vector<const worker_stats *> &workers, const route_map &route_map)
+    {
+        metrics_writer writer;
+        write_sessions(writer, workers);
+        write_clients(writer, workers);
+        write_backends(writer, workers, route_map);
+        write_upstreams(writer, workers);
+        return writer.str();
+    }
+
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "../stats/worker-stats.h"
+#include "../route-map/route-map.h"
+
+#include <string>
+#include <vector>
+
+namespace balancer {
+
+    // Sums up counters of all workers and backends of the route map
+    // into the Prometheus text format, can be called from any thread
+    std::string collect_metrics(const std::vector<const worker_stats *> &workers, const route_map &route_map);
+
+}
@@ -0,0 +1,56 @@
+#include "metrics-server.h"
+
+#include <stdexcept>
+#include <log4cplus/loggingmacros.h>
+
+namespace balancer {
+
+    metrics_server::metrics_server(event_base *base, std::uint16_t port, collect_op_t collect_op)
+        : base_{base}
+        , port_{port}
+        , collect_op_{std::move(collect_op)}
+        , logger_{common::make_logger("metrics_server")}
+    { }
+
+    void metrics_server::start()
+    {
+        http_ = common::evhttp_ptr(evhttp_new(base_));
+        if(!http_) {
+            throw std::runtime_error{"Can not create metrics http server"};
+        }
+        evhttp_set_allowed_methods(http_.get(), EVHTTP_REQ_GET);
+
+        const auto on_request = [](evhttp_request *request, void *ctx)
+        {
+            auto *self{static_cast<metrics_server *>(ctx)};
+            self->on_request(request);
+        };
+        // other paths are answered with 404 by evhttp
+        evhttp_set_cb(http_.get(), "/metrics", on_request, this);
+
+        if(0 != evhttp_bind_socket(http_.get(), "127.0.0.1", port_)) {
+            http_.reset();
+            throw std::runtime_error{"Can not bind metrics http server to port " + std::to_string(port_)};
+        }
+        LOG4CPLUS_INFO(logger_, "Metrics are served on http://127.0.0.1:" << port_ << "/metrics");
+    }
+
+    void metrics_server::stop()
+    {
+        http_.reset();
+    }
+
+    void metrics_server::on_request(evhttp_request *request)
+    {
+        const std::string metrics{collect_op_()};
+        const common::evbuffer_ptr reply{evbuffer_new()};
+        if(!reply || -1 == evbuffer_add(reply.get(), metrics.data(), metrics.size())) {
+            evhttp_send_error(request, HTTP_INTERNAL, nullptr);
+            return;
+        }
+        evhttp_add_header(evhttp_request_get_output_headers(request),
+                          "Content-Type", "text/plain; version=0.0.4; charset=utf-8");
+        evhttp_send_reply(request, HTTP_OK, "OK", reply.get());
+    }
+
+}
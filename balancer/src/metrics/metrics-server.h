@@ -0,0 +1,37 @@
+#pragma once
+
+#include <common/src/types.h>
+#include <common/src/utils.h>
+
+#include <functional>
+#include <string>
+
+namespace balancer {
+
+    /*
+     * HTTP endpoint for Prometheus: GET /metrics returns the text built by
+     * collect_op. It is served by an event loop of a worker and bound
+     * to the loopback interface only.
+     */
+    class metrics_server {
+        using collect_op_t = std::function<std::string()>;
+
+    public:
+        metrics_server(event_base *base, std::uint16_t port, collect_op_t collect_op);
+
+    public:
+        void start();
+        void stop();
+
+    private:
+        void on_request(evhttp_request *request);
+
+    private:
+        event_base *base_;
+        const std::uint16_t port_;
+        const collect_op_t collect_op_;
+        common::evhttp_ptr http_;
+        log4cplus::Logger logger_;
+    };
+
+}
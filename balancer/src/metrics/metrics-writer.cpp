@@ -0,0 +1,56 @@
+#include "metrics-writer.h"
+
+namespace balancer {
+
+    void metrics_writer::family(const std::string &name, const char *type, const std::string &help)
+    {
+        out_ << "# HELP " << name << " " << help << "\n"
+             << "# TYPE " << name << " " << type << "\n";
+    }
+
+    void metrics_writer::sample(const std::string &name, const std::string &labels, std::uint64_t value)
+    {
+        out_ << name;
+        if(!labels.empty()) {
+            out_ << "{" << labels << "}";
+        }
+        out_ << " " << value << "\n";
+    }
+
+    void metrics_writer::sample(const std::string &name, const std::string &labels, std::int64_t value)
+    {
+        out_ << name;
+        if(!labels.empty()) {
+            out_ << "{" << labels << "}";
+        }
+        out_ << " " << value << "\n";
+    }
+
+    std::string metrics_writer::str() const
+    {
+        return out_.str();
+    }
+
+    std::string metrics_writer::escape(const std::string &value)
+    {
+        std::string escaped;
+        escaped.reserve(value.size());
+        for(const char symbol : value) {
+            switch(symbol) {
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            default:
+                escaped += symbol;
+            }
+        }
+        return escaped;
+    }
+
+}
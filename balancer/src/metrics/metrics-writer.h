@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../stats/worker-stats.h"
+
+#include <sstream>
+#include <string>
+
+namespace balancer {
+
+    /*
+     * Prometheus text exposition format. A family is started by its
+     * help and type lines and followed by its samples, labels are
+     * passed already formatted: name="value",...
+     */
+    class metrics_writer {
+    public:
+        void family(const std::string &name, const char *type, const std::string &help);
+        void sample(const std::string &name, const std::string &labels, std::uint64_t value);
+        void sample(const std::string &name, const std::string &labels, std::int64_t value);
+        // Histograms of all workers are summed up
+        template<typename histograms_t>
+        void histograms(const std::string &name, const std::string &help, const histograms_t &histograms)
+        {
+            family(name, "histogram", help);
+            std::uint64_t cumulative{0};
+            for(std::size_t bucket_idx = 0; bucket_idx < histogram::buckets_count; ++bucket_idx) {
+                for(const histogram *hist : histograms) {
+                    cumulative += hist->bucket(bucket_idx);
+                }
+                const bool last{histogram::buckets_count - 1 == bucket_idx};
+                sample(name + "_bucket",
+                       "le=\"" + (last ? std::string{"+Inf"} : std::to_string(histogram::upper_bound(bucket_idx))) + "\"",
+                       cumulative);
+            }
+            std::uint64_t sum{0};
+            for(const histogram *hist : histograms) {
+                sum += hist->sum();
+            }
+            sample(name + "_sum", "", sum);
+            sample(name + "_count", "", cumulative);
+        }
+        std::string str() const;
+
+        // label value with quotes, backslashes and new lines escaped
+        static std::string escape(const std::string &value);
+
+    private:
+        std::ostringstream out_;
+    };
+
+}
@@ -0,0 +1,111 @@
+#include "backend.h"
+
+#include <algorithm>
+#include <mutex>
+#include <set>
+
+namespace {
+
+    // weight of a new sample is 1/ewma_divider
+    const std::int64_t ewma_divider{5};
+
+    std::atomic<std::uint64_t> last_backend_id{0};
+
+    // Indexes of backend slots in worker stats, the lowest free one is taken
+    // and it is free again when its backend is gone, so they stay below the
+    // count of live backends however often the route map is reloaded
+    class stats_slots {
+    public:
+        std::size_t acquire()
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            if(free_.empty()) {
+                return next_++;
+            }
+            const std::size_t slot{*free_.cbegin()};
+            free_.erase(free_.cbegin());
+            return slot;
+        }
+
+        void release(std::size_t slot)
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            free_.insert(slot);
+        }
+
+    private:
+        std::mutex mutex_;
+        std::set<std::size_t> free_;
+        std::size_t next_{0};
+    };
+
+    stats_slots &backend_stats_slots()
+    {
+        static stats_slots slots;
+        return slots;
+    }
+
+}
+
+namespace balancer {
+
+    void backend_stats::update_connect_latency(std::chrono::microseconds latency) noexcept
+    {
+        // concurrent updates can lose a sample, it is fine for an average
+        const auto sample{static_cast<std::int64_t>(latency.count())};
+        const auto current{static_cast<std::int64_t>(connect_latency_us.load(std::memory_order_relaxed))};
+        const std::int64_t updated{0 == current ? sample : current + (sample - current) / ewma_divider};
+        connect_latency_us.store(static_cast<std::uint64_t>(std::max<std::int64_t>(updated, 1)),
+                                 std::memory_order_relaxed);
+    }
+
+    backend::backend(const common::remote_server &server, common::compression_type compression)
+        : id_{last_backend_id.fetch_add(1, std::memory_order_relaxed)}
+        , stats_slot_{backend_stats_slots().acquire()}
+        , server_{server}
+        , has_address_{server.is_ipv4()}
+        , address_(has_address_ ? server.sockaddr() : sockaddr_in{})
+        , compression_{compression}
+    { }
+
+    backend::~backend()
+    {
+        backend_stats_slots().release(stats_slot_);
+    }
+
+    std::uint64_t backend::id() const noexcept
+    {
+        return id_;
+    }
+
+    std::size_t backend::stats_slot() const noexcept
+    {
+        return stats_slot_;
+    }
+
+    const common::remote_server &backend::server() const noexcept
+    {
+        return server_;
+    }
+
+    const sockaddr_in *backend::address() const noexcept
+    {
+        return has_address_ ? &address_ : nullptr;
+    }
+
+    common::compression_type backend::compression() const noexcept
+    {
+        return compression_;
+    }
+
+    backend_stats &backend::stats() const noexcept
+    {
+        return stats_;
+    }
+
+    backend_health &backend::health() const noexcept
+    {
+        return health_;
+    }
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <common/src/remote-server.h>
+#include <common/src/compression.h>
+#include "../health/backend-health.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace balancer {
+
+    // Live load of a backend compared by routing policies, updated by all workers,
+    // traffic counters are kept by every worker separately
+    struct backend_stats {
+        std::atomic<std::int64_t> queued_bytes{0};
+        std::atomic<std::uint32_t> active_sessions{0};
+        // EWMA of connect latency, zero until the first connection is established
+        std::atomic<std::uint64_t> connect_latency_us{0};
+
+        void update_connect_latency(std::chrono::microseconds latency) noexcept;
+    };
+
+    class backend {
+    public:
+        explicit backend(const common::remote_server &server,
+                         common::compression_type compression = common::compression_type::none);
+        ~backend();
+
+    public:
+        // unique for the process lifetime
+        std::uint64_t id() const noexcept;
+        // slot of the backend in worker stats, taken by a new backend once this one is gone
+        std::size_t stats_slot() const noexcept;
+        const common::remote_server &server() const noexcept;
+        // address parsed once when the route map is loaded,
+        // nullptr for host names: they are resolved on connect
+        const sockaddr_in *address() const noexcept;
+        // compression of the stream sent to the backend
+        common::compression_type compression() const noexcept;
+        // backends are shared through a const route map, but their stats are live
+        backend_stats &stats() const noexcept;
+        backend_health &health() const noexcept;
+
+    private:
+        const std::uint64_t id_;
+        const std::size_t stats_slot_;
+        const common::remote_server server_;
+        const bool has_address_;
+        const sockaddr_in address_;
+        const common::compression_type compression_;
+        mutable backend_stats stats_;
+        mutable backend_health health_;
+    };
+
+    using backend_ptr = std::shared_ptr<backend>;
+    using backend_group = std::vector<backend_ptr>;
+
+}
@@ -0,0 +1,42 @@
+#include "route-map-holder.h"
+
+namespace balancer {
+
+    route_map_holder::route_map_holder(route_map_ptr route_map)
+        : route_map_{std::move(route_map)}
+    { }
+
+    route_map_ptr route_map_holder::load() const
+    {
+        return std::atomic_load(&route_map_);
+    }
+
+    void route_map_holder::publish(route_map_ptr route_map)
+    {
+        std::atomic_store(&route_map_, std::move(route_map));
+        version_.fetch_add(1, std::memory_order_release);
+    }
+
+    std::uint64_t route_map_holder::version() const noexcept
+    {
+        return version_.load(std::memory_order_acquire);
+    }
+
+    route_map_view::route_map_view(const route_map_holder &holder)
+        : holder_{holder}
+        , version_{holder.version()}
+    {
+        route_map_ = holder_.load();
+    }
+
+    const route_map_ptr &route_map_view::get()
+    {
+        const std::uint64_t version{holder_.version()};
+        if(version != version_) {
+            version_ = version;
+            route_map_ = holder_.load();
+        }
+        return route_map_;
+    }
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "route-map.h"
+
+#include <atomic>
+#include <memory>
+
+namespace balancer {
+
+    using route_map_ptr = std::shared_ptr<const route_map>;
+
+    /*
+     * Current route map shared by all workers. A new map is published as
+     * an immutable snapshot, sessions that were routed by the old one keep
+     * their backends, the old map is freed with its last user.
+     */
+    class route_map_holder {
+    public:
+        explicit route_map_holder(route_map_ptr route_map);
+
+    public:
+        route_map_ptr load() const;
+        void publish(route_map_ptr route_map);
+        std::uint64_t version() const noexcept;
+
+    private:
+        route_map_ptr route_map_;
+        std::atomic<std::uint64_t> version_{0};
+    };
+
+    /*
+     * Per worker cache of the current snapshot, the holder is touched only
+     * after a new map is published, otherwise reading is a single atomic load.
+     */
+    class route_map_view {
+    public:
+        explicit route_map_view(const route_map_holder &holder);
+        const route_map_ptr &get();
+
+    private:
+        const route_map_holder &holder_;
+        route_map_ptr route_map_;
+        std::uint64_t version_;
+    };
+
+}
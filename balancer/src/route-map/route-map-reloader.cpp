@@ -0,0 +1,113 @@
+#include "route-map-reloader.h"
+#include <common/src/utils.h>
+
+#include <signal.h>
+#include <sys/stat.h>
+#include <log4cplus/loggingmacros.h>
+
+namespace {
+
+    sigset_t reload_signal_set()
+    {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGHUP);
+        return signals;
+    }
+
+}
+
+namespace balancer {
+
+    route_map_reloader::route_map_reloader(const std::string &file_path,
+                                           route_map_holder &holder,
+                                           std::chrono::seconds check_interval)
+        : file_path_{file_path}
+        , holder_{holder}
+        , check_interval_{check_interval}
+        , logger_{common::make_logger("route_map_reloader")}
+    {
+        is_file_changed();
+    }
+
+    route_map_reloader::~route_map_reloader()
+    {
+        stop();
+    }
+
+    void route_map_reloader::start()
+    {
+        thread_ = std::thread{[this]() { run(); }};
+    }
+
+    void route_map_reloader::stop()
+    {
+        stopped_ = true;
+        if(thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    void route_map_reloader::block_reload_signal()
+    {
+        const sigset_t signals{reload_signal_set()};
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    }
+
+    void route_map_reloader::run()
+    {
+        const sigset_t signals{reload_signal_set()};
+        auto next_check{std::chrono::steady_clock::now() + check_interval_};
+        while(!stopped_) {
+            // wake up every second to check the stop flag
+            const timespec timeout{1, 0};
+            bool need_reload{SIGHUP == sigtimedwait(&signals, nullptr, &timeout)};
+            if(need_reload) {
+                LOG4CPLUS_INFO(logger_, "SIGHUP received");
+                is_file_changed();
+            } else if(check_interval_.count() > 0 && std::chrono::steady_clock::now() >= next_check) {
+                next_check = std::chrono::steady_clock::now() + check_interval_;
+                need_reload = is_file_changed();
+            }
+
+            if(need_reload) {
+                reload();
+            }
+        }
+    }
+
+    bool route_map_reloader::is_file_changed()
+    {
+        struct stat file_stat;
+        if(0 != ::stat(file_path_.c_str(), &file_stat)) {
+            return false;
+        }
+        const file_stamp current{file_stat.st_ino, file_stat.st_size, file_stat.st_mtim};
+        const bool changed{current.inode != file_stamp_.inode
+                    || current.size != file_stamp_.size
+                    || current.modified_at.tv_sec != file_stamp_.modified_at.tv_sec
+                    || current.modified_at.tv_nsec != file_stamp_.modified_at.tv_nsec};
+        file_stamp_ = current;
+        return changed;
+    }
+
+    void route_map_reloader::reload()
+    {
+        try {
+            const auto current{holder_.load()};
+            auto route_map{std::make_shared<const balancer::route_map>(read_route_map(file_path_, current.get()))};
+            if(route_map->empty()) {
+                LOG4CPLUS_ERROR(logger_, "New route map is empty, keep the current one");
+                return;
+            }
+            const std::size_t routes_count{route_map->routes_count()};
+            const std::size_t backends_count{route_map->backends_count()};
+            holder_.publish(std::move(route_map));
+            LOG4CPLUS_INFO(logger_, "Route map was reloaded: " << routes_count << " route(s) to "
+                           << backends_count << " backend(s)");
+        } catch (const std::exception &ex) {
+            LOG4CPLUS_ERROR(logger_, "Can not reload route map, error: " << ex.what());
+        }
+    }
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "route-map-holder.h"
+
+#include <ctime>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <sys/types.h>
+#include <log4cplus/logger.h>
+
+namespace balancer {
+
+    /*
+     * Reloads route map on SIGHUP or when the file is changed and publishes
+     * it to the holder. Runs on its own thread, so event loops are never
+     * stalled by reading and parsing the file. An empty map is rejected.
+     */
+    class route_map_reloader {
+    public:
+        route_map_reloader(const std::string &file_path,
+                           route_map_holder &holder,
+                           std::chrono::seconds check_interval);
+        ~route_map_reloader();
+
+    public:
+        void start();
+        void stop();
+        // SIGHUP must be blocked before any other thread is started,
+        // threads inherit the mask and the signal is handled only by sigtimedwait
+        static void block_reload_signal();
+
+    private:
+        struct file_stamp {
+            ino_t inode{0};
+            off_t size{0};
+            timespec modified_at{0, 0};
+        };
+
+    private:
+        void run();
+        bool is_file_changed();
+        void reload();
+
+    private:
+        const std::string file_path_;
+        route_map_holder &holder_;
+        const std::chrono::seconds check_interval_;
+        log4cplus::Logger logger_;
+        file_stamp file_stamp_;
+        std::atomic<bool> stopped_{false};
+        std::thread thread_;
+    };
+
+}
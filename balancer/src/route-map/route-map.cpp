@@ -0,0 +1,217 @@
+#include "route-map.h"
+
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+
+namespace balancer {
+
+    constexpr route_map::group_idx_t route_map::no_group;
+
+    void route_map::add_route(client_id_t client_id, backend_group group)
+    {
+        routes_.emplace_back(client_id, add_group(std::move(group)));
+    }
+
+    void route_map::set_default_route(backend_group group)
+    {
+        default_group_ = add_group(std::move(group));
+    }
+
+    void route_map::add_trusted(client_id_t client_id)
+    {
+        trusted_ids_.push_back(client_id);
+    }
+
+    void route_map::build()
+    {
+        std::sort(trusted_ids_.begin(), trusted_ids_.end());
+        trusted_ids_.erase(std::unique(trusted_ids_.begin(), trusted_ids_.end()), trusted_ids_.end());
+
+        // as before, the first route of a client wins
+        std::stable_sort(routes_.begin(), routes_.end(),
+                         [](const std::pair<client_id_t, group_idx_t> &lhs,
+                            const std::pair<client_id_t, group_idx_t> &rhs) {
+                             return lhs.first < rhs.first;
+                         });
+        routes_.erase(std::unique(routes_.begin(), routes_.end(),
+                                  [](const std::pair<client_id_t, group_idx_t> &lhs,
+                                     const std::pair<client_id_t, group_idx_t> &rhs) {
+                                      return lhs.first == rhs.first;
+                                  }),
+                      routes_.end());
+
+        dense_groups_.clear();
+        sparse_ids_.clear();
+        sparse_groups_.clear();
+        if(!routes_.empty()) {
+            // the dense table takes no more memory than the sparse arrays
+            const std::uint64_t span{static_cast<std::uint64_t>(routes_.back().first) - routes_.front().first + 1};
+            if(span <= 2 * routes_.size()) {
+                first_client_id_ = routes_.front().first;
+                dense_groups_.assign(static_cast<std::size_t>(span), no_group);
+                for(const auto &route : routes_) {
+                    dense_groups_[route.first - first_client_id_] = route.second;
+                }
+            } else {
+                sparse_ids_.reserve(routes_.size());
+                sparse_groups_.reserve(routes_.size());
+                for(const auto &route : routes_) {
+                    sparse_ids_.push_back(route.first);
+                    sparse_groups_.push_back(route.second);
+                }
+            }
+        }
+
+        routes_.clear();
+        routes_.shrink_to_fit();
+        group_indices_.clear();
+    }
+
+    const backend_group *route_map::find(client_id_t client_id) const noexcept
+    {
+        if(!dense_groups_.empty()) {
+            if(client_id >= first_client_id_ && client_id - first_client_id_ < dense_groups_.size()) {
+                const group_idx_t group_idx{dense_groups_[client_id - first_client_id_]};
+                if(no_group != group_idx) {
+                    return group_at(group_idx);
+                }
+            }
+        } else {
+            const auto id_it{std::lower_bound(sparse_ids_.cbegin(), sparse_ids_.cend(), client_id)};
+            if(sparse_ids_.cend() != id_it && *id_it == client_id) {
+                return group_at(sparse_groups_[static_cast<std::size_t>(id_it - sparse_ids_.cbegin())]);
+            }
+        }
+        return group_at(default_group_);
+    }
+
+    bool route_map::is_trusted(client_id_t client_id) const noexcept
+    {
+        return std::binary_search(trusted_ids_.cbegin(), trusted_ids_.cend(), client_id);
+    }
+
+    backend_ptr route_map::find_backend(const common::remote_server &server) const
+    {
+        const auto backend_it{backends_.find(server)};
+        return backends_.cend() == backend_it ? nullptr : backend_it->second;
+    }
+
+    bool route_map::empty() const noexcept
+    {
+        return 0 == routes_count() && no_group == default_group_;
+    }
+
+    std::size_t route_map::routes_count() const noexcept
+    {
+        return sparse_ids_.size()
+                + static_cast<std::size_t>(std::count_if(dense_groups_.cbegin(), dense_groups_.cend(),
+                                                         [](group_idx_t group_idx) { return no_group != group_idx; }));
+    }
+
+    std::size_t route_map::backends_count() const noexcept
+    {
+        return backends_.size();
+    }
+
+    const std::map<common::remote_server, backend_ptr> &route_map::backends() const noexcept
+    {
+        return backends_;
+    }
+
+    route_map::group_idx_t route_map::add_group(backend_group group)
+    {
+        std::vector<const backend *> key;
+        key.reserve(group.size());
+        for(const auto &backend : group) {
+            key.push_back(backend.get());
+            backends_.emplace(backend->server(), backend);
+        }
+
+        const auto group_it{group_indices_.find(key)};
+        if(group_indices_.cend() != group_it) {
+            return group_it->second;
+        }
+        const auto group_idx{static_cast<group_idx_t>(groups_.size())};
+        groups_.push_back(std::move(group));
+        group_indices_.emplace(std::move(key), group_idx);
+        return group_idx;
+    }
+
+    const backend_group *route_map::group_at(group_idx_t group_idx) const noexcept
+    {
+        return no_group == group_idx ? nullptr : &groups_[group_idx];
+    }
+
+    route_map read_route_map(const std::string &file_path, const route_map *previous)
+    {
+        route_map route_map;
+        std::vector<std::string> lines;
+        std::ifstream in_file{file_path};
+        for(std::string line; std::getline(in_file, line);) {
+            lines.push_back(std::move(line));
+        }
+
+        // compression lines can follow the routes that use the backend
+        std::map<common::remote_server, common::compression_type> compressions;
+        for(const auto &line : lines) {
+            std::stringstream stream{line};
+            std::string directive, host, compression;
+            std::uint16_t port;
+            if(stream >> directive && "compression" == directive && stream >> host >> port >> compression) {
+                compressions[common::remote_server{host, port}] = common::read_compression_type(compression);
+            }
+        }
+
+        // the same backend in several groups shares its stats
+        std::map<common::remote_server, backend_ptr> backends;
+        for(const auto &line : lines) {
+            std::stringstream stream{line};
+            std::string client_id;
+            stream >> client_id;
+            if("compression" == client_id) {
+                continue;
+            }
+            if("trusted" == client_id) {
+                for(route_map::client_id_t trusted_id; stream >> trusted_id;) {
+                    route_map.add_trusted(trusted_id);
+                }
+                continue;
+            }
+
+            backend_group group;
+            std::string host; std::uint16_t port;
+            while(stream >> host >> port) {
+                const common::remote_server server{host, port};
+                const auto compression_it{compressions.find(server)};
+                const auto compression{compressions.cend() == compression_it
+                            ? common::compression_type::none : compression_it->second};
+                auto &backend{backends[server]};
+                if(!backend && nullptr != previous) {
+                    backend = previous->find_backend(server);
+                    // a backend with changed compression starts anew
+                    if(backend && backend->compression() != compression) {
+                        backend.reset();
+                    }
+                }
+                if(!backend) {
+                    backend = std::make_shared<balancer::backend>(server, compression);
+                }
+                group.push_back(backend);
+            }
+
+            if(group.empty()) {
+                // a route without backends is skipped, the default one too
+                continue;
+            }
+            if("*" == client_id) {
+                route_map.set_default_route(std::move(group));
+            } else {
+                route_map.add_route(static_cast<route_map::client_id_t>(std::stoul(client_id)), std::move(group));
+            }
+        }
+        route_map.build();
+        return route_map;
+    }
+
+}
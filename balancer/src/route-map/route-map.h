@@ -0,0 +1,76 @@
+#pragma once
+
+#include "backend.h"
+#include <proto/src/init-message.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace balancer {
+
+    /*
+     * Every client is routed to one backend from its group, clients without
+     * their own route use the default group (if it is set).
+     * File format, one route per line:
+     * <client_id|*> <host> <port> [<host> <port> ...]
+     * Stream to a backend is compressed when it is set by a line
+     * compression <host> <port> <none|lz4|zstd>
+     * Clients whose streams need no validation are listed by lines
+     * trusted <client_id> [<client_id> ...]
+     *
+     * Equal groups are stored once, client ids are mapped to group indices
+     * by a flat table: directly indexed by id when ids are dense enough,
+     * otherwise by a sorted id array with binary search.
+     */
+    class route_map {
+    public:
+        using client_id_t = proto::init_message::client_id_t;
+
+    public:
+        // Routes are collected by add_route and set_default_route,
+        // find works only after build
+        void add_route(client_id_t client_id, backend_group group);
+        void set_default_route(backend_group group);
+        void add_trusted(client_id_t client_id);
+        void build();
+
+        const backend_group *find(client_id_t client_id) const noexcept;
+        bool is_trusted(client_id_t client_id) const noexcept;
+        backend_ptr find_backend(const common::remote_server &server) const;
+        bool empty() const noexcept;
+        std::size_t routes_count() const noexcept;
+        std::size_t backends_count() const noexcept;
+        const std::map<common::remote_server, backend_ptr> &backends() const noexcept;
+
+    private:
+        using group_idx_t = std::uint32_t;
+        static constexpr group_idx_t no_group{static_cast<group_idx_t>(-1)};
+
+    private:
+        group_idx_t add_group(backend_group group);
+        const backend_group *group_at(group_idx_t group_idx) const noexcept;
+
+    private:
+        std::vector<backend_group> groups_;
+        group_idx_t default_group_{no_group};
+        std::map<common::remote_server, backend_ptr> backends_;
+
+        // dense lookup: dense_groups_[client_id - first_client_id_]
+        client_id_t first_client_id_{0};
+        std::vector<group_idx_t> dense_groups_;
+        // sparse lookup: sparse_groups_[i] is the group of sparse_ids_[i]
+        std::vector<client_id_t> sparse_ids_;
+        std::vector<group_idx_t> sparse_groups_;
+        // sorted after build
+        std::vector<client_id_t> trusted_ids_;
+
+        // used only while the map is built
+        std::vector<std::pair<client_id_t, group_idx_t>> routes_;
+        std::map<std::vector<const backend *>, group_idx_t> group_indices_;
+    };
+
+    // Backends that are present in the previous map are reused with their stats
+    route_map read_route_map(const std::string &file_path, const route_map *previous = nullptr);
+
+}
@@ -0,0 +1,133 @@
+#include "routing-policy.h"
+
+#include <tuple>
+#include <stdexcept>
+#include <algorithm>
+
+namespace {
+
+    using namespace balancer;
+    using steady_clock = std::chrono::steady_clock;
+
+    bool is_available(const backend_ptr &backend, steady_clock::time_point now, const balancer::backend *excluded) noexcept
+    {
+        return backend.get() != excluded && backend->health().is_available(now);
+    }
+
+    // The available backend with the least key
+    template<typename key_op_t>
+    const backend_ptr *min_available(const backend_group &group, const backend *excluded, const key_op_t &key_op)
+    {
+        const auto now{steady_clock::now()};
+        const backend_ptr *chosen{nullptr};
+        for(const auto &backend : group) {
+            if(is_available(backend, now, excluded) && (nullptr == chosen || key_op(backend) < key_op(*chosen))) {
+                chosen = &backend;
+            }
+        }
+        return chosen;
+    }
+
+    // Sessions are compared by queued bytes first, a new session writes nothing
+    // for a while, so active sessions break ties
+    std::tuple<std::int64_t, std::uint32_t> load_of(const backend_ptr &backend) noexcept
+    {
+        const auto &stats{backend->stats()};
+        return std::make_tuple(stats.queued_bytes.load(std::memory_order_relaxed),
+                               stats.active_sessions.load(std::memory_order_relaxed));
+    }
+
+    // Backends without connections yet have zero latency and are tried first
+    std::tuple<std::uint64_t, std::uint32_t> latency_of(const backend_ptr &backend) noexcept
+    {
+        const auto &stats{backend->stats()};
+        return std::make_tuple(stats.connect_latency_us.load(std::memory_order_relaxed),
+                               stats.active_sessions.load(std::memory_order_relaxed));
+    }
+
+}
+
+namespace balancer {
+
+    round_robin_policy::round_robin_policy(const route_map_holder &route_map)
+        : route_map_{route_map}
+        , version_{route_map.version()}
+    { }
+
+    const backend_ptr *round_robin_policy::choose(const backend_group &group, const backend *excluded)
+    {
+        // a reloaded map has new groups, a group of it can take the address of an old one
+        const std::uint64_t version{route_map_.version()};
+        if(version != version_) {
+            version_ = version;
+            next_.clear();
+        }
+
+        const auto now{steady_clock::now()};
+        auto &next{next_[&group]};
+        for(std::size_t tried = 0; tried < group.size(); ++tried) {
+            const auto &backend{group[next++ % group.size()]};
+            if(is_available(backend, now, excluded)) {
+                return &backend;
+            }
+        }
+        return nullptr;
+    }
+
+    const backend_ptr *least_outstanding_policy::choose(const backend_group &group, const backend *excluded)
+    {
+        return min_available(group, excluded, load_of);
+    }
+
+    const backend_ptr *ewma_latency_policy::choose(const backend_group &group, const backend *excluded)
+    {
+        return min_available(group, excluded, latency_of);
+    }
+
+    power_of_two_policy::power_of_two_policy()
+        : random_{std::random_device{}()}
+    { }
+
+    const backend_ptr *power_of_two_policy::choose(const backend_group &group, const backend *excluded)
+    {
+        const auto now{steady_clock::now()};
+        if(group.empty()) {
+            return nullptr;
+        }
+        if(1 == group.size()) {
+            return is_available(group.front(), now, excluded) ? &group.front() : nullptr;
+        }
+        std::uniform_int_distribution<std::size_t> distribution{0, group.size() - 1};
+        const std::size_t first{distribution(random_)};
+        std::size_t second{distribution(random_)};
+        if(first == second) {
+            second = (second + 1) % group.size();
+        }
+        const bool first_available{is_available(group[first], now, excluded)};
+        const bool second_available{is_available(group[second], now, excluded)};
+        if(first_available && second_available) {
+            return load_of(group[first]) <= load_of(group[second]) ? &group[first] : &group[second];
+        }
+        if(first_available || second_available) {
+            return first_available ? &group[first] : &group[second];
+        }
+        // both are unavailable, the rest of the group is looked through
+        return min_available(group, excluded, load_of);
+    }
+
+    std::unique_ptr<routing_policy> make_routing_policy(routing_policy_type type, const route_map_holder &route_map)
+    {
+        switch(type) {
+        case routing_policy_type::round_robin:
+            return std::make_unique<round_robin_policy>(route_map);
+        case routing_policy_type::least_outstanding:
+            return std::make_unique<least_outstanding_policy>();
+        case routing_policy_type::ewma_latency:
+            return std::make_unique<ewma_latency_policy>();
+        case routing_policy_type::power_of_two:
+            return std::make_unique<power_of_two_policy>();
+        }
+        throw std::invalid_argument{"Unknown routing policy"};
+    }
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "../route-map/backend.h"
+#include "../route-map/route-map-holder.h"
+
+#include <random>
+#include <memory>
+#include <unordered_map>
+
+namespace balancer {
+
+    enum class routing_policy_type {
+        round_robin,
+        least_outstanding,  // backend with the least bytes queued for it
+        ewma_latency,       // backend with the lowest average connect latency
+        power_of_two        // the less loaded of two random backends
+    };
+
+    /*
+     * Chooses a backend from the group for a new session, ejected backends
+     * and the excluded one (a backend that has just failed to connect) are
+     * skipped, nullptr means that no backend of the group is available.
+     * Every worker has its own policy, so policies need no locking.
+     */
+    class routing_policy {
+    public:
+        virtual ~routing_policy() = default;
+        virtual const backend_ptr *choose(const backend_group &group, const backend *excluded) = 0;
+    };
+
+    class round_robin_policy
+        : public routing_policy
+    {
+    public:
+        explicit round_robin_policy(const route_map_holder &route_map);
+        const backend_ptr *choose(const backend_group &group, const backend *excluded) override;
+
+    private:
+        const route_map_holder &route_map_;
+        // every group is iterated separately, groups live in the route map
+        // of this version, so the cursors are dropped with it
+        std::uint64_t version_;
+        std::unordered_map<const backend_group *, std::size_t> next_;
+    };
+
+    class least_outstanding_policy
+        : public routing_policy
+    {
+    public:
+        const backend_ptr *choose(const backend_group &group, const backend *excluded) override;
+    };
+
+    class ewma_latency_policy
+        : public routing_policy
+    {
+    public:
+        const backend_ptr *choose(const backend_group &group, const backend *excluded) override;
+    };
+
+    class power_of_two_policy
+        : public routing_policy
+    {
+    public:
+        power_of_two_policy();
+        const backend_ptr *choose(const backend_group &group, const backend *excluded) override;
+
+    private:
+        std::minstd_rand random_;
+    };
+
+    std::unique_ptr<routing_policy> make_routing_policy(routing_policy_type type, const route_map_holder &route_map);
+
+}
@@ -0,0 +1,67 @@
+#include "worker-stats.h"
+
+#include <algorithm>
+
+namespace balancer {
+
+    constexpr std::size_t histogram::buckets_count;
+
+    const char *close_reason_name(close_reason reason) noexcept
+    {
+        switch(reason) {
+        case close_reason::client_closed:
+            return "client_closed";
+        case close_reason::start_failed:
+            return "start_failed";
+        case close_reason::invalid_init:
+            return "invalid_init";
+        case close_reason::unknown_client:
+            return "unknown_client";
+        case close_reason::routing_failed:
+            return "routing_failed";
+        case close_reason::invalid_frame:
+            return "invalid_frame";
+        case close_reason::upstream_closed:
+            return "upstream_closed";
+        case close_reason::io_error:
+            return "io_error";
+        case close_reason::handshake_timeout:
+            return "handshake_timeout";
+        case close_reason::idle_timeout:
+            return "idle_timeout";
+        case close_reason::no_healthy_backend:
+            return "no_healthy_backend";
+        case close_reason::connect_failed:
+            return "connect_failed";
+        case close_reason::count:
+            break;
+        }
+        return "unknown";
+    }
+
+    void histogram::observe(std::uint64_t value) noexcept
+    {
+        std::size_t bucket_idx{0};
+        if(value > 1) {
+            bucket_idx = static_cast<std::size_t>(64 - __builtin_clzll(value - 1));
+        }
+        increment(buckets_[std::min(bucket_idx, buckets_count - 1)]);
+        add(sum_, value);
+    }
+
+    std::uint64_t histogram::bucket(std::size_t bucket_idx) const noexcept
+    {
+        return buckets_[bucket_idx].load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t histogram::sum() const noexcept
+    {
+        return sum_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t histogram::upper_bound(std::size_t bucket_idx) noexcept
+    {
+        return std::uint64_t{1} << bucket_idx;
+    }
+
+}
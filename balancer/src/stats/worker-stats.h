@@ -0,0 +1,222 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace balancer {
+
+    using counter_t = std::atomic<std::uint64_t>;
+    using gauge_t = std::atomic<std::int64_t>;
+
+    // Counters are changed only by the owning worker, so a plain store is enough,
+    // other threads can read them at any time
+    inline void increment(counter_t &counter) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    inline void add(counter_t &counter, std::uint64_t value) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    inline void add(gauge_t &gauge, std::int64_t delta) noexcept
+    {
+        gauge.store(gauge.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    // Why a session was closed, client_closed is the normal end of a session
+    enum class close_reason {
+        client_closed,
+        start_failed,
+        invalid_init,
+        unknown_client,
+        routing_failed,
+        invalid_frame,
+        upstream_closed,
+        io_error,
+        handshake_timeout,  // init message was not read in time
+        idle_timeout,       // nothing was read from the client in time
+        no_healthy_backend, // all backends of the client group are ejected
+        connect_failed,     // connect retries are exhausted
+        count
+    };
+
+    const char *close_reason_name(close_reason reason) noexcept;
+
+    /*
+     * Histogram with power of two buckets: bucket i counts values
+     * in (2^(i-1), 2^i], the last bucket counts everything above.
+     * Like counters it is changed only by the owning worker.
+     */
+    class histogram {
+    public:
+        static constexpr std::size_t buckets_count{32};
+
+    public:
+        void observe(std::uint64_t value) noexcept;
+        std::uint64_t bucket(std::size_t bucket_idx) const noexcept;
+        std::uint64_t sum() const noexcept;
+        // upper bound of the bucket, the last one has no bound
+        static std::uint64_t upper_bound(std::size_t bucket_idx) noexcept;
+
+    private:
+        std::array<counter_t, buckets_count> buckets_{};
+        counter_t sum_{0};
+    };
+
+    struct client_stats {
+        // client id + 1, zero marks a free slot
+        std::atomic<std::uint64_t> key{0};
+        counter_t frames_in{0};
+        counter_t bytes_in{0};
+        counter_t frames_out{0};
+        counter_t bytes_out{0};
+    };
+
+    // Traffic of one worker to a backend, the load that routing policies
+    // compare across workers stays in backend_stats
+    struct backend_traffic {
+        // backend id + 1, zero marks a free slot
+        std::atomic<std::uint64_t> key{0};
+        // frames and their bytes forwarded to the backend
+        counter_t frames_out{0};
+        counter_t bytes_out{0};
+        // bytes written to the socket, differ from bytes_out when compressed
+        counter_t sent_bytes{0};
+    };
+
+    /*
+     * Fixed size open addressing table of per client counters.
+     * Slots are taken only by the owning worker and never freed, a slot is
+     * published by its key, so readers need no locks. Ids that do not fit
+     * share the overflow slot.
+     */
+    template<typename slot_t, std::size_t capacity_v>
+    class stats_table {
+    public:
+        static constexpr std::size_t capacity{capacity_v};
+        static_assert(0 == (capacity & (capacity - 1)), "Capacity must be a power of two");
+
+    public:
+        slot_t &find(std::uint64_t id) noexcept
+        {
+            const std::uint64_t key{id + 1};
+            std::size_t slot_idx{static_cast<std::size_t>((key * hash_multiplier) >> 52) & (capacity - 1)};
+            for(std::size_t probe = 0; probe < capacity; ++probe) {
+                auto &slot{slots_[slot_idx]};
+                const std::uint64_t slot_key{slot.key.load(std::memory_order_relaxed)};
+                if(key == slot_key) {
+                    return slot;
+                }
+                if(0 == slot_key) {
+                    // counters of a free slot are zero, the key publishes them
+                    slot.key.store(key, std::memory_order_release);
+                    return slot;
+                }
+                slot_idx = (slot_idx + 1) & (capacity - 1);
+            }
+            return overflow_;
+        }
+
+        const slot_t &overflow() const noexcept
+        {
+            return overflow_;
+        }
+
+        // op(id, slot) for every taken slot except the overflow one
+        template<typename op_t>
+        void for_each(const op_t &op) const
+        {
+            for(const auto &slot : slots_) {
+                const std::uint64_t key{slot.key.load(std::memory_order_acquire)};
+                if(0 != key) {
+                    op(key - 1, slot);
+                }
+            }
+        }
+
+    private:
+        // spreads sequential ids over the table
+        static constexpr std::uint64_t hash_multiplier{0x9e3779b97f4a7c15};
+
+    private:
+        std::array<slot_t, capacity> slots_;
+        slot_t overflow_;
+    };
+
+    template<typename slot_t, std::size_t capacity_v>
+    constexpr std::size_t stats_table<slot_t, capacity_v>::capacity;
+
+    using client_stats_table = stats_table<client_stats, 4096>;
+
+    /*
+     * Traffic of one worker to backends, a backend has its own slot while it
+     * is alive and a new backend takes the slot of a gone one, so the table
+     * does not fill up with backends of old route maps. The slot is reset by
+     * the owning worker when it sees a new backend there, readers skip slots
+     * of backends that are not in the current map. Backends with slots beyond
+     * the table share the overflow slot.
+     */
+    class backend_traffic_table {
+    public:
+        static constexpr std::size_t capacity{1024};
+
+    public:
+        backend_traffic &find(std::size_t slot_idx, std::uint64_t backend_id) noexcept
+        {
+            if(slot_idx >= capacity) {
+                return overflow_;
+            }
+            auto &slot{slots_[slot_idx]};
+            const std::uint64_t key{backend_id + 1};
+            if(key != slot.key.load(std::memory_order_relaxed)) {
+                // the previous backend of the slot is gone with its connections
+                slot.frames_out.store(0, std::memory_order_relaxed);
+                slot.bytes_out.store(0, std::memory_order_relaxed);
+                slot.sent_bytes.store(0, std::memory_order_relaxed);
+                slot.key.store(key, std::memory_order_release);
+            }
+            return slot;
+        }
+
+        const backend_traffic &overflow() const noexcept
+        {
+            return overflow_;
+        }
+
+        // op(backend_id, slot) for every taken slot except the overflow one
+        template<typename op_t>
+        void for_each(const op_t &op) const
+        {
+            for(const auto &slot : slots_) {
+                const std::uint64_t key{slot.key.load(std::memory_order_acquire)};
+                if(0 != key) {
+                    op(key - 1, slot);
+                }
+            }
+        }
+
+    private:
+        std::array<backend_traffic, capacity> slots_;
+        backend_traffic overflow_;
+    };
+
+    struct worker_stats {
+        counter_t upstream_throttles{0};    // upstream output buffer went over high watermark
+        counter_t session_pauses{0};        // reading from a client was paused by upstream
+        counter_t upstream_timeouts{0};     // upstream connect or write did not complete in time
+        counter_t connect_retries{0};       // a session retried a failed upstream connect
+        counter_t uring_enters{0};          // io_uring_enter calls of the io_uring engine
+        counter_t uring_completions{0};     // completions reaped by the io_uring engine
+        counter_t sessions_accepted{0};
+        gauge_t active_sessions{0};
+        std::array<counter_t, static_cast<std::size_t>(close_reason::count)> sessions_closed{};
+        histogram connect_latency_us;       // time to establish an upstream connection
+        histogram upstream_queue_bytes;     // upstream output buffer length after a write
+        client_stats_table clients;
+        backend_traffic_table backends;
+    };
+
+}
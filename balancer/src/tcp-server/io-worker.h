@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../stats/worker-stats.h"
+#include <common/src/async-resolver.h>
+#include <common/src/timeouts.h>
+
+namespace balancer {
+
+    // Worker thread of an I/O engine with its own listener and sessions
+    class io_worker {
+    public:
+        virtual ~io_worker() = default;
+        // bind() is called for all workers before any run(), so that
+        // all listeners are bound before any loop is started
+        virtual void bind() = 0;
+        virtual void run() = 0;
+        virtual void stop() = 0;
+        virtual const worker_stats &stats() const noexcept = 0;
+    };
+
+    // Event loop that serves the metrics endpoint and health checks besides its own work
+    class service_loop {
+    public:
+        virtual ~service_loop() = default;
+        // All are valid after bind()
+        virtual event_base *base() const noexcept = 0;
+        virtual const common::common_timeouts &timeouts() const noexcept = 0;
+        virtual common::async_resolver &resolver() noexcept = 0;
+    };
+
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <new>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <type_traits>
+
+namespace balancer {
+
+    // Base of objects linked into an intrusive_list, an object is in one list at a time
+    class intrusive_list_hook {
+        template<typename> friend class intrusive_list;
+
+    private:
+        intrusive_list_hook *prev_{nullptr};
+        intrusive_list_hook *next_{nullptr};
+    };
+
+    // Doubly linked list of objects derived from intrusive_list_hook, it never allocates
+    template<typename t>
+    class intrusive_list {
+    public:
+        intrusive_list() noexcept
+        {
+            head_.prev_ = &head_;
+            head_.next_ = &head_;
+        }
+        intrusive_list(const intrusive_list &) = delete;
+        intrusive_list &operator=(const intrusive_list &) = delete;
+
+    public:
+        bool empty() const noexcept
+        {
+            return &head_ == head_.next_;
+        }
+
+        std::size_t size() const noexcept
+        {
+            return size_;
+        }
+
+        void push_front(t &object) noexcept
+        {
+            intrusive_list_hook &hook{object};
+            hook.prev_ = &head_;
+            hook.next_ = head_.next_;
+            head_.next_->prev_ = &hook;
+            head_.next_ = &hook;
+            ++size_;
+        }
+
+        void erase(t &object) noexcept
+        {
+            intrusive_list_hook &hook{object};
+            hook.prev_->next_ = hook.next_;
+            hook.next_->prev_ = hook.prev_;
+            hook.prev_ = nullptr;
+            hook.next_ = nullptr;
+            --size_;
+        }
+
+        // nullptr if the list is empty
+        t *pop_front() noexcept
+        {
+            if(empty()) {
+                return nullptr;
+            }
+            auto &object{static_cast<t &>(*head_.next_)};
+            erase(object);
+            return &object;
+        }
+
+        // 'op' may erase the object it is called for
+        template<typename op_t>
+        void for_each(op_t op)
+        {
+            for(auto *hook = head_.next_; &head_ != hook;) {
+                auto *next{hook->next_};
+                op(static_cast<t &>(*hook));
+                hook = next;
+            }
+        }
+
+    private:
+        intrusive_list_hook head_;
+        std::size_t size_{0};
+    };
+
+    /*
+     * Objects of one worker that are reused instead of freed: a released
+     * object keeps its buffers and goes to the free list, the next acquire
+     * takes the most recently released (and likely cached) one. Objects are
+     * constructed in slabs of slab_size and destroyed only by clear(), so
+     * a steady flow of acquires and releases does not touch the heap.
+     */
+    template<typename t, std::size_t slab_size = 64>
+    class object_pool {
+        static_assert(std::is_base_of<intrusive_list_hook, t>::value, "Pooled objects must be intrusive_list_hook");
+        using storage_t = typename std::aligned_storage<sizeof(t), alignof(t)>::type;
+
+    public:
+        object_pool() = default;
+        object_pool(const object_pool &) = delete;
+        object_pool &operator=(const object_pool &) = delete;
+
+        ~object_pool()
+        {
+            clear();
+        }
+
+    public:
+        // 'args' are used only when there is no free object to reuse
+        template<typename... args_t>
+        t &acquire(args_t &&...args)
+        {
+            t *object{free_.pop_front()};
+            if(nullptr == object) {
+                object = construct(std::forward<args_t>(args)...);
+            }
+            active_.push_front(*object);
+            return *object;
+        }
+
+        void release(t &object) noexcept
+        {
+            active_.erase(object);
+            free_.push_front(object);
+        }
+
+        template<typename op_t>
+        void for_each_active(op_t op)
+        {
+            active_.for_each(op);
+        }
+
+        std::size_t active_count() const noexcept
+        {
+            return active_.size();
+        }
+
+        std::size_t capacity() const noexcept
+        {
+            return constructed_;
+        }
+
+        // Destroys all objects, active ones too
+        void clear() noexcept
+        {
+            active_.for_each([this](t &object) { active_.erase(object); });
+            free_.for_each([this](t &object) { free_.erase(object); });
+            for(std::size_t object_idx = 0; object_idx < constructed_; ++object_idx) {
+                at(object_idx)->~t();
+            }
+            constructed_ = 0;
+            slabs_.clear();
+        }
+
+    private:
+        template<typename... args_t>
+        t *construct(args_t &&...args)
+        {
+            if(slabs_.size() * slab_size == constructed_) {
+                slabs_.push_back(std::unique_ptr<storage_t[]>(new storage_t[slab_size]));
+            }
+            auto *object{new (at(constructed_)) t(std::forward<args_t>(args)...)};
+            ++constructed_;
+            return object;
+        }
+
+        t *at(std::size_t object_idx) noexcept
+        {
+            return reinterpret_cast<t *>(&slabs_[object_idx / slab_size][object_idx % slab_size]);
+        }
+
+    private:
+        std::vector<std::unique_ptr<storage_t[]>> slabs_;
+        std::size_t constructed_{0};
+        intrusive_list<t> active_;
+        intrusive_list<t> free_;
+    };
+
+}
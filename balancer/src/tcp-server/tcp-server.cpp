@@ -5,16 +5,39 @@
 
 namespace balancer {
 
-    tcp_server::tcp_server(std::uint16_t port, const route_map &route_map)
+    tcp_server::tcp_server(std::uint16_t port,
+                           const route_map_holder &route_map,
+                           const balancer_options &options,
+                           common::dns_cache &dns_cache,
+                           std::size_t worker_id,
+                           bool reuse_port)
         : port_{port}
         , route_map_{route_map}
-        , logger_{common::make_logger("tcp_server")}
+        , options_{options}
+        , dns_cache_{dns_cache}
+        , reuse_port_{reuse_port}
+        , logger_{common::make_logger("tcp_server#" + std::to_string(worker_id))}
+        , routing_policy_{make_routing_policy(options.routing_policy, route_map)}
     { }
 
     void tcp_server::start()
+    {
+        bind();
+        run();
+    }
+
+    void tcp_server::bind()
     {
         eb_ = common::event_base_ptr(event_base_new());
         check_null(eb_, "Can not create new event_base");
+        try {
+            resolver_ = std::make_unique<common::async_resolver>(eb_.get(), dns_cache_);
+            timeouts_ = std::make_unique<common::common_timeouts>(eb_.get(), options_.timeouts);
+            upstream_pool_ = std::make_unique<upstream_pool>(eb_.get(), *resolver_, *timeouts_, options_.upstream,
+                                                             stats_, logger_);
+        } catch (const std::exception &ex) {
+            log_error_stop_and_throw(ex.what());
+        }
 
         const sockaddr_in sock{common::make_sockaddr(INADDR_ANY, port_)};
 
@@ -25,13 +48,19 @@ namespace balancer {
             }
         };
 
-        const auto listener_options{LEV_OPT_CLOSE_ON_FREE|LEV_OPT_REUSEABLE};
+        auto listener_options{LEV_OPT_CLOSE_ON_FREE|LEV_OPT_REUSEABLE};
+        if(reuse_port_) {
+            listener_options |= LEV_OPT_REUSEABLE_PORT;
+        }
         listener_ = common::listener_ptr(
                     evconnlistener_new_bind(eb_.get(), accept_conn_cb, this, listener_options,
                                             -1, reinterpret_cast<const sockaddr*>(&sock), sizeof(sock))
                     );
         check_null(listener_, "Can not create new listener");
+    }
 
+    void tcp_server::run()
+    {
         LOG4CPLUS_INFO(logger_, "Start server");
         check_result_code(event_base_dispatch(eb_.get()), "Can not run event loop");
     }
@@ -43,9 +72,14 @@ namespace balancer {
             listener_.reset();
         }
 
-        for(const auto &session : sessions_) {
-            session->stop();
+        sessions_.for_each_active([](tcp_session &session) { session.stop(); });
+        // bufferevents of the sessions are freed before their event_base
+        sessions_.clear();
+
+        if(upstream_pool_) {
+            upstream_pool_->stop();
         }
+        resolver_.reset();
 
         if(eb_) {
             event_base_loopbreak(eb_.get());
@@ -53,13 +87,48 @@ namespace balancer {
         }
     }
 
+    const worker_stats &tcp_server::stats() const noexcept
+    {
+        return stats_;
+    }
+
+    event_base *tcp_server::base() const noexcept
+    {
+        return eb_.get();
+    }
+
+    const common::common_timeouts &tcp_server::timeouts() const noexcept
+    {
+        return *timeouts_;
+    }
+
+    common::async_resolver &tcp_server::resolver() noexcept
+    {
+        return *resolver_;
+    }
+
     void tcp_server::start_accept(evutil_socket_t socket, const std::string &client_addr)
     {
         LOG4CPLUS_INFO(logger_, "New client connection was accepted, client address: " << client_addr);
-        const auto session_it{sessions_.emplace(sessions_.end())};
-        const auto close_op{[this, session_it]() { sessions_.erase(session_it); }};
-        *session_it = std::make_unique<tcp_session>(eb_.get(), socket, close_op, route_map_, logger_);
-        (*session_it)->start();
+        increment(stats_.sessions_accepted);
+        tcp_session *session{nullptr};
+        try {
+            session = &sessions_.acquire(eb_.get(), *this, route_map_, *routing_policy_, *upstream_pool_,
+                                         options_.session, *timeouts_, stats_, logger_);
+        } catch (const std::exception &ex) {
+            LOG4CPLUS_ERROR(logger_, "Can not create session, error: " << ex.what());
+            increment(stats_.sessions_closed[static_cast<std::size_t>(close_reason::start_failed)]);
+            evutil_closesocket(socket);
+            return;
+        }
+        add(stats_.active_sessions, 1);
+        session->start(socket);
+    }
+
+    void tcp_server::on_session_closed(tcp_session &session)
+    {
+        add(stats_.active_sessions, -1);
+        sessions_.release(session);
     }
 
     void tcp_server::check_result_code(int result_code, const std::string &error_msg)
@@ -3,16 +3,42 @@
 #include "../common.h"
 #include <common/src/types.h>
 #include "../tcp-session/tcp-session.h"
-
-#include <list>
+#include "../upstream-pool/upstream-pool.h"
+#include "../stats/worker-stats.h"
+#include "object-pool.h"
+#include "io-worker.h"
 
 namespace balancer {
 
-    class tcp_server{
+    /*
+     * Sessions are taken from a pool: closed sessions are reused for new
+     * connections with their bufferevents and buffers, accept and close
+     * of a connection do not allocate once the pool has grown to the peak
+     * number of sessions.
+     */
+    class tcp_server
+        : public session_owner
+        , public io_worker
+        , public service_loop
+    {
     public:
-        tcp_server(std::uint16_t port, const route_map &route_map);
+        tcp_server(std::uint16_t port,
+                   const route_map_holder &route_map,
+                   const balancer_options &options,
+                   common::dns_cache &dns_cache,
+                   std::size_t worker_id = 0,
+                   bool reuse_port = false);
         void start();
-        void stop();
+        void stop() override;
+        void on_session_closed(tcp_session &session) override;
+        const worker_stats &stats() const noexcept override;
+        event_base *base() const noexcept override;
+        const common::common_timeouts &timeouts() const noexcept override;
+        common::async_resolver &resolver() noexcept override;
+
+        // start() is bind() followed by run()
+        void bind() override;
+        void run() override;
 
     private:
         void start_accept(evutil_socket_t socket, const std::string &client_addr);
@@ -30,11 +56,19 @@ namespace balancer {
 
     private:
         const std::uint16_t port_;
-        const route_map route_map_;
+        route_map_view route_map_;
+        const balancer_options &options_;
+        common::dns_cache &dns_cache_;
+        const bool reuse_port_;
         log4cplus::Logger logger_;
+        worker_stats stats_;
         common::event_base_ptr eb_;
         common::listener_ptr listener_;
-        std::list<std::unique_ptr<session_iface>> sessions_;
+        std::unique_ptr<routing_policy> routing_policy_;
+        std::unique_ptr<common::common_timeouts> timeouts_;
+        std::unique_ptr<common::async_resolver> resolver_;
+        std::unique_ptr<upstream_pool> upstream_pool_;
+        object_pool<tcp_session> sessions_;
     };
 
 }
@@ -0,0 +1,106 @@
+#include "input-scanner.h"
+
+#include <proto/src/bulk-decoder.h>
+
+#include <algorithm>
+
+namespace balancer {
+
+    input_scanner::input_scanner(std::size_t max_value_length, bool collect_values, bool decode_payloads)
+        : decode_payloads_{decode_payloads}
+        , parser_{max_value_length, collect_values}
+    { }
+
+    bool input_scanner::scan(evbuffer *input, input_observer &observer)
+    {
+        const std::size_t input_length{evbuffer_get_length(input)};
+        if(input_length <= scanned_bytes_) {
+            return true;
+        }
+
+        // only bytes which were not looked at yet
+        evbuffer_ptr start;
+        if(-1 == evbuffer_ptr_set(input, &start, scanned_bytes_, EVBUFFER_PTR_SET)) {
+            observer.on_invalid_input("can not seek in input buffer");
+            return false;
+        }
+        const auto data_length{static_cast<ev_ssize_t>(input_length - scanned_bytes_)};
+        const int chunks_count{evbuffer_peek(input, data_length, &start, nullptr, 0)};
+        chunks_.resize(static_cast<std::size_t>(chunks_count));
+        evbuffer_peek(input, data_length, &start, chunks_.data(), chunks_count);
+
+        std::size_t left{input_length - scanned_bytes_};
+        bool stopped{false};
+        for(const auto &chunk : chunks_) {
+            const std::size_t scanned_bytes{scanned_bytes_};
+            if(!scan_chunk(static_cast<const proto::byte *>(chunk.iov_base), std::min(chunk.iov_len, left),
+                           observer, stopped)) {
+                return false;
+            }
+            if(stopped) {
+                break;
+            }
+            left -= scanned_bytes_ - scanned_bytes;
+        }
+        return true;
+    }
+
+    std::size_t input_scanner::take_complete() noexcept
+    {
+        const std::size_t complete_bytes{complete_bytes_};
+        scanned_bytes_ -= complete_bytes;
+        complete_bytes_ = 0;
+        return complete_bytes;
+    }
+
+    void input_scanner::reset() noexcept
+    {
+        parser_.reset();
+        scanned_bytes_ = 0;
+        complete_bytes_ = 0;
+    }
+
+    bool input_scanner::scan_chunk(const proto::byte *data, std::size_t size, input_observer &observer, bool &stopped)
+    {
+        std::size_t pos{0};
+        while(pos < size) {
+            // runs of regular frames are checked in bulk, other frames
+            // and frames split between chunks go through the parser
+            const std::size_t run_count{parser_.at_frame_start() ? (size - pos) / proto::codec::regular_length : 0};
+            if(run_count > 0) {
+                payloads_.resize(decode_payloads_ ? run_count : 0);
+                const auto result{proto::decode_regular_frames(data + pos, run_count,
+                                                               decode_payloads_ ? payloads_.data() : nullptr)};
+                observer.on_regular_frames(decode_payloads_ ? payloads_.data() : nullptr, result.valid_frames);
+                const std::size_t valid_bytes{result.valid_frames * proto::codec::regular_length};
+                pos += valid_bytes;
+                scanned_bytes_ += valid_bytes;
+                complete_bytes_ = scanned_bytes_;
+                if(result.ok()) {
+                    continue;
+                }
+            }
+
+            const std::size_t consumed{parser_.feed(data + pos, size - pos)};
+            pos += consumed;
+            scanned_bytes_ += consumed;
+            if(parser_.failed()) {
+                observer.on_invalid_input(parser_.error());
+                return false;
+            }
+            if(parser_.complete()) {
+                const auto action{observer.on_frame(parser_.frame())};
+                if(scan_action::reject == action) {
+                    return false;
+                }
+                complete_bytes_ = scanned_bytes_;
+                if(scan_action::stop == action) {
+                    stopped = true;
+                    return true;
+                }
+            }
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <common/src/types.h>
+#include <proto/src/codec.h>
+#include <proto/src/stream-parser.h>
+
+#include <string>
+#include <vector>
+
+namespace balancer {
+
+    // What the scan does after a frame that went through the parser
+    enum class scan_action {
+        next,   // go on with the next frame
+        stop,   // stop, the frame is complete and the rest is scanned later
+        reject  // the frame is invalid, it is not complete
+    };
+
+    class input_observer {
+    public:
+        virtual ~input_observer() = default;
+        // 'payloads' is nullptr if the scanner does not decode them
+        virtual void on_regular_frames(const std::uint32_t *payloads, std::size_t count) = 0;
+        virtual scan_action on_frame(const proto::frame_info &frame) = 0;
+        virtual void on_invalid_input(const std::string &error) = 0;
+    };
+
+    /*
+     * Scans a client input buffer in place: chains are peeked without copying,
+     * runs of regular frames are checked in bulk, other frames and frames
+     * split between chains go through the parser. Scanned bytes are not looked
+     * at again, complete frames among them stay in the buffer until the owner
+     * takes them to forward.
+     */
+    class input_scanner {
+    public:
+        // payloads of regular frames are decoded in bulk only with 'decode_payloads'
+        input_scanner(std::size_t max_value_length, bool collect_values, bool decode_payloads);
+
+    public:
+        // Returns false if the input is invalid, frames before the invalid one stay complete
+        bool scan(evbuffer *input, input_observer &observer);
+        // Length of complete frames at the front of the input, they are not scanned
+        // again, the caller removes them from the input
+        std::size_t take_complete() noexcept;
+        void reset() noexcept;
+
+    private:
+        // Returns false if the input is invalid, 'stopped' is set by the observer
+        bool scan_chunk(const proto::byte *data, std::size_t size, input_observer &observer, bool &stopped);
+
+    private:
+        const bool decode_payloads_;
+        proto::stream_parser parser_;
+        std::vector<evbuffer_iovec> chunks_;
+        std::vector<std::uint32_t> payloads_;
+        // bytes at the front of the input buffer which are already parsed
+        std::size_t scanned_bytes_{0};
+        std::size_t complete_bytes_{0};
+    };
+
+}
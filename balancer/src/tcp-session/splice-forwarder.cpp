@@ -0,0 +1,234 @@
+#include "splice-forwarder.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdexcept>
+
+namespace {
+
+    // a bigger pipe moves more bytes per splice call, the kernel may refuse it
+    const int requested_pipe_size{256 * 1024};
+    // a busy client gives way to other sessions of the loop after this many rounds
+    const std::size_t max_rounds{16};
+    const unsigned int splice_flags{SPLICE_F_MOVE | SPLICE_F_NONBLOCK};
+
+    bool is_retriable(int error) noexcept
+    {
+        return EAGAIN == error || EWOULDBLOCK == error || EINTR == error;
+    }
+
+}
+
+namespace balancer {
+
+    splice_forwarder::splice_forwarder(event_base *base, worker_stats &stats, close_op_t close_op)
+        : base_{base}
+        , stats_{stats}
+        , close_op_{std::move(close_op)}
+        , client_event_{common::event_ptr(event_new(base, -1, 0, nullptr, nullptr))}
+        , upstream_event_{common::event_ptr(event_new(base, -1, 0, nullptr, nullptr))}
+    {
+        if(!client_event_ || !upstream_event_) {
+            throw std::runtime_error{"Can not create splice events"};
+        }
+    }
+
+    splice_forwarder::~splice_forwarder()
+    {
+        stop();
+        close_pipe();
+    }
+
+    bool splice_forwarder::start(evutil_socket_t client_socket, evbuffer *pending, evutil_socket_t upstream_socket,
+                                 const timeval *idle_timeout, const timeval *write_timeout,
+                                 client_stats &client_stats, backend_traffic &backend_traffic)
+    {
+        if(!open_pipe()) {
+            return false;
+        }
+        // events are not pending, so they can be assigned to the sockets of this session
+        if(-1 == event_assign(client_event_.get(), base_, client_socket, EV_READ | EV_PERSIST,
+                              splice_forwarder::on_client_event_cb, this)
+                || -1 == event_assign(upstream_event_.get(), base_, upstream_socket, EV_WRITE,
+                                      splice_forwarder::on_upstream_event_cb, this)) {
+            return false;
+        }
+        upstream_socket_ = upstream_socket;
+        pending_ = pending;
+        idle_timeout_ = idle_timeout;
+        write_timeout_ = write_timeout;
+        client_stats_ = &client_stats;
+        backend_traffic_ = &backend_traffic;
+        active_ = true;
+
+        // bytes kept while connecting were not scanned, so they were not counted yet
+        add(client_stats_->bytes_in, evbuffer_get_length(pending_));
+        if(flush()) {
+            resume_reading();
+        }
+        return true;
+    }
+
+    void splice_forwarder::stop() noexcept
+    {
+        if(!active_) {
+            return;
+        }
+        active_ = false;
+        event_del(client_event_.get());
+        event_del(upstream_event_.get());
+        pending_ = nullptr;
+        upstream_socket_ = -1;
+        // bytes left in the pipe belong to the closed session
+        if(0 != pipe_bytes_) {
+            close_pipe();
+        }
+    }
+
+    bool splice_forwarder::is_active() const noexcept
+    {
+        return active_;
+    }
+
+    bool splice_forwarder::open_pipe() noexcept
+    {
+        if(-1 != pipe_[0]) {
+            return true;
+        }
+        if(-1 == pipe2(pipe_, O_NONBLOCK | O_CLOEXEC)) {
+            pipe_[0] = pipe_[1] = -1;
+            return false;
+        }
+        fcntl(pipe_[1], F_SETPIPE_SZ, requested_pipe_size);
+        const int pipe_size{fcntl(pipe_[1], F_GETPIPE_SZ)};
+        pipe_size_ = pipe_size > 0 ? static_cast<std::size_t>(pipe_size) : 64 * 1024;
+        return true;
+    }
+
+    void splice_forwarder::close_pipe() noexcept
+    {
+        for(auto &fd : pipe_) {
+            if(-1 != fd) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        pipe_bytes_ = 0;
+    }
+
+    bool splice_forwarder::fill_pipe()
+    {
+        const auto spliced{splice(event_get_fd(client_event_.get()), nullptr, pipe_[1], nullptr,
+                                  pipe_size_ - pipe_bytes_, splice_flags)};
+        if(spliced > 0) {
+            pipe_bytes_ += static_cast<std::size_t>(spliced);
+            add(client_stats_->bytes_in, static_cast<std::size_t>(spliced));
+            return true;
+        }
+        if(0 == spliced) {
+            // everything the client sent is written to the backend by now
+            close(close_reason::client_closed);
+        } else if(!is_retriable(errno)) {
+            close(close_reason::io_error);
+        }
+        return false;
+    }
+
+    bool splice_forwarder::flush()
+    {
+        while(0 != evbuffer_get_length(pending_)) {
+            const int written{evbuffer_write(pending_, upstream_socket_)};
+            if(written < 0) {
+                if(is_retriable(errno)) {
+                    wait_for_upstream();
+                } else {
+                    close(close_reason::upstream_closed);
+                }
+                return false;
+            }
+            count_sent(static_cast<std::size_t>(written));
+        }
+        while(0 != pipe_bytes_) {
+            const auto spliced{splice(pipe_[0], nullptr, upstream_socket_, nullptr, pipe_bytes_, splice_flags)};
+            if(spliced < 0) {
+                if(is_retriable(errno)) {
+                    wait_for_upstream();
+                } else {
+                    close(close_reason::upstream_closed);
+                }
+                return false;
+            }
+            pipe_bytes_ -= static_cast<std::size_t>(spliced);
+            count_sent(static_cast<std::size_t>(spliced));
+        }
+        return true;
+    }
+
+    void splice_forwarder::wait_for_upstream()
+    {
+        event_del(client_event_.get());
+        if(-1 == event_add(upstream_event_.get(), write_timeout_)) {
+            close(close_reason::io_error);
+        }
+    }
+
+    void splice_forwarder::resume_reading()
+    {
+        if(-1 == event_add(client_event_.get(), idle_timeout_)) {
+            close(close_reason::io_error);
+        }
+    }
+
+    void splice_forwarder::count_sent(std::size_t bytes) noexcept
+    {
+        add(client_stats_->bytes_out, bytes);
+        add(backend_traffic_->bytes_out, bytes);
+        add(backend_traffic_->sent_bytes, bytes);
+    }
+
+    void splice_forwarder::close(close_reason reason)
+    {
+        stop();
+        // can reuse the session of this forwarder, must be the last call
+        close_op_(reason);
+    }
+
+    void splice_forwarder::on_client_event(short what)
+    {
+        if(what & EV_TIMEOUT) {
+            close(close_reason::idle_timeout);
+            return;
+        }
+        for(std::size_t round = 0; round < max_rounds; ++round) {
+            if(!fill_pipe() || !flush()) {
+                return;
+            }
+        }
+    }
+
+    void splice_forwarder::on_upstream_event(short what)
+    {
+        if(what & EV_TIMEOUT) {
+            increment(stats_.upstream_timeouts);
+            close(close_reason::upstream_closed);
+            return;
+        }
+        if(flush()) {
+            resume_reading();
+        }
+    }
+
+    void splice_forwarder::on_client_event_cb(evutil_socket_t /*fd*/, short what, void *ctx)
+    {
+        auto *self{static_cast<splice_forwarder *>(ctx)};
+        self->on_client_event(what);
+    }
+
+    void splice_forwarder::on_upstream_event_cb(evutil_socket_t /*fd*/, short what, void *ctx)
+    {
+        auto *self{static_cast<splice_forwarder *>(ctx)};
+        self->on_upstream_event(what);
+    }
+
+}
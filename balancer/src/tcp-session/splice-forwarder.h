@@ -0,0 +1,68 @@
+#pragma once
+
+#include <common/src/types.h>
+#include "../stats/worker-stats.h"
+#include "../route-map/backend.h"
+
+#include <functional>
+
+namespace balancer {
+
+    /*
+     * Moves the stream of a trusted client to its dedicated upstream connection
+     * with splice() through a pipe, so the bytes never enter user space.
+     * Frames are neither checked nor counted, only bytes are. Bytes that are
+     * already in the client input buffer are written to the backend first.
+     * While the backend does not take data, reading from the client is paused.
+     * Events are reassigned to the sockets of every session and the pipe is
+     * kept while it is empty, so a reused forwarder allocates nothing.
+     */
+    class splice_forwarder {
+        using close_op_t = std::function<void(close_reason)>;
+
+    public:
+        splice_forwarder(event_base *base, worker_stats &stats, close_op_t close_op);
+        ~splice_forwarder();
+
+    public:
+        // returns false if there is no pipe, the caller stays on the evbuffer path then
+        bool start(evutil_socket_t client_socket, evbuffer *pending, evutil_socket_t upstream_socket,
+                   const timeval *idle_timeout, const timeval *write_timeout,
+                   client_stats &client_stats, backend_traffic &backend_traffic);
+        void stop() noexcept;
+        bool is_active() const noexcept;
+
+    private:
+        bool open_pipe() noexcept;
+        void close_pipe() noexcept;
+        // Both return false if the forwarder waits for a socket or is closed
+        bool fill_pipe();
+        bool flush();
+        void wait_for_upstream();
+        void resume_reading();
+        void count_sent(std::size_t bytes) noexcept;
+        void close(close_reason reason);
+        void on_client_event(short what);
+        void on_upstream_event(short what);
+        static void on_client_event_cb(evutil_socket_t /*fd*/, short what, void *ctx);
+        static void on_upstream_event_cb(evutil_socket_t /*fd*/, short what, void *ctx);
+
+    private:
+        event_base *base_;
+        worker_stats &stats_;
+        const close_op_t close_op_;
+        common::event_ptr client_event_;
+        common::event_ptr upstream_event_;
+        int pipe_[2]{-1, -1};
+        std::size_t pipe_size_{0};
+        std::size_t pipe_bytes_{0};
+        evutil_socket_t upstream_socket_{-1};
+        evbuffer *pending_{nullptr};
+        const timeval *idle_timeout_{nullptr};
+        const timeval *write_timeout_{nullptr};
+        client_stats *client_stats_{nullptr};
+        backend_traffic *backend_traffic_{nullptr};
+        bool active_{false};
+    };
+
+}
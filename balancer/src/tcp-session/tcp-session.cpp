@@ -1,51 +1,153 @@
 #include "tcp-session.h"
 
+#include <random>
+#include <algorithm>
+
+#include <common/src/log-sampler.h>
 #include <log4cplus/loggingmacros.h>
 
+namespace {
+
+    // every worker thread has its own generator for retry jitter
+    thread_local std::minstd_rand retry_random{std::random_device{}()};
+
+}
+
 namespace balancer {
 
     tcp_session::tcp_session(event_base *base,
-                             evutil_socket_t socket,
-                             close_op_t close_op,
-                             const route_map &route_map,
+                             session_owner &owner,
+                             route_map_view &route_map,
+                             routing_policy &routing_policy,
+                             upstream_pool &upstream_pool,
+                             const session_options &options,
+                             const common::common_timeouts &timeouts,
+                             worker_stats &stats,
                              log4cplus::Logger &logger)
-        : close_op_{std::move(close_op)}
+        : owner_{owner}
         , route_map_{route_map}
-        , client_buffer_{common::bufferevent_ptr(bufferevent_socket_new(base, socket, BEV_OPT_CLOSE_ON_FREE))}
+        , routing_policy_{routing_policy}
+        , upstream_pool_{upstream_pool}
+        , options_{options}
+        , timeouts_{timeouts}
+        , stats_{stats}
+        , client_buffer_{common::bufferevent_ptr(bufferevent_socket_new(base, -1, BEV_OPT_CLOSE_ON_FREE))}
+        , retry_timer_{common::event_ptr(evtimer_new(base, tcp_session::on_retry_timer_cb, this))}
+        , splicer_{base, stats, [this](close_reason reason) { drop_session(reason); }}
+        , scanner_{options.max_value_length,
+                   forwarding_mode::parse == options.forwarding || batch_mode::unpack == options.batches,
+                   forwarding_mode::parse == options.forwarding}
         , logger_{logger}
-    { }
+    {
+        check_null(client_buffer_, "Can not create client bufferevent");
+        check_null(retry_timer_, "Can not create connect retry timer");
+    }
 
-    void tcp_session::start()
+    void tcp_session::start(evutil_socket_t socket)
     {
         try {
-            check_null(client_buffer_, "Invalid client bufferevent");
+            reset();
+            if(-1 == bufferevent_setfd(client_buffer_.get(), socket)) {
+                evutil_closesocket(socket);
+                throw std::runtime_error{"Can not attach client socket to bufferevent"};
+            }
             LOG4CPLUS_INFO(logger_, "Start new unknown session");
             start_reading_init_message();
         } catch (const std::exception &ex) {
             LOG4CPLUS_ERROR(logger_, "Can not start session with error: " << ex.what());
-            drop_session();
+            drop_session(close_reason::start_failed);
         } catch (...) {
             LOG4CPLUS_ERROR(logger_, "Can not start session with unknown error");
-            drop_session();
+            drop_session(close_reason::start_failed);
         }
     }
 
     void tcp_session::stop()
     {
-        if(client_buffer_) {
-            bufferevent_disable(client_buffer_.get(), EV_READ);
-            client_buffer_.reset();
+        evtimer_del(retry_timer_.get());
+        // the spliced sockets are closed below
+        splicer_.stop();
+        close_client_socket();
+        if(upstream_) {
+            upstream_pool_.release(upstream_, *this);
+            upstream_.reset();
+        }
+        failed_backend_.reset();
+    }
+
+    void tcp_session::reset() noexcept
+    {
+        state_ = session_state::handshake;
+        client_id_ = 0;
+        trusted_ = false;
+        connect_attempts_ = 0;
+        client_eof_ = false;
+        client_stats_ = nullptr;
+        pending_frames_ = 0;
+        scanner_.reset();
+        batch_bytes_ = 0;
+        unpacked_.clear();
+    }
+
+    void tcp_session::close_client_socket() noexcept
+    {
+        auto *buff{client_buffer_.get()};
+        const evutil_socket_t socket{bufferevent_getfd(buff)};
+        if(-1 == socket) {
+            return;
         }
-        if(server_buffer_) {
-            bufferevent_disable(server_buffer_.get(), EV_WRITE);
-            server_buffer_.reset();
+        bufferevent_disable(buff, EV_READ | EV_WRITE);
+        bufferevent_setcb(buff, nullptr, nullptr, nullptr, nullptr);
+        bufferevent_set_timeouts(buff, nullptr, nullptr);
+        // the bufferevent is kept for the next connection
+        bufferevent_setfd(buff, -1);
+        evutil_closesocket(socket);
+        auto *input{bufferevent_get_input(buff)};
+        evbuffer_drain(input, evbuffer_get_length(input));
+        auto *output{bufferevent_get_output(buff)};
+        evbuffer_drain(output, evbuffer_get_length(output));
+    }
+
+    void tcp_session::on_upstream_connected()
+    {
+        if(session_state::connecting == state_) {
+            start_forwarding();
+        }
+    }
+
+    void tcp_session::on_upstream_closed()
+    {
+        // nothing is forwarded before the connect, so a failed one loses no messages
+        if(session_state::connecting == state_) {
+            schedule_retry();
+            return;
         }
+        LOG4CPLUS_INFO(logger_, "Upstream connection is closed, close session");
+        drop_session(close_reason::upstream_closed);
     }
 
-    void tcp_session::drop_session()
+    void tcp_session::on_upstream_throttled()
     {
+        increment(stats_.session_pauses);
+        bufferevent_disable(client_buffer_.get(), EV_READ);
+    }
+
+    void tcp_session::on_upstream_drained()
+    {
+        if(-1 == bufferevent_enable(client_buffer_.get(), EV_READ)) {
+            LOG4CPLUS_ERROR(logger_, "Can not resume reading from client");
+            drop_session(close_reason::io_error);
+            return;
+        }
+        process_client_input();
+    }
+
+    void tcp_session::drop_session(close_reason reason)
+    {
+        increment(stats_.sessions_closed[static_cast<std::size_t>(reason)]);
         stop();
-        close_op_();
+        // the session can be reused by the owner right away, must be the last call
+        owner_.on_session_closed(*this);
     }
 
     void tcp_session::start_reading_init_message()
@@ -54,91 +156,361 @@ namespace balancer {
             auto *self{static_cast<tcp_session *>(ctx)};
             self->read_init_message();
         };
-        prepare_client_buffer_for_reading(read_cd, proto::init_message::message_length(), 0);
+        prepare_client_buffer_for_reading(read_cd, proto::codec::init_length, 0, timeouts_.handshake());
     }
 
     void tcp_session::read_init_message()
     {
-        const auto msg{read_message<proto::init_message>()};
-        if(msg.type() == proto::message_type::init) {
-            LOG4CPLUS_INFO(logger_, "We connected with client: " << msg.client_id());
-            start_routing(msg.client_id());
+        // the read callback is called only when the whole frame is in the input buffer
+        proto::codec::init_frame frame;
+        bufferevent_read(client_buffer_.get(), frame.data(), frame.size());
+        if(proto::codec::check_header(frame.data(), proto::message_type::init)) {
+            const proto::init_message::client_id_t client_id{proto::codec::load_value(frame.data())};
+            LOG4CPLUS_INFO(logger_, "We connected with client: " << client_id);
+            start_routing(client_id);
         } else {
-            const auto type_uint{static_cast<std::uint32_t>(msg.type())};
+            const auto type_uint{static_cast<std::uint32_t>(proto::codec::load_type(frame.data()))};
             LOG4CPLUS_ERROR(logger_, "Invalid init message, type is " << type_uint);
-            drop_session();
+            drop_session(close_reason::invalid_init);
         }
     }
 
     void tcp_session::start_routing(proto::init_message::client_id_t client_id)
     {
-        const auto server_it = route_map_.find(client_id);
-        if(route_map_.cend() != server_it) {
-            try {
-                auto &srv{server_it->second};
-                connect_to_server(srv);
-                LOG4CPLUS_INFO(logger_, "Start routing packets from clietn "
-                               << client_id << " to server " << srv);
-                start_reading_regular_message();
-            } catch (const std::exception &ex) {
-                LOG4CPLUS_ERROR(logger_, "Can not start routing, error: " << ex.what());
-                drop_session();
-            } catch (...) {
-                LOG4CPLUS_ERROR(logger_, "Can not start routing with unknown error");
-                drop_session();
-            }
-        } else {
-            LOG4CPLUS_ERROR(logger_, "Have no information about client: " << client_id);
-            drop_session();
+        client_id_ = client_id;
+        if(route_to_backend()) {
+            start_reading_regular_message();
         }
     }
 
-    void tcp_session::connect_to_server(const common::remote_server &server)
+    bool tcp_session::route_to_backend()
     {
-        server_buffer_ =
-                common::bufferevent_ptr(bufferevent_socket_new(bufferevent_get_base(client_buffer_.get()),
-                                                               -1, BEV_OPT_CLOSE_ON_FREE));
-        check_null(server_buffer_, "Invalid server bufferevent");
+        // the snapshot is kept until the backend is chosen, the session
+        // keeps its backend even if the route map is reloaded later
+        const auto route_map{route_map_.get()};
+        const auto *group{route_map->find(client_id_)};
+        if(nullptr == group) {
+            // a reloaded route map can drop the client while its session retries
+            LOG4CPLUS_ERROR(logger_, "Have no information about client: " << client_id_);
+            drop_session(close_reason::unknown_client);
+            return false;
+        }
+        if(nullptr == client_stats_) {
+            // only routed clients take slots in the stats table
+            client_stats_ = &stats_.clients.find(client_id_);
+        }
+        trusted_ = route_map->is_trusted(client_id_);
 
-        auto *buff{server_buffer_.get()};
-        bufferevent_setcb(buff, nullptr, nullptr, tcp_session::on_event_cb, this);
-        check_result_code(bufferevent_enable(buff, EV_WRITE), "Can not enable server bufferevent for reading");
+        const auto *backend{routing_policy_.choose(*group, failed_backend_.get())};
+        if(nullptr == backend && failed_backend_) {
+            // the failed backend is tried again if no other one is available
+            backend = routing_policy_.choose(*group, nullptr);
+        }
+        if(nullptr == backend) {
+            LOG4CPLUS_ERROR(logger_, "All servers of client " << client_id_ << " are ejected");
+            drop_session(close_reason::no_healthy_backend);
+            return false;
+        }
+        (*backend)->health().on_routed(std::chrono::steady_clock::now());
+        if(!connect_to_server(*backend)) {
+            return false;
+        }
+        LOG4CPLUS_INFO(logger_, "Start routing packets from clietn "
+                       << client_id_ << " to server " << (*backend)->server());
+        // a pooled connection can be established already
+        state_ = upstream_->is_connected() ? session_state::forwarding : session_state::connecting;
+        return true;
+    }
 
-        const auto sock{server.sockaddr()};
-        check_result_code(
-                    bufferevent_socket_connect(buff,
-                                               reinterpret_cast<const sockaddr *>(&sock),
-                                               sizeof(sock)),
-                    "Can not start connection procedure to server");
+    bool tcp_session::connect_to_server(const backend_ptr &backend)
+    {
+        try {
+            upstream_ = upstream_pool_.acquire(backend, *this);
+        } catch (const std::exception &ex) {
+            LOG4CPLUS_ERROR(logger_, "Can not start routing, error: " << ex.what());
+            drop_session(close_reason::routing_failed);
+            return false;
+        } catch (...) {
+            LOG4CPLUS_ERROR(logger_, "Can not start routing with unknown error");
+            drop_session(close_reason::routing_failed);
+            return false;
+        }
+        return true;
     }
 
     void tcp_session::start_reading_regular_message()
     {
         const auto read_cd = [](bufferevent */*buffer*/, void *ctx) {
             auto *self{static_cast<tcp_session *>(ctx)};
-            self->read_regular_message();
+            // until the upstream connection is established messages are kept in the input buffer
+            if(session_state::forwarding == self->state_) {
+                self->process_client_input();
+            }
         };
+        // paused reading is not limited, the session waits for its upstream
+        const std::size_t highmark{session_state::forwarding == state_ ? 0 : options_.max_pending_bytes};
+        try {
+            prepare_client_buffer_for_reading(read_cd, proto::codec::regular_length, highmark, timeouts_.idle());
+        } catch (const std::exception &ex) {
+            LOG4CPLUS_ERROR(logger_, "Can not start routing, error: " << ex.what());
+            drop_session(close_reason::routing_failed);
+            return;
+        }
+        if(session_state::forwarding == state_) {
+            start_forwarding();
+        }
+    }
+
+    void tcp_session::start_forwarding()
+    {
+        state_ = session_state::forwarding;
+        failed_backend_.reset();
+        if(can_splice()) {
+            start_splicing();
+            return;
+        }
+        // from now on reading is limited by the watermarks of the upstream connection
+        bufferevent_setwatermark(client_buffer_.get(), EV_READ, proto::codec::regular_length, 0);
+        if(upstream_->is_throttled()) {
+            on_upstream_throttled();
+            return;
+        }
+        // Messages received together with the init message or while connecting are already
+        // in the input buffer and the read callback will not be called for them until new data arrives
+        if(process_client_input() && client_eof_) {
+            LOG4CPLUS_INFO(logger_, "Kept messages are forwarded, close session");
+            drop_session(close_reason::client_closed);
+        }
+    }
 
-        prepare_client_buffer_for_reading(read_cd, proto::regular_message::message_length(), 0);
+    bool tcp_session::can_splice() const noexcept
+    {
+        // a shared connection would mix the stream with frames of other
+        // sessions, and compression needs the bytes in user space
+        return options_.splice_trusted && trusted_
+                && forwarding_mode::parse != options_.forwarding
+                && batch_mode::forward == options_.batches
+                && upstream_->is_dedicated()
+                && common::compression_type::none == upstream_->compression();
     }
 
-    void tcp_session::read_regular_message()
+    void tcp_session::start_splicing()
     {
-        const auto msg{read_message<proto::regular_message>()};
-        LOG4CPLUS_INFO(logger_, "Message with payload '" << msg.payload() << "' has been received");
-        write_regular_message(msg.as_bytes());
+        auto *buff{client_buffer_.get()};
+        // the bufferevent keeps the socket but does not touch it until the session is closed
+        bufferevent_disable(buff, EV_READ);
+        bufferevent_set_timeouts(buff, nullptr, nullptr);
+        LOG4CPLUS_INFO(logger_, "Splice stream of client " << client_id_ << " to the server");
+        // bytes kept while connecting are written first, a client that has already
+        // closed the connection is noticed by the first splice, the session can be
+        // closed by the forwarder right away
+        if(!splicer_.start(bufferevent_getfd(buff), bufferevent_get_input(buff), upstream_->socket(),
+                           timeouts_.idle(), timeouts_.write(), *client_stats_, upstream_->traffic())) {
+            LOG4CPLUS_ERROR(logger_, "Can not open splice pipe, forward stream of client " << client_id_ << " by buffers");
+            trusted_ = false;
+            start_forwarding();
+        }
     }
 
-    void tcp_session::write_regular_message(const proto::bytes &msg)
+    void tcp_session::schedule_retry()
     {
-        bufferevent_write(server_buffer_.get(), msg.data(), msg.size());
+        failed_backend_ = upstream_->backend();
+        upstream_pool_.release(upstream_, *this);
+        upstream_.reset();
+        if(connect_attempts_ >= options_.connect_retries) {
+            LOG4CPLUS_ERROR(logger_, "Can not connect to server " << failed_backend_->server()
+                            << " after " << connect_attempts_ + 1 << " attempt(s), close session");
+            drop_session(close_reason::connect_failed);
+            return;
+        }
+
+        const auto delay{next_retry_delay()};
+        ++connect_attempts_;
+        increment(stats_.connect_retries);
+        state_ = session_state::retrying;
+        const timeval timeout{static_cast<time_t>(delay.count() / 1000),
+                              static_cast<suseconds_t>(delay.count() % 1000 * 1000)};
+        if(-1 == evtimer_add(retry_timer_.get(), &timeout)) {
+            LOG4CPLUS_ERROR(logger_, "Can not start connect retry timer, close session");
+            drop_session(close_reason::connect_failed);
+            return;
+        }
+        LOG4CPLUS_INFO(logger_, "Can not connect to server " << failed_backend_->server()
+                       << ", retry in " << delay.count() << " ms");
+    }
+
+    void tcp_session::retry_connect()
+    {
+        if(route_to_backend() && session_state::forwarding == state_) {
+            start_forwarding();
+        }
+    }
+
+    std::chrono::milliseconds tcp_session::next_retry_delay()
+    {
+        // exponential backoff with equal jitter: half of the delay is random,
+        // so sessions that failed together do not retry together
+        const std::uint32_t shift{std::min<std::uint32_t>(connect_attempts_, 16)};
+        const auto backoff{std::min(options_.retry_delay * (1 << shift), options_.max_retry_delay)};
+        std::uniform_int_distribution<std::chrono::milliseconds::rep> jitter{0, backoff.count() / 2};
+        return backoff - backoff / 2 + std::chrono::milliseconds{jitter(retry_random)};
+    }
+
+    bool tcp_session::process_client_input()
+    {
+        auto *input{bufferevent_get_input(client_buffer_.get())};
+        bool valid{true};
+        do {
+            valid = scanner_.scan(input, *this);
+            const std::size_t batch_bytes{batch_bytes_};
+            const std::size_t complete_bytes{scanner_.take_complete() - batch_bytes};
+            batch_bytes_ = 0;
+            if(complete_bytes > 0 && !forward_messages(input, complete_bytes)) {
+                return false;
+            }
+            if(0 == batch_bytes) {
+                break;
+            }
+            evbuffer_drain(input, batch_bytes);
+            if(!forward_unpacked_batch()) {
+                return false;
+            }
+        } while(valid);
+
+        if(!valid) {
+            drop_session(close_reason::invalid_frame);
+        }
+        return valid;
+    }
+
+    void tcp_session::on_regular_frames(const std::uint32_t *payloads, std::size_t count)
+    {
+        for(std::size_t msg_idx = 0; nullptr != payloads && msg_idx < count; ++msg_idx) {
+            COMMON_LOG_SAMPLED_INFO(logger_, common::log_category::message,
+                                    "Message with payload '" << payloads[msg_idx] << "' has been received");
+        }
+        add(client_stats_->frames_in, count);
+        add(client_stats_->bytes_in, count * proto::codec::regular_length);
+        pending_frames_ += count;
+    }
+
+    scan_action tcp_session::on_frame(const proto::frame_info &frame)
+    {
+        if(proto::message_type::init == frame.type) {
+            LOG4CPLUS_ERROR(logger_, "Unexpected init message from client, close session");
+            return scan_action::reject;
+        }
+        const bool parse{forwarding_mode::parse == options_.forwarding};
+        increment(client_stats_->frames_in);
+        add(client_stats_->bytes_in, frame.length);
+        if(proto::message_type::batch == frame.type) {
+            if(parse) {
+                for(std::size_t value_pos = 0; value_pos < frame.value_length; value_pos += sizeof(std::uint32_t)) {
+                    COMMON_LOG_SAMPLED_INFO(logger_, common::log_category::message,
+                                            "Message with payload '" << proto::codec::load_uint32(frame.value + value_pos)
+                                            << "' has been received in batch");
+                }
+            }
+            if(batch_mode::unpack == options_.batches) {
+                // the rest of the input is scanned after the batch is replaced
+                unpack_batch(frame);
+                return scan_action::stop;
+            }
+            ++pending_frames_;
+        } else {
+            ++pending_frames_;
+            if(parse && (nullptr != frame.value || 0 == frame.value_length)) {
+                COMMON_LOG_SAMPLED_INFO(logger_, common::log_category::message,
+                                        "Message with payload '"
+                                        << proto::format_value(frame.kind, frame.value, frame.value_length)
+                                        << "' has been received");
+            }
+        }
+        return scan_action::next;
+    }
+
+    void tcp_session::on_invalid_input(const std::string &error)
+    {
+        LOG4CPLUS_ERROR(logger_, "Invalid message from client: " << error << ", close session");
+    }
+
+    void tcp_session::unpack_batch(const proto::frame_info &frame)
+    {
+        const std::size_t count{frame.value_length / sizeof(std::uint32_t)};
+        unpacked_.resize(count * proto::codec::regular_length);
+        for(std::size_t idx = 0; idx < count; ++idx) {
+            proto::codec::store_regular(unpacked_.data() + idx * proto::codec::regular_length,
+                                        proto::codec::load_uint32(frame.value + idx * sizeof(std::uint32_t)));
+        }
+        batch_bytes_ = frame.length;
+    }
+
+    bool tcp_session::forward_unpacked_batch()
+    {
+        if(unpacked_.empty()) {
+            return true;
+        }
+        try {
+            upstream_->write(unpacked_);
+        } catch (const std::exception &ex) {
+            LOG4CPLUS_ERROR(logger_, "Can not forward messages, error: " << ex.what());
+            drop_session(close_reason::io_error);
+            return false;
+        }
+        count_forwarded(unpacked_.size() / proto::codec::regular_length, unpacked_.size());
+        return true;
+    }
+
+    bool tcp_session::forward_messages(evbuffer *input, std::size_t length)
+    {
+        try {
+            if(forwarding_mode::zero_copy == options_.forwarding) {
+                upstream_->move_from(input, length);
+            } else {
+                batch_.resize(length);
+                if(-1 == evbuffer_remove(input, batch_.data(), batch_.size())) {
+                    throw std::runtime_error{"Can not read messages from client buffer"};
+                }
+                upstream_->write(batch_);
+            }
+        } catch (const std::exception &ex) {
+            LOG4CPLUS_ERROR(logger_, "Can not forward messages, error: " << ex.what());
+            drop_session(close_reason::io_error);
+            return false;
+        }
+        count_forwarded(pending_frames_, length);
+        pending_frames_ = 0;
+        return true;
+    }
+
+    void tcp_session::count_forwarded(std::size_t frames, std::size_t bytes) noexcept
+    {
+        add(client_stats_->frames_out, frames);
+        add(client_stats_->bytes_out, bytes);
+        auto &traffic{upstream_->traffic()};
+        add(traffic.frames_out, frames);
+        add(traffic.bytes_out, bytes);
     }
 
     void tcp_session::on_next_event(short what)
     {
+        if(what & BEV_EVENT_TIMEOUT) {
+            const bool handshake{session_state::handshake == state_};
+            LOG4CPLUS_INFO(logger_, (handshake ? "Init message was not received in time" : "Client was idle too long")
+                           << ", close session");
+            drop_session(handshake ? close_reason::handshake_timeout : close_reason::idle_timeout);
+            return;
+        }
+        if(what & BEV_EVENT_EOF && !(what & BEV_EVENT_ERROR)
+                && (session_state::connecting == state_ || session_state::retrying == state_)) {
+            // the kept messages are forwarded when the upstream connection is established
+            LOG4CPLUS_INFO(logger_, "Client closed connection before upstream connection is established");
+            client_eof_ = true;
+            return;
+        }
         if(what & BEV_EVENT_EOF || what & BEV_EVENT_ERROR) {
             LOG4CPLUS_INFO(logger_, "Close session");
-            drop_session();
+            drop_session(what & BEV_EVENT_ERROR ? close_reason::io_error : close_reason::client_closed);
         }
     }
 
@@ -148,7 +520,13 @@ namespace balancer {
         self->on_next_event(what);
     }
 
-    void tcp_session::check_result_code(int result_code, const std::string &error_msg)
+    void tcp_session::on_retry_timer_cb(evutil_socket_t /*fd*/, short /*what*/, void *ctx)
+    {
+        auto *self{static_cast<tcp_session *>(ctx)};
+        self->retry_connect();
+    }
+
+    void tcp_session::check_result_code(int result_code, const char *error_msg)
     {
         if(-1 == result_code) {
             throw std::runtime_error{error_msg};
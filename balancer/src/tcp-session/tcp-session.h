@@ -3,77 +3,128 @@
 #include "../common.h"
 #include <common/src/types.h>
 #include <proto/src/init-message.h>
-#include <proto/src/regular-message.h>
+#include <proto/src/codec.h>
+#include <proto/src/stream-parser.h>
+#include <proto/src/typed-message.h>
+#include "../upstream-pool/upstream-pool.h"
+#include "../tcp-server/object-pool.h"
+#include "splice-forwarder.h"
+#include "input-scanner.h"
 
-#include <functional>
+#include <vector>
 
 namespace balancer {
 
     class session_iface {
     public:
         virtual ~session_iface() = default;
-        virtual void start() = 0;
+        virtual void start(evutil_socket_t socket) = 0;
         virtual void stop() = 0;
     };
 
+    class tcp_session;
+
+    // Gets sessions back when they are closed, the owner can reuse them
+    class session_owner {
+    public:
+        virtual ~session_owner() = default;
+        virtual void on_session_closed(tcp_session &session) = 0;
+    };
+
+    /*
+     * A session object serves many client connections one after another:
+     * when a connection is closed, its socket is detached from the bufferevent
+     * and the session goes back to its owner with the bufferevent and buffers,
+     * start() attaches the next accepted socket.
+     * Until its upstream connection is established the session keeps messages
+     * in the client input buffer, up to max_pending_bytes. A failed connect is
+     * retried after a jittered backoff, preferably on another backend of the
+     * group, and the kept messages are forwarded once a connect succeeds.
+     * Streams of trusted clients can be forwarded by splice_forwarder instead.
+     */
     class tcp_session
         : public session_iface
+        , public upstream_observer
+        , public input_observer
+        , public intrusive_list_hook
     {
-        using close_op_t = std::function<void()>;
-
     public:
         tcp_session(event_base *base,
-                    evutil_socket_t socket,
-                    close_op_t close_op,
-                    const route_map &route_map,
+                    session_owner &owner,
+                    route_map_view &route_map,
+                    routing_policy &routing_policy,
+                    upstream_pool &upstream_pool,
+                    const session_options &options,
+                    const common::common_timeouts &timeouts,
+                    worker_stats &stats,
                     log4cplus::Logger &logger);
 
         ~tcp_session() override = default;
 
     public:
-        void start() override;
+        void start(evutil_socket_t socket) override;
+        // closes the client socket, the session can be started again
         void stop() override;
+        void on_upstream_connected() override;
+        void on_upstream_closed() override;
+        void on_upstream_throttled() override;
+        void on_upstream_drained() override;
 
     private:
-        void drop_session();
+        enum class session_state {
+            handshake,      // the init message is not read yet
+            connecting,     // the upstream connection is not established yet
+            retrying,       // waiting for the next connect after a failed one
+            forwarding
+        };
+
+    private:
+        void drop_session(close_reason reason);
+        void reset() noexcept;
+        void close_client_socket() noexcept;
         void start_reading_init_message();
         void read_init_message();
         void start_routing(proto::init_message::client_id_t client_id);
-        void connect_to_server(const common::remote_server &server);
+        // Both return false if the session is closed
+        bool route_to_backend();
+        bool connect_to_server(const backend_ptr &backend);
         void start_reading_regular_message();
-        void read_regular_message();
-        void write_regular_message(const proto::bytes &msg);
+        void start_forwarding();
+        bool can_splice() const noexcept;
+        void start_splicing();
+        void schedule_retry();
+        void retry_connect();
+        std::chrono::milliseconds next_retry_delay();
+        // returns false if the session is closed
+        bool process_client_input();
+        void on_regular_frames(const std::uint32_t *payloads, std::size_t count) override;
+        scan_action on_frame(const proto::frame_info &frame) override;
+        void on_invalid_input(const std::string &error) override;
+        void unpack_batch(const proto::frame_info &frame);
+        // Both return false if the session is closed
+        bool forward_messages(evbuffer *input, std::size_t length);
+        bool forward_unpacked_batch();
+        void count_forwarded(std::size_t frames, std::size_t bytes) noexcept;
         void on_next_event(short what);
         static void on_event_cb(bufferevent */*bev*/, short what, void *ctx);
-        void check_result_code(int result_code, const std::string &error_msg);
+        static void on_retry_timer_cb(evutil_socket_t /*fd*/, short /*what*/, void *ctx);
+        // takes literals, so a passed check does not build a string on the hot path
+        void check_result_code(int result_code, const char *error_msg);
 
+        // the read timeout is the longest pause between reads from the client
         template<typename r_cb_t>
-        void prepare_client_buffer_for_reading(const r_cb_t &r_cb, std::size_t lowmark, std::size_t highmark)
+        void prepare_client_buffer_for_reading(const r_cb_t &r_cb, std::size_t lowmark, std::size_t highmark,
+                                               const timeval *read_timeout)
         {
             auto *buff{client_buffer_.get()};
             bufferevent_setcb(buff, r_cb, nullptr, tcp_session::on_event_cb, this);
             bufferevent_setwatermark(buff, EV_READ, lowmark, highmark);
+            check_result_code(bufferevent_set_timeouts(buff, read_timeout, nullptr),
+                              "Can not set client read timeout");
             check_result_code(bufferevent_enable(buff, EV_READ),
                               "Can not enable client bufferevent for reading");
         }
 
-        template<typename msg_t>
-        msg_t read_message()
-        {
-            proto::bytes bytes(msg_t::message_length());
-            std::size_t readed_bytes{0};
-            while(readed_bytes < bytes.size()) {
-                proto::byte *start_write_pos{bytes.data() + readed_bytes};
-                const std::size_t expected_read{bytes.size() - readed_bytes};
-                readed_bytes += bufferevent_read(client_buffer_.get(),
-                                                 start_write_pos,
-                                                 expected_read);
-            }
-            msg_t msg{std::move(bytes)};
-            msg.load();
-            return msg;
-        }
-
         template<typename t, typename deleter_t>
         void check_null(const std::unique_ptr<t, deleter_t> &ptr, const std::string &error_msg)
         {
@@ -83,10 +134,33 @@ namespace balancer {
         }
 
     private:
-        const close_op_t close_op_;
-        const route_map &route_map_;
+        session_owner &owner_;
+        route_map_view &route_map_;
+        routing_policy &routing_policy_;
+        upstream_pool &upstream_pool_;
+        const session_options &options_;
+        const common::common_timeouts &timeouts_;
+        worker_stats &stats_;
         common::bufferevent_ptr client_buffer_;
-        common::bufferevent_ptr server_buffer_;
+        common::event_ptr retry_timer_;
+        splice_forwarder splicer_;
+        session_state state_{session_state::handshake};
+        proto::init_message::client_id_t client_id_{0};
+        bool trusted_{false};
+        std::shared_ptr<upstream_connection> upstream_;
+        // the backend of the last failed connect is avoided by the next one
+        backend_ptr failed_backend_;
+        std::uint32_t connect_attempts_{0};
+        // the client closed the connection while the session was connecting
+        bool client_eof_{false};
+        client_stats *client_stats_{nullptr};
+        // complete frames among scanned bytes that are not forwarded yet
+        std::size_t pending_frames_{0};
+        proto::bytes batch_;
+        input_scanner scanner_;
+        // a batch to unpack ends the complete bytes, it is replaced by regular messages
+        std::size_t batch_bytes_{0};
+        proto::bytes unpacked_;
         log4cplus::Logger &logger_;
     };
 
@@ -0,0 +1,411 @@
+#include "upstream-connection.h"
+
+#include <algorithm>
+#include <log4cplus/loggingmacros.h>
+
+namespace balancer {
+
+    upstream_connection::upstream_connection(event_base *base,
+                                             const backend_ptr &backend,
+                                             common::async_resolver &resolver,
+                                             const common::common_timeouts &timeouts,
+                                             close_op_t close_op,
+                                             const upstream_options &options,
+                                             worker_stats &stats,
+                                             log4cplus::Logger &logger)
+        : backend_{backend}
+        , server_{backend->server()}
+        , resolver_{resolver}
+        , timeouts_{timeouts}
+        , close_op_{std::move(close_op)}
+        , options_{options}
+        , stats_{stats}
+        , traffic_{stats.backends.find(backend->stats_slot(), backend->id())}
+        , buffer_{common::bufferevent_ptr(bufferevent_socket_new(base, -1, BEV_OPT_CLOSE_ON_FREE))}
+        , compressor_{common::make_compressor(backend->compression())}
+        , idle_timer_{common::event_ptr(evtimer_new(base, upstream_connection::on_idle_timeout_cb, this))}
+        , logger_{logger}
+    { }
+
+    void upstream_connection::connect()
+    {
+        check_null(buffer_, "Invalid server bufferevent");
+        check_null(idle_timer_, "Can not create idle timer");
+
+        auto *buff{buffer_.get()};
+        bufferevent_setcb(buff, nullptr, nullptr, upstream_connection::on_event_cb, this);
+        check_result_code(bufferevent_enable(buff, EV_WRITE), "Can not enable server bufferevent for writing");
+        output_cb_ = evbuffer_add_cb(bufferevent_get_output(buff), upstream_connection::on_output_changed_cb, this);
+        check_result_code(nullptr == output_cb_ ? -1 : 0, "Can not watch server output buffer");
+        // the write timeout of a connecting bufferevent limits the connect
+        check_result_code(bufferevent_set_timeouts(buff, nullptr, timeouts_.connect()),
+                          "Can not set server connect timeout");
+
+        // until the connection is established messages are collected in the output buffer
+        const auto *address{backend_->address()};
+        if(nullptr != address) {
+            connect_to(*address);
+        } else {
+            sockaddr_in sock;
+            const auto on_resolved{[this](int error, const sockaddr_in &sock) { this->on_resolved(error, sock); }};
+            if(resolver_.resolve(server_, sock, on_resolved, resolve_request_)) {
+                connect_to(sock);
+            }
+        }
+        LOG4CPLUS_INFO(logger_, "New upstream connection to server " << server_
+                       << ", compression: " << common::compression_name(backend_->compression()));
+    }
+
+    void upstream_connection::connect_to(const sockaddr_in &sock)
+    {
+        connect_started_at_ = std::chrono::steady_clock::now();
+        check_result_code(
+                    bufferevent_socket_connect(buffer_.get(),
+                                               reinterpret_cast<const sockaddr *>(&sock),
+                                               sizeof(sock)),
+                    "Can not start connection procedure to server");
+    }
+
+    void upstream_connection::on_resolved(int error, const sockaddr_in &sock)
+    {
+        resolve_request_ = 0;
+        if(0 != error) {
+            LOG4CPLUS_ERROR(logger_, "Can not resolve server " << server_
+                            << ", error: " << common::async_resolver::error_message(error));
+            report_failure();
+            fail();
+            return;
+        }
+        try {
+            connect_to(sock);
+        } catch (const std::exception &ex) {
+            LOG4CPLUS_ERROR(logger_, ex.what());
+            fail();
+        }
+    }
+
+    void upstream_connection::stop()
+    {
+        closed_ = true;
+        if(0 != resolve_request_) {
+            resolver_.cancel(resolve_request_);
+            resolve_request_ = 0;
+        }
+        if(idle_timer_) {
+            evtimer_del(idle_timer_.get());
+            idle_timer_.reset();
+        }
+        if(buffer_) {
+            if(nullptr != output_cb_) {
+                auto *output{bufferevent_get_output(buffer_.get())};
+                evbuffer_remove_cb_entry(output, output_cb_);
+                output_cb_ = nullptr;
+                const auto queued{static_cast<std::int64_t>(evbuffer_get_length(output))};
+                backend_->stats().queued_bytes.fetch_sub(queued, std::memory_order_relaxed);
+            }
+            bufferevent_disable(buffer_.get(), EV_WRITE);
+            buffer_.reset();
+        }
+    }
+
+    void upstream_connection::attach(upstream_observer &observer)
+    {
+        evtimer_del(idle_timer_.get());
+        observers_.push_back(&observer);
+        backend_->stats().active_sessions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void upstream_connection::detach(upstream_observer &observer)
+    {
+        const auto observer_it{std::find(observers_.begin(), observers_.end(), &observer)};
+        if(observers_.end() != observer_it) {
+            observers_.erase(observer_it);
+            backend_->stats().active_sessions.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::size_t upstream_connection::observers_count() const noexcept
+    {
+        return observers_.size();
+    }
+
+    common::compression_type upstream_connection::compression() const noexcept
+    {
+        return backend_->compression();
+    }
+
+    backend_traffic &upstream_connection::traffic() const noexcept
+    {
+        return traffic_;
+    }
+
+    const backend_ptr &upstream_connection::backend() const noexcept
+    {
+        return backend_;
+    }
+
+    bool upstream_connection::is_available() const noexcept
+    {
+        return !closed_ && !draining_;
+    }
+
+    bool upstream_connection::is_connected() const noexcept
+    {
+        return connected_;
+    }
+
+    bool upstream_connection::is_dedicated() const noexcept
+    {
+        return 0 == options_.pool_size;
+    }
+
+    evutil_socket_t upstream_connection::socket() const noexcept
+    {
+        return buffer_ ? bufferevent_getfd(buffer_.get()) : -1;
+    }
+
+    bool upstream_connection::is_throttled() const noexcept
+    {
+        return throttled_;
+    }
+
+    void upstream_connection::write(const proto::bytes &data)
+    {
+        add_to_output(data.data(), data.size());
+        check_high_watermark();
+    }
+
+    void upstream_connection::move_from(evbuffer *input, std::size_t size)
+    {
+        if(!compressor_) {
+            check_result_code(evbuffer_remove_buffer(input, bufferevent_get_output(buffer_.get()), size),
+                              "Can not move messages to server bufferevent");
+            check_high_watermark();
+            return;
+        }
+
+        // compressed straight from the input chunks, they are drained afterwards
+        const int chunks_count{evbuffer_peek(input, static_cast<ev_ssize_t>(size), nullptr, nullptr, 0)};
+        chunks_.resize(static_cast<std::size_t>(std::max(chunks_count, 0)));
+        evbuffer_peek(input, static_cast<ev_ssize_t>(size), nullptr, chunks_.data(), chunks_count);
+        std::size_t left{size};
+        for(const auto &chunk : chunks_) {
+            const std::size_t chunk_size{std::min(chunk.iov_len, left)};
+            add_to_output(chunk.iov_base, chunk_size);
+            left -= chunk_size;
+        }
+        check_result_code(evbuffer_drain(input, size), "Can not drain moved messages");
+        check_high_watermark();
+    }
+
+    void upstream_connection::add_to_output(const void *data, std::size_t size)
+    {
+        if(compressor_) {
+            compressor_->compress(data, size, bufferevent_get_output(buffer_.get()));
+        } else {
+            check_result_code(bufferevent_write(buffer_.get(), data, size),
+                              "Can not write messages to server bufferevent");
+        }
+    }
+
+    std::size_t upstream_connection::queued_bytes() const noexcept
+    {
+        return buffer_ ? evbuffer_get_length(bufferevent_get_output(buffer_.get())) : 0;
+    }
+
+    void upstream_connection::start_idle_timer(const timeval &timeout)
+    {
+        // a failed connection is already stopped and removed from the pool
+        if(closed_) {
+            return;
+        }
+        evtimer_add(idle_timer_.get(), &timeout);
+    }
+
+    void upstream_connection::close_when_drained()
+    {
+        if(closed_) {
+            return;
+        }
+        if(compressor_ && !draining_) {
+            // the end of the compressed stream lets the receiver check it is complete
+            compressor_->finish(bufferevent_get_output(buffer_.get()));
+        }
+        if(0 == queued_bytes()) {
+            close();
+            return;
+        }
+        draining_ = true;
+        notify_on_write(0);
+    }
+
+    void upstream_connection::check_high_watermark()
+    {
+        stats_.upstream_queue_bytes.observe(queued_bytes());
+        if(throttled_ || 0 == options_.high_watermark || queued_bytes() <= options_.high_watermark) {
+            return;
+        }
+        LOG4CPLUS_INFO(logger_, "Upstream connection to server " << server_ << " is throttled, "
+                       << queued_bytes() << " bytes are queued");
+        throttled_ = true;
+        increment(stats_.upstream_throttles);
+        notify_on_write(options_.low_watermark);
+
+        const auto observers{observers_};
+        for(auto *observer : observers) {
+            observer->on_upstream_throttled();
+        }
+    }
+
+    void upstream_connection::notify_on_write(std::size_t lowmark)
+    {
+        // write callback is called when output buffer is drained to low watermark
+        auto *buff{buffer_.get()};
+        bufferevent_setwatermark(buff, EV_WRITE, lowmark, 0);
+        bufferevent_setcb(buff, nullptr, upstream_connection::on_write_cb,
+                          upstream_connection::on_event_cb, this);
+    }
+
+    void upstream_connection::close()
+    {
+        if(closed_) {
+            return;
+        }
+        LOG4CPLUS_INFO(logger_, "Close upstream connection to server " << server_);
+        stop();
+        // can destroy this object, must be the last call
+        close_op_();
+    }
+
+    void upstream_connection::on_drained()
+    {
+        if(draining_) {
+            if(observers_.empty()) {
+                close();
+            }
+            return;
+        }
+
+        if(throttled_) {
+            LOG4CPLUS_INFO(logger_, "Upstream connection to server " << server_ << " is drained");
+            throttled_ = false;
+            bufferevent_setcb(buffer_.get(), nullptr, nullptr, upstream_connection::on_event_cb, this);
+            // resumed sessions can throttle the connection again or drop themselves,
+            // the last one to leave closes the connection and releases this object
+            const auto self{shared_from_this()};
+            const auto observers{observers_};
+            for(auto observer_it = observers.cbegin();
+                observer_it != observers.cend() && !throttled_ && !closed_; ++observer_it) {
+                (*observer_it)->on_upstream_drained();
+            }
+        }
+    }
+
+    void upstream_connection::on_next_event(short what)
+    {
+        if(what & BEV_EVENT_CONNECTED) {
+            connected_ = true;
+            const auto latency{std::chrono::steady_clock::now() - connect_started_at_};
+            const auto latency_us{std::chrono::duration_cast<std::chrono::microseconds>(latency)};
+            backend_->stats().update_connect_latency(latency_us);
+            stats_.connect_latency_us.observe(static_cast<std::uint64_t>(latency_us.count()));
+            report_success();
+            if(-1 == bufferevent_set_timeouts(buffer_.get(), nullptr, timeouts_.write())) {
+                LOG4CPLUS_ERROR(logger_, "Can not set write timeout of server " << server_);
+                fail();
+                return;
+            }
+            // sessions can close and release the connection while they are notified,
+            // observers that are left keep it alive, must be the last call
+            const auto observers{observers_};
+            for(auto *observer : observers) {
+                observer->on_upstream_connected();
+            }
+            return;
+        }
+        if(what & BEV_EVENT_TIMEOUT) {
+            LOG4CPLUS_ERROR(logger_, (connected_ ? "Write" : "Connect") << " timeout of upstream connection to server "
+                            << server_ << ", " << queued_bytes() << " bytes are queued");
+            increment(stats_.upstream_timeouts);
+            report_failure();
+            fail();
+            return;
+        }
+        if(what & BEV_EVENT_EOF || what & BEV_EVENT_ERROR) {
+            LOG4CPLUS_ERROR(logger_, "Upstream connection to server " << server_ << " is broken");
+            report_failure();
+            fail();
+        }
+    }
+
+    void upstream_connection::report_success()
+    {
+        if(backend_->health().on_success()) {
+            LOG4CPLUS_INFO(logger_, "Server " << server_ << " is healthy again");
+        }
+    }
+
+    void upstream_connection::report_failure()
+    {
+        auto &health{backend_->health()};
+        if(health.on_failure(std::chrono::steady_clock::now(), options_.health)) {
+            LOG4CPLUS_ERROR(logger_, "Server " << server_ << " is ejected for "
+                            << health.ejection_time().count() << " ms after failures");
+        }
+    }
+
+    void upstream_connection::fail()
+    {
+        stop();
+        // observers can detach while they are notified
+        const auto observers{observers_};
+        for(auto *observer : observers) {
+            observer->on_upstream_closed();
+        }
+        // can destroy this object, must be the last call
+        close_op_();
+    }
+
+    void upstream_connection::on_output_changed(const evbuffer_cb_info &info) noexcept
+    {
+        const auto delta{static_cast<std::int64_t>(info.n_added) - static_cast<std::int64_t>(info.n_deleted)};
+        backend_->stats().queued_bytes.fetch_add(delta, std::memory_order_relaxed);
+        if(0 != info.n_deleted) {
+            add(traffic_.sent_bytes, info.n_deleted);
+        }
+    }
+
+    void upstream_connection::on_output_changed_cb(evbuffer */*buffer*/, const evbuffer_cb_info *info, void *ctx)
+    {
+        auto *self{static_cast<upstream_connection *>(ctx)};
+        self->on_output_changed(*info);
+    }
+
+    void upstream_connection::on_write_cb(bufferevent */*bev*/, void *ctx)
+    {
+        auto *self{static_cast<upstream_connection *>(ctx)};
+        self->on_drained();
+    }
+
+    void upstream_connection::on_event_cb(bufferevent */*bev*/, short what, void *ctx)
+    {
+        auto *self{static_cast<upstream_connection *>(ctx)};
+        self->on_next_event(what);
+    }
+
+    void upstream_connection::on_idle_timeout_cb(evutil_socket_t /*fd*/, short /*what*/, void *ctx)
+    {
+        auto *self{static_cast<upstream_connection *>(ctx)};
+        if(self->observers_.empty()) {
+            self->close_when_drained();
+        }
+    }
+
+    void upstream_connection::check_result_code(int result_code, const char *error_msg)
+    {
+        if(-1 == result_code) {
+            throw std::runtime_error{error_msg};
+        }
+    }
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <common/src/types.h>
+#include <common/src/remote-server.h>
+#include <common/src/async-resolver.h>
+#include <common/src/compression.h>
+#include <common/src/timeouts.h>
+#include <proto/src/base-message.h>
+#include "../common.h"
+#include "../stats/worker-stats.h"
+#include "../route-map/backend.h"
+
+#include <memory>
+#include <vector>
+#include <functional>
+
+namespace balancer {
+
+    class upstream_observer {
+    public:
+        virtual ~upstream_observer() = default;
+        virtual void on_upstream_connected() = 0;
+        virtual void on_upstream_closed() = 0;
+        virtual void on_upstream_throttled() = 0;
+        virtual void on_upstream_drained() = 0;
+    };
+
+    /*
+     * Connection to a backend that can be shared by many sessions.
+     * Sessions write whole frames only, so frames from different clients
+     * never interleave inside one frame.
+     * When the backend has compression, everything written to the connection
+     * goes through one compression stream that is flushed on every write.
+     * Connect and write timeouts are common timeouts of the worker: a connect
+     * that is not completed in time or queued data that the backend does not
+     * take fails the connection together with its sessions.
+     * Results of connects and broken connections are reported to the health
+     * of the backend, consecutive failures eject it from routing.
+     * Sessions write nothing until the connection is established, they are
+     * notified when it is, so a failed connect loses no data of theirs.
+     */
+    class upstream_connection : public std::enable_shared_from_this<upstream_connection> {
+        using close_op_t = std::function<void()>;
+
+    public:
+        upstream_connection(event_base *base,
+                            const backend_ptr &backend,
+                            common::async_resolver &resolver,
+                            const common::common_timeouts &timeouts,
+                            close_op_t close_op,
+                            const upstream_options &options,
+                            worker_stats &stats,
+                            log4cplus::Logger &logger);
+
+    public:
+        void connect();
+        void stop();
+
+        void attach(upstream_observer &observer);
+        void detach(upstream_observer &observer);
+        std::size_t observers_count() const noexcept;
+        common::compression_type compression() const noexcept;
+        const backend_ptr &backend() const noexcept;
+        // counters of the backend kept by the worker of this connection
+        backend_traffic &traffic() const noexcept;
+        bool is_available() const noexcept;
+        bool is_connected() const noexcept;
+        // the connection serves only one session and is never shared
+        bool is_dedicated() const noexcept;
+        evutil_socket_t socket() const noexcept;
+        bool is_throttled() const noexcept;
+
+        void write(const proto::bytes &data);
+        void move_from(evbuffer *input, std::size_t size);
+        std::size_t queued_bytes() const noexcept;
+
+        void start_idle_timer(const timeval &timeout);
+        void close_when_drained();
+
+    private:
+        void connect_to(const sockaddr_in &sock);
+        void on_resolved(int error, const sockaddr_in &sock);
+        void fail();
+        void report_success();
+        void report_failure();
+        void close();
+        void add_to_output(const void *data, std::size_t size);
+        void check_high_watermark();
+        void notify_on_write(std::size_t lowmark);
+        void on_drained();
+        void on_next_event(short what);
+        void on_output_changed(const evbuffer_cb_info &info) noexcept;
+        static void on_output_changed_cb(evbuffer */*buffer*/, const evbuffer_cb_info *info, void *ctx);
+        static void on_write_cb(bufferevent */*bev*/, void *ctx);
+        static void on_event_cb(bufferevent */*bev*/, short what, void *ctx);
+        static void on_idle_timeout_cb(evutil_socket_t /*fd*/, short /*what*/, void *ctx);
+        // takes literals, so a passed check does not build a string on the hot path
+        void check_result_code(int result_code, const char *error_msg);
+
+        template<typename t, typename deleter_t>
+        void check_null(const std::unique_ptr<t, deleter_t> &ptr, const std::string &error_msg)
+        {
+            if(!ptr) {
+                throw std::runtime_error{error_msg};
+            }
+        }
+
+    private:
+        const backend_ptr backend_;
+        const common::remote_server &server_;
+        common::async_resolver &resolver_;
+        common::async_resolver::request_id_t resolve_request_{0};
+        const common::common_timeouts &timeouts_;
+        const close_op_t close_op_;
+        const upstream_options &options_;
+        worker_stats &stats_;
+        backend_traffic &traffic_;
+        common::bufferevent_ptr buffer_;
+        evbuffer_cb_entry *output_cb_{nullptr};
+        std::unique_ptr<common::compressor> compressor_;
+        std::vector<evbuffer_iovec> chunks_;
+        std::chrono::steady_clock::time_point connect_started_at_;
+        common::event_ptr idle_timer_;
+        std::vector<upstream_observer *> observers_;
+        bool connected_{false};
+        bool throttled_{false};
+        bool draining_{false};
+        bool closed_{false};
+        log4cplus::Logger &logger_;
+    };
+
+}
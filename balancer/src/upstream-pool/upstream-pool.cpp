@@ -0,0 +1,101 @@
+#include "upstream-pool.h"
+
+#include <algorithm>
+
+namespace balancer {
+
+    upstream_pool::upstream_pool(event_base *base,
+                                 common::async_resolver &resolver,
+                                 const common::common_timeouts &timeouts,
+                                 const upstream_options &options,
+                                 worker_stats &stats,
+                                 log4cplus::Logger &logger)
+        : base_{base}
+        , resolver_{resolver}
+        , timeouts_{timeouts}
+        , idle_timeout_{timeouts.get(options.idle_timeout)}
+        , options_{options}
+        , stats_{stats}
+        , logger_{logger}
+    { }
+
+    upstream_pool::connection_ptr upstream_pool::acquire(const backend_ptr &backend,
+                                                         upstream_observer &observer)
+    {
+        auto &connections{connections_[backend->server()]};
+        auto connection{find_connection(backend, connections)};
+        if(!connection) {
+            connection = new_connection(backend, connections);
+        }
+        connection->attach(observer);
+        return connection;
+    }
+
+    void upstream_pool::release(const connection_ptr &connection, upstream_observer &observer)
+    {
+        connection->detach(observer);
+        if(0 != connection->observers_count()) {
+            return;
+        }
+        if(0 == options_.pool_size || nullptr == idle_timeout_) {
+            connection->close_when_drained();
+        } else {
+            connection->start_idle_timer(*idle_timeout_);
+        }
+    }
+
+    void upstream_pool::stop()
+    {
+        for(auto &server_connections : connections_) {
+            for(auto &connection : server_connections.second) {
+                connection->stop();
+            }
+        }
+        connections_.clear();
+    }
+
+    upstream_pool::connection_ptr upstream_pool::find_connection(const backend_ptr &backend,
+                                                                 const connections_t &connections) const
+    {
+        if(0 == options_.pool_size) {
+            return nullptr;
+        }
+
+        connection_ptr least_loaded;
+        std::size_t available_count{0};
+        for(const auto &connection : connections) {
+            // compression of a backend can be changed by a route map reload
+            if(!connection->is_available() || connection->compression() != backend->compression()) {
+                continue;
+            }
+            ++available_count;
+            if(!least_loaded || connection->observers_count() < least_loaded->observers_count()) {
+                least_loaded = connection;
+            }
+        }
+
+        // open one more connection while the pool is not full and every connection is busy
+        const bool is_busy{!least_loaded || 0 != least_loaded->observers_count()};
+        if(is_busy && available_count < options_.pool_size) {
+            return nullptr;
+        }
+        return least_loaded;
+    }
+
+    upstream_pool::connection_ptr upstream_pool::new_connection(const backend_ptr &backend,
+                                                                connections_t &connections)
+    {
+        const auto connection_it{connections.emplace(connections.end())};
+        const auto close_op{[&connections, connection_it]() { connections.erase(connection_it); }};
+        *connection_it = std::make_shared<upstream_connection>(base_, backend, resolver_, timeouts_, close_op,
+                                                               options_, stats_, logger_);
+        try {
+            (*connection_it)->connect();
+        } catch (...) {
+            connections.erase(connection_it);
+            throw;
+        }
+        return *connection_it;
+    }
+
+}
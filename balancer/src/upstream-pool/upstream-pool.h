@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../common.h"
+#include "upstream-connection.h"
+
+#include <map>
+#include <list>
+#include <memory>
+
+namespace balancer {
+
+    /*
+     * Per worker pool of persistent connections to backends.
+     * Up to pool_size connections are opened to every backend, after that
+     * new sessions share the least loaded one. A connection without sessions
+     * is closed after idle_timeout (and only after its data is sent), all
+     * connections of the pool share one common timeout for it.
+     * With zero pool_size every session gets a dedicated connection.
+     */
+    class upstream_pool {
+        using connection_ptr = std::shared_ptr<upstream_connection>;
+        using connections_t = std::list<connection_ptr>;
+
+    public:
+        upstream_pool(event_base *base,
+                      common::async_resolver &resolver,
+                      const common::common_timeouts &timeouts,
+                      const upstream_options &options,
+                      worker_stats &stats,
+                      log4cplus::Logger &logger);
+
+    public:
+        connection_ptr acquire(const backend_ptr &backend, upstream_observer &observer);
+        void release(const connection_ptr &connection, upstream_observer &observer);
+        void stop();
+
+    private:
+        connection_ptr find_connection(const backend_ptr &backend, const connections_t &connections) const;
+        connection_ptr new_connection(const backend_ptr &backend, connections_t &connections);
+
+    private:
+        event_base *base_;
+        common::async_resolver &resolver_;
+        const common::common_timeouts &timeouts_;
+        const timeval *idle_timeout_;
+        const upstream_options &options_;
+        worker_stats &stats_;
+        log4cplus::Logger &logger_;
+        std::map<common::remote_server, connections_t> connections_;
+    };
+
+}
@@ -0,0 +1,282 @@
+#include "io-ring.h"
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+namespace {
+
+    // the flags are dropped one by one on older kernels
+    constexpr unsigned setup_flags[]{
+        IORING_SETUP_SUBMIT_ALL | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN,
+        IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN,
+        0
+    };
+
+    // completions of multishot receives outnumber submissions
+    constexpr unsigned cq_entries_per_sqe{4};
+
+    [[noreturn]] void throw_errno(int error, const char *what)
+    {
+        throw std::system_error{error, std::generic_category(), what};
+    }
+
+    void *map_ring(int fd, std::size_t size, off_t offset, const char *what)
+    {
+        void *ptr{mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset)};
+        if(MAP_FAILED == ptr) {
+            throw_errno(errno, what);
+        }
+        return ptr;
+    }
+
+    template<typename t>
+    t *at(void *ring, std::uint32_t offset) noexcept
+    {
+        return reinterpret_cast<t *>(static_cast<char *>(ring) + offset);
+    }
+
+}
+
+namespace balancer {
+
+    io_ring::io_ring(unsigned entries)
+    {
+        io_uring_params params;
+        int error{0};
+        for(const unsigned flags : setup_flags) {
+            std::memset(&params, 0, sizeof(params));
+            params.flags = flags | IORING_SETUP_CQSIZE | IORING_SETUP_R_DISABLED;
+            params.cq_entries = entries * cq_entries_per_sqe;
+            fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+            if(-1 != fd_) {
+                break;
+            }
+            error = errno;
+            if(EINVAL != error) {
+                break;
+            }
+        }
+        if(-1 == fd_) {
+            throw_errno(error, "Can not set up io_uring");
+        }
+
+        try {
+            sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            if(params.features & IORING_FEAT_SINGLE_MMAP) {
+                sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+                sq_ring_ = map_ring(fd_, sq_ring_size_, IORING_OFF_SQ_RING, "Can not map io_uring rings");
+                cq_ring_ = sq_ring_;
+            } else {
+                sq_ring_ = map_ring(fd_, sq_ring_size_, IORING_OFF_SQ_RING, "Can not map io_uring submission ring");
+                cq_ring_ = map_ring(fd_, cq_ring_size_, IORING_OFF_CQ_RING, "Can not map io_uring completion ring");
+            }
+            sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+            sqes_ = static_cast<io_uring_sqe *>(map_ring(fd_, sqes_size_, IORING_OFF_SQES,
+                                                         "Can not map io_uring submission entries"));
+        } catch (...) {
+            unmap();
+            throw;
+        }
+
+        sq_head_ = at<unsigned>(sq_ring_, params.sq_off.head);
+        sq_tail_ = at<unsigned>(sq_ring_, params.sq_off.tail);
+        sq_mask_ = *at<unsigned>(sq_ring_, params.sq_off.ring_mask);
+        sq_entries_ = params.sq_entries;
+        sq_local_tail_ = *sq_tail_;
+        // entries are always taken in order, so the index array is filled once
+        auto *sq_array{at<unsigned>(sq_ring_, params.sq_off.array)};
+        for(unsigned entry_idx = 0; entry_idx < sq_entries_; ++entry_idx) {
+            sq_array[entry_idx] = entry_idx;
+        }
+        cq_head_ = at<unsigned>(cq_ring_, params.cq_off.head);
+        cq_tail_ = at<unsigned>(cq_ring_, params.cq_off.tail);
+        cq_mask_ = *at<unsigned>(cq_ring_, params.cq_off.ring_mask);
+        cqes_ = at<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+    }
+
+    io_ring::~io_ring()
+    {
+        unmap();
+    }
+
+    void io_ring::unmap() noexcept
+    {
+        if(nullptr != sqes_) {
+            munmap(sqes_, sqes_size_);
+        }
+        if(nullptr != cq_ring_ && cq_ring_ != sq_ring_) {
+            munmap(cq_ring_, cq_ring_size_);
+        }
+        if(nullptr != sq_ring_) {
+            munmap(sq_ring_, sq_ring_size_);
+        }
+        if(-1 != fd_) {
+            close(fd_);
+        }
+    }
+
+    void io_ring::enable()
+    {
+        if(-1 == syscall(__NR_io_uring_register, fd_, IORING_REGISTER_ENABLE_RINGS, nullptr, 0)) {
+            throw_errno(errno, "Can not enable io_uring");
+        }
+    }
+
+    io_uring_sqe &io_ring::next_sqe()
+    {
+        if(sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+            submit_and_wait(0);
+            if(sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+                throw std::runtime_error{"io_uring submission queue is full"};
+            }
+        }
+        auto &sqe{sqes_[sq_local_tail_ & sq_mask_]};
+        std::memset(&sqe, 0, sizeof(sqe));
+        ++sq_local_tail_;
+        return sqe;
+    }
+
+    void io_ring::submit_and_wait(unsigned wait_count)
+    {
+        __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+        const unsigned to_submit{sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE)};
+        if(0 == to_submit && 0 == wait_count) {
+            return;
+        }
+        ++enters_;
+        const unsigned flags{0 == wait_count ? 0 : IORING_ENTER_GETEVENTS};
+        if(-1 != syscall(__NR_io_uring_enter, fd_, to_submit, wait_count, flags, nullptr, 0)) {
+            return;
+        }
+        // a signal or a full completion queue, the owner reaps completions and comes back
+        if(EINTR != errno && EAGAIN != errno && EBUSY != errno) {
+            throw_errno(errno, "Can not submit io_uring entries");
+        }
+    }
+
+    void io_ring::register_buffer_ring(io_uring_buf_ring *ring, unsigned entries, std::uint16_t group_id)
+    {
+        io_uring_buf_reg reg;
+        std::memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = reinterpret_cast<std::uint64_t>(ring);
+        reg.ring_entries = entries;
+        reg.bgid = group_id;
+        if(-1 == syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PBUF_RING, &reg, 1)) {
+            throw_errno(errno, "Can not register io_uring buffer ring");
+        }
+    }
+
+    void io_ring::unregister_buffer_ring(std::uint16_t group_id) noexcept
+    {
+        io_uring_buf_reg reg;
+        std::memset(&reg, 0, sizeof(reg));
+        reg.bgid = group_id;
+        syscall(__NR_io_uring_register, fd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    }
+
+    std::uint64_t io_ring::enters() const noexcept
+    {
+        return enters_;
+    }
+
+    buffer_ring::buffer_ring(io_ring &ring, std::uint16_t group_id, unsigned count, std::size_t buffer_size)
+        : ring_{ring}
+        , group_id_{group_id}
+        , count_{count}
+        , buffer_size_{buffer_size}
+    {
+        if(0 == count || 0 != (count & (count - 1)) || count > 32768) {
+            throw std::invalid_argument{"Buffer ring size must be a power of two up to 32768"};
+        }
+        entries_size_ = count * sizeof(io_uring_buf);
+        buffers_size_ = count * buffer_size;
+        // the ring must be page aligned
+        void *entries{mmap(nullptr, entries_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)};
+        if(MAP_FAILED == entries) {
+            throw_errno(errno, "Can not allocate buffer ring");
+        }
+        entries_ = static_cast<io_uring_buf_ring *>(entries);
+        void *buffers{mmap(nullptr, buffers_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)};
+        if(MAP_FAILED == buffers) {
+            const int error{errno};
+            munmap(entries_, entries_size_);
+            throw_errno(error, "Can not allocate receive buffers");
+        }
+        buffers_ = static_cast<std::uint8_t *>(buffers);
+
+        try {
+            ring_.register_buffer_ring(entries_, count_, group_id_);
+        } catch (...) {
+            munmap(buffers_, buffers_size_);
+            munmap(entries_, entries_size_);
+            throw;
+        }
+        for(unsigned buffer_id = 0; buffer_id < count_; ++buffer_id) {
+            add(static_cast<std::uint16_t>(buffer_id));
+        }
+        __atomic_store_n(&entries_->tail, tail_, __ATOMIC_RELEASE);
+    }
+
+    buffer_ring::~buffer_ring()
+    {
+        ring_.unregister_buffer_ring(group_id_);
+        munmap(buffers_, buffers_size_);
+        munmap(entries_, entries_size_);
+    }
+
+    std::uint16_t buffer_ring::group_id() const noexcept
+    {
+        return group_id_;
+    }
+
+    unsigned buffer_ring::count() const noexcept
+    {
+        return count_;
+    }
+
+    std::size_t buffer_ring::buffer_size() const noexcept
+    {
+        return buffer_size_;
+    }
+
+    std::size_t buffer_ring::taken() const noexcept
+    {
+        return taken_;
+    }
+
+    std::uint8_t *buffer_ring::data(std::uint16_t buffer_id) const noexcept
+    {
+        return buffers_ + buffer_id * buffer_size_;
+    }
+
+    std::uint16_t buffer_ring::take(const io_uring_cqe &cqe) noexcept
+    {
+        ++taken_;
+        return static_cast<std::uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    }
+
+    void buffer_ring::recycle(std::uint16_t buffer_id) noexcept
+    {
+        --taken_;
+        add(buffer_id);
+        __atomic_store_n(&entries_->tail, tail_, __ATOMIC_RELEASE);
+    }
+
+    void buffer_ring::add(std::uint16_t buffer_id) noexcept
+    {
+        // not entries_->bufs, the flexible array of the uapi header is shifted in C++
+        auto &entry{reinterpret_cast<io_uring_buf *>(entries_)[tail_ & (count_ - 1)]};
+        entry.addr = reinterpret_cast<std::uint64_t>(data(buffer_id));
+        entry.len = static_cast<std::uint32_t>(buffer_size_);
+        entry.bid = buffer_id;
+        ++tail_;
+    }
+
+}
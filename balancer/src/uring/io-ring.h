@@ -0,0 +1,121 @@
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include <cstdint>
+#include <cstddef>
+
+namespace balancer {
+
+    /*
+     * io_uring of one thread without liburing: the rings are mapped once,
+     * submission entries are filled in place and all entries queued by one
+     * loop iteration are submitted by the same io_uring_enter that waits
+     * for the next completions. The ring is set up for a single issuer with
+     * deferred task work, so completions are processed only when the owner
+     * waits for them, not in the middle of its work. The ring starts
+     * disabled, so it can be created and set up by one thread and used
+     * by another one, the issuer is the thread that calls enable().
+     */
+    class io_ring {
+    public:
+        explicit io_ring(unsigned entries);
+        ~io_ring();
+        io_ring(const io_ring &) = delete;
+        io_ring &operator=(const io_ring &) = delete;
+
+    public:
+        // nothing can be submitted before
+        void enable();
+        // a cleared entry, queued entries are submitted first when the queue is full
+        io_uring_sqe &next_sqe();
+        // submits queued entries and waits until 'wait_count' completions are ready
+        void submit_and_wait(unsigned wait_count);
+
+        // op(const io_uring_cqe &) for every ready completion, returns their count,
+        // 'op' may queue new entries but must not submit them
+        template<typename op_t>
+        unsigned for_each_completion(const op_t &op)
+        {
+            unsigned head{*cq_head_};
+            const unsigned tail{__atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)};
+            const unsigned count{tail - head};
+            for(; head != tail; ++head) {
+                op(cqes_[head & cq_mask_]);
+            }
+            __atomic_store_n(cq_head_, tail, __ATOMIC_RELEASE);
+            return count;
+        }
+
+        void register_buffer_ring(io_uring_buf_ring *ring, unsigned entries, std::uint16_t group_id);
+        void unregister_buffer_ring(std::uint16_t group_id) noexcept;
+        // io_uring_enter calls since the ring was created
+        std::uint64_t enters() const noexcept;
+
+    private:
+        void unmap() noexcept;
+
+    private:
+        int fd_{-1};
+        void *sq_ring_{nullptr};
+        std::size_t sq_ring_size_{0};
+        void *cq_ring_{nullptr};
+        std::size_t cq_ring_size_{0};
+        io_uring_sqe *sqes_{nullptr};
+        std::size_t sqes_size_{0};
+        unsigned *sq_head_{nullptr};
+        unsigned *sq_tail_{nullptr};
+        unsigned sq_mask_{0};
+        unsigned sq_entries_{0};
+        // entries queued since the last submit are not visible to the kernel yet
+        unsigned sq_local_tail_{0};
+        unsigned *cq_head_{nullptr};
+        unsigned *cq_tail_{nullptr};
+        unsigned cq_mask_{0};
+        io_uring_cqe *cqes_{nullptr};
+        std::uint64_t enters_{0};
+    };
+
+    /*
+     * Buffers that the kernel picks for multishot receives of one group.
+     * A completion names the buffer it has filled, the buffer belongs to
+     * the receiver until it is recycled, receives of a group fail with
+     * ENOBUFS while all its buffers are taken. Taken buffers are counted
+     * on the way back from the kernel, so the owner knows when some are free.
+     */
+    class buffer_ring {
+    public:
+        buffer_ring(io_ring &ring, std::uint16_t group_id, unsigned count, std::size_t buffer_size);
+        ~buffer_ring();
+        buffer_ring(const buffer_ring &) = delete;
+        buffer_ring &operator=(const buffer_ring &) = delete;
+
+    public:
+        std::uint16_t group_id() const noexcept;
+        unsigned count() const noexcept;
+        std::size_t buffer_size() const noexcept;
+        // buffers handed to receivers and not recycled yet
+        std::size_t taken() const noexcept;
+        std::uint8_t *data(std::uint16_t buffer_id) const noexcept;
+        // returns the buffer filled by the completion, it is taken until recycled
+        std::uint16_t take(const io_uring_cqe &cqe) noexcept;
+        // gives the buffer back to the kernel
+        void recycle(std::uint16_t buffer_id) noexcept;
+
+    private:
+        void add(std::uint16_t buffer_id) noexcept;
+
+    private:
+        io_ring &ring_;
+        const std::uint16_t group_id_;
+        const unsigned count_;
+        const std::size_t buffer_size_;
+        io_uring_buf_ring *entries_{nullptr};
+        std::size_t entries_size_{0};
+        std::uint8_t *buffers_{nullptr};
+        std::size_t buffers_size_{0};
+        std::uint16_t tail_{0};
+        std::size_t taken_{0};
+    };
+
+}
@@ -0,0 +1,227 @@
+#include "uring-server.h"
+#include <common/src/utils.h>
+
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <log4cplus/loggingmacros.h>
+
+namespace {
+
+    // user_data of the worker entries, sessions have their addresses there;
+    // completions with zero user_data (closes, cancels) are not needed
+    constexpr std::uint64_t accept_tag{1};
+    constexpr std::uint64_t tick_tag{2};
+
+    constexpr std::chrono::milliseconds tick_interval{100};
+
+}
+
+namespace balancer {
+
+    uring_server::uring_server(std::uint16_t port,
+                               const route_map_holder &route_map,
+                               const balancer_options &options,
+                               common::dns_cache &dns_cache,
+                               std::size_t worker_id,
+                               bool reuse_port)
+        : port_{port}
+        , route_map_{route_map}
+        , options_{options}
+        , dns_cache_{dns_cache}
+        , reuse_port_{reuse_port}
+        , logger_{common::make_logger("uring_server#" + std::to_string(worker_id))}
+        , routing_policy_{make_routing_policy(options.routing_policy, route_map)}
+    {
+        tick_.tv_sec = 0;
+        tick_.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(tick_interval).count();
+    }
+
+    uring_server::~uring_server()
+    {
+        stop();
+    }
+
+    void uring_server::bind()
+    {
+        try {
+            const auto &uring{options_.uring};
+            ring_ = std::make_unique<io_ring>(uring.entries);
+            buffers_ = std::make_unique<buffer_ring>(*ring_, 0, uring.buffers, uring.buffer_size);
+        } catch (const std::exception &ex) {
+            log_error_stop_and_throw(ex.what());
+        }
+        context_ = std::make_unique<uring_context>(uring_context{*ring_, *buffers_, route_map_, *routing_policy_,
+                                                                 dns_cache_, options_, stats_, logger_,
+                                                                 std::chrono::steady_clock::now()});
+        open_listener();
+    }
+
+    void uring_server::open_listener()
+    {
+        listener_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(-1 == listener_) {
+            log_error_stop_and_throw("Can not create listener socket");
+        }
+        const int enable{1};
+        if(-1 == setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable))
+                || (reuse_port_ && -1 == setsockopt(listener_, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)))) {
+            log_error_stop_and_throw("Can not set listener socket options");
+        }
+        const sockaddr_in sock{common::make_sockaddr(INADDR_ANY, port_)};
+        if(-1 == ::bind(listener_, reinterpret_cast<const sockaddr *>(&sock), sizeof(sock))
+                || -1 == listen(listener_, SOMAXCONN)) {
+            log_error_stop_and_throw(std::string{"Can not create new listener: "} + std::strerror(errno));
+        }
+    }
+
+    void uring_server::run()
+    {
+        LOG4CPLUS_INFO(logger_, "Start server with io_uring");
+        ring_->enable();
+        start_accept();
+        start_tick();
+        while(!loop_broken_.load(std::memory_order_relaxed)) {
+            ring_->submit_and_wait(1);
+            context_->now = std::chrono::steady_clock::now();
+            const unsigned completions{ring_->for_each_completion([this](const io_uring_cqe &cqe) {
+                on_completion(cqe);
+            })};
+            add(stats_.uring_completions, completions);
+            resume_waiting_sessions();
+            stats_.uring_enters.store(ring_->enters(), std::memory_order_relaxed);
+        }
+        // closes of sockets queued by the last iteration, only this thread can submit them
+        ring_->submit_and_wait(0);
+    }
+
+    void uring_server::stop()
+    {
+        // the pending accept keeps the listener open until the ring is torn down
+        // by the kernel, so it stops listening first to free the port right away
+        if(-1 != listener_) {
+            shutdown(listener_, SHUT_RDWR);
+            close(listener_);
+            listener_ = -1;
+        }
+        // pending operations are cancelled when the ring is closed
+        sessions_.for_each_active([](uring_session &session) { session.abort(); });
+        sessions_.clear();
+        waiting_for_buffers_.clear();
+        context_.reset();
+        buffers_.reset();
+        ring_.reset();
+    }
+
+    const worker_stats &uring_server::stats() const noexcept
+    {
+        return stats_;
+    }
+
+    void uring_server::break_loop() noexcept
+    {
+        loop_broken_.store(true, std::memory_order_relaxed);
+    }
+
+    void uring_server::on_session_closed(uring_session &session)
+    {
+        add(stats_.active_sessions, -1);
+        sessions_.release(session);
+    }
+
+    void uring_server::on_buffers_exhausted(uring_session &session)
+    {
+        if(waiting_for_buffers_.empty()) {
+            LOG4CPLUS_ERROR(logger_, "All " << options_.uring.buffers << " receive buffers are taken");
+        }
+        waiting_for_buffers_.push_back(&session);
+    }
+
+    void uring_server::start_accept()
+    {
+        auto &sqe{ring_->next_sqe()};
+        sqe.opcode = IORING_OP_ACCEPT;
+        sqe.fd = listener_;
+        sqe.ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe.accept_flags = SOCK_CLOEXEC;
+        sqe.user_data = accept_tag;
+    }
+
+    void uring_server::on_accept(const io_uring_cqe &cqe)
+    {
+        if(0 == (cqe.flags & IORING_CQE_F_MORE)) {
+            start_accept();
+        }
+        if(cqe.res < 0) {
+            LOG4CPLUS_ERROR(logger_, "Can not accept client connection: " << std::strerror(-cqe.res));
+            return;
+        }
+
+        LOG4CPLUS_INFO(logger_, "New client connection was accepted");
+        increment(stats_.sessions_accepted);
+        uring_session *session{nullptr};
+        try {
+            session = &sessions_.acquire(*context_, *this);
+        } catch (const std::exception &ex) {
+            LOG4CPLUS_ERROR(logger_, "Can not create session, error: " << ex.what());
+            increment(stats_.sessions_closed[static_cast<std::size_t>(close_reason::start_failed)]);
+            close(cqe.res);
+            return;
+        }
+        add(stats_.active_sessions, 1);
+        session->start(cqe.res);
+    }
+
+    void uring_server::start_tick()
+    {
+        auto &sqe{ring_->next_sqe()};
+        sqe.opcode = IORING_OP_TIMEOUT;
+        sqe.addr = reinterpret_cast<std::uint64_t>(&tick_);
+        sqe.len = 1;
+        sqe.user_data = tick_tag;
+    }
+
+    void uring_server::on_tick()
+    {
+        start_tick();
+        // sessions can be closed by their timeouts
+        sessions_.for_each_active([](uring_session &session) { session.check_timeouts(); });
+    }
+
+    void uring_server::resume_waiting_sessions()
+    {
+        // buffers are recycled while completions are processed, the receives
+        // are armed again right away, not by the tick
+        if(waiting_for_buffers_.empty() || buffers_->taken() >= buffers_->count()) {
+            return;
+        }
+        // a session that gets no buffer again is put back to the list
+        std::vector<uring_session *> waiting;
+        waiting.swap(waiting_for_buffers_);
+        for(auto *session : waiting) {
+            session->resume_receiving();
+        }
+    }
+
+    void uring_server::on_completion(const io_uring_cqe &cqe)
+    {
+        if(cqe.user_data > uring_op_mask) {
+            auto *session{reinterpret_cast<uring_session *>(cqe.user_data & ~uring_op_mask)};
+            session->on_completion(static_cast<uring_op>(cqe.user_data & uring_op_mask), cqe);
+            return;
+        }
+        if(accept_tag == cqe.user_data) {
+            on_accept(cqe);
+        } else if(tick_tag == cqe.user_data) {
+            on_tick();
+        }
+    }
+
+    void uring_server::log_error_stop_and_throw(const std::string &error_msg)
+    {
+        LOG4CPLUS_ERROR(logger_, error_msg);
+        stop();
+        throw std::runtime_error{error_msg};
+    }
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../common.h"
+#include "../tcp-server/io-worker.h"
+#include "../tcp-server/object-pool.h"
+#include "uring-session.h"
+#include "io-ring.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace balancer {
+
+    /*
+     * Worker of the io_uring engine, it serves the listener and sessions
+     * of tcp_server without an event_base. One multishot accept takes all
+     * connections. Every loop iteration submits the entries queued while
+     * completions were processed and waits for the next completions by one
+     * io_uring_enter, so a batch of reads and writes of many sessions costs
+     * a single syscall. A timeout entry wakes the loop every tick to check
+     * timeouts of sessions.
+     */
+    class uring_server
+        : public io_worker
+        , public uring_session_owner
+    {
+    public:
+        uring_server(std::uint16_t port,
+                     const route_map_holder &route_map,
+                     const balancer_options &options,
+                     common::dns_cache &dns_cache,
+                     std::size_t worker_id = 0,
+                     bool reuse_port = false);
+        ~uring_server() override;
+
+    public:
+        void bind() override;
+        void run() override;
+        // must be called after run() returns
+        void stop() override;
+        const worker_stats &stats() const noexcept override;
+        // can be called from any thread, run() returns within a tick
+        void break_loop() noexcept;
+        void on_session_closed(uring_session &session) override;
+        void on_buffers_exhausted(uring_session &session) override;
+
+    private:
+        void open_listener();
+        void start_accept();
+        void on_accept(const io_uring_cqe &cqe);
+        void start_tick();
+        void on_tick();
+        void resume_waiting_sessions();
+        void on_completion(const io_uring_cqe &cqe);
+        void log_error_stop_and_throw(const std::string &error_msg);
+
+    private:
+        const std::uint16_t port_;
+        route_map_view route_map_;
+        const balancer_options &options_;
+        common::dns_cache &dns_cache_;
+        const bool reuse_port_;
+        log4cplus::Logger logger_;
+        worker_stats stats_;
+        std::unique_ptr<routing_policy> routing_policy_;
+        std::unique_ptr<io_ring> ring_;
+        std::unique_ptr<buffer_ring> buffers_;
+        std::unique_ptr<uring_context> context_;
+        int listener_{-1};
+        __kernel_timespec tick_;
+        // sessions whose receive failed without a free buffer, resumed when some are recycled
+        std::vector<uring_session *> waiting_for_buffers_;
+        std::atomic<bool> loop_broken_{false};
+        object_pool<uring_session> sessions_;
+    };
+
+}
@@ -0,0 +1,888 @@
+#include "uring-session.h"
+#include <common/src/utils.h>
+#include <common/src/log-sampler.h>
+#include <proto/src/bulk-decoder.h>
+#include <proto/src/typed-message.h>
+
+#include <cerrno>
+#include <random>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <log4cplus/loggingmacros.h>
+
+namespace {
+
+    // every worker thread has its own generator for retry jitter
+    thread_local std::minstd_rand retry_random{std::random_device{}()};
+
+    // iovecs of one sendmsg
+    constexpr std::size_t max_send_segments{64};
+
+    // buffers a multishot receive of a busy client usually fills before
+    // the worker sees its completions, the kernel retries a ready socket 32 times
+    constexpr std::size_t multishot_buffers{32};
+
+    // zero timeout never expires
+    bool is_expired(std::chrono::steady_clock::time_point now, std::chrono::steady_clock::time_point since,
+                    std::chrono::milliseconds timeout) noexcept
+    {
+        return 0 != timeout.count() && now - since >= timeout;
+    }
+
+}
+
+namespace balancer {
+
+    uring_session::uring_session(uring_context &context, uring_session_owner &owner)
+        : context_{context}
+        , owner_{owner}
+        , parser_{context.options.session.max_value_length,
+                  forwarding_mode::parse == context.options.session.forwarding}
+    {
+        segments_.reserve(max_send_segments);
+        iovecs_.reserve(max_send_segments);
+    }
+
+    void uring_session::start(int socket)
+    {
+        reset();
+        client_socket_ = socket;
+        started_at_ = context_.now;
+        LOG4CPLUS_INFO(context_.logger, "Start new unknown session");
+        update_receiving();
+    }
+
+    void uring_session::reset() noexcept
+    {
+        state_ = session_state::handshake;
+        inflight_ = 0;
+        receiving_ = false;
+        receive_cancelled_ = false;
+        receive_multishot_ = false;
+        waiting_for_buffers_ = false;
+        connect_pending_ = false;
+        connect_timed_out_ = false;
+        retry_pending_ = false;
+        sending_ = false;
+        throttled_ = false;
+        client_eof_ = false;
+        init_length_ = 0;
+        client_id_ = 0;
+        client_stats_ = nullptr;
+        connect_attempts_ = 0;
+        segments_.clear();
+        first_segment_ = 0;
+        incomplete_frame_.clear();
+        queued_bytes_ = 0;
+        ready_bytes_ = 0;
+        held_buffers_ = 0;
+        complete_bytes_ = 0;
+        complete_frames_ = 0;
+        parser_.reset();
+    }
+
+    std::uint64_t uring_session::user_data(uring_op op) const noexcept
+    {
+        return reinterpret_cast<std::uint64_t>(this) | static_cast<std::uint64_t>(op);
+    }
+
+    void uring_session::on_completion(uring_op op, const io_uring_cqe &cqe)
+    {
+        if(session_state::closing == state_) {
+            // only the bookkeeping of the cancelled operations is left
+            switch(op) {
+            case uring_op::client_recv:
+                if(cqe.flags & IORING_CQE_F_BUFFER) {
+                    context_.buffers.recycle(context_.buffers.take(cqe));
+                }
+                if(0 == (cqe.flags & IORING_CQE_F_MORE)) {
+                    receiving_ = false;
+                    --inflight_;
+                }
+                break;
+            case uring_op::upstream_connect:
+                connect_pending_ = false;
+                --inflight_;
+                break;
+            case uring_op::upstream_send:
+                sending_ = false;
+                --inflight_;
+                break;
+            case uring_op::retry_timer:
+                retry_pending_ = false;
+                --inflight_;
+                break;
+            }
+            if(0 == inflight_) {
+                finish_close();
+            }
+            return;
+        }
+
+        switch(op) {
+        case uring_op::client_recv:
+            on_received(cqe);
+            break;
+        case uring_op::upstream_connect:
+            on_connected(cqe);
+            break;
+        case uring_op::upstream_send:
+            on_sent(cqe);
+            break;
+        case uring_op::retry_timer:
+            retry_pending_ = false;
+            --inflight_;
+            on_retry_timer();
+            break;
+        }
+    }
+
+    void uring_session::check_timeouts()
+    {
+        const auto now{context_.now};
+        const auto &timeouts{context_.options.timeouts};
+        switch(state_) {
+        case session_state::handshake:
+            if(is_expired(now, started_at_, timeouts.handshake)) {
+                LOG4CPLUS_INFO(context_.logger, "Init message was not received in time, close session");
+                drop_session(close_reason::handshake_timeout);
+                return;
+            }
+            break;
+        case session_state::connecting:
+            if(connect_pending_ && !connect_timed_out_ && is_expired(now, connect_started_at_, timeouts.connect)) {
+                LOG4CPLUS_ERROR(context_.logger, "Connect timeout of upstream connection to server " << backend_->server());
+                increment(context_.stats.upstream_timeouts);
+                // the connect fails with ECANCELED and is retried
+                connect_timed_out_ = true;
+                cancel(uring_op::upstream_connect);
+            }
+            break;
+        case session_state::forwarding:
+            if(sending_ && is_expired(now, sent_at_, timeouts.write)) {
+                LOG4CPLUS_ERROR(context_.logger, "Write timeout of upstream connection to server "
+                                << backend_->server() << ", " << ready_bytes_ << " bytes are queued");
+                increment(context_.stats.upstream_timeouts);
+                report_failure();
+                drop_session(close_reason::upstream_closed);
+                return;
+            }
+            break;
+        default:
+            break;
+        }
+        // paused reading is not limited, the session waits for its upstream
+        if(session_state::handshake != state_ && session_state::closing != state_
+                && receiving_ && !receive_cancelled_ && is_expired(now, received_at_, timeouts.idle)) {
+            LOG4CPLUS_INFO(context_.logger, "Client was idle too long, close session");
+            drop_session(close_reason::idle_timeout);
+        }
+    }
+
+    void uring_session::resume_receiving()
+    {
+        // the session can be closed or reused while it waits
+        if(!waiting_for_buffers_ || session_state::closing == state_) {
+            return;
+        }
+        waiting_for_buffers_ = false;
+        update_receiving();
+    }
+
+    void uring_session::abort() noexcept
+    {
+        for(int *socket : {&client_socket_, &upstream_socket_}) {
+            if(-1 != *socket) {
+                close(*socket);
+                *socket = -1;
+            }
+        }
+        detach_backend();
+    }
+
+    void uring_session::drop_session(close_reason reason)
+    {
+        if(session_state::closing == state_) {
+            return;
+        }
+        increment(context_.stats.sessions_closed[static_cast<std::size_t>(reason)]);
+        state_ = session_state::closing;
+        if(receiving_ && !receive_cancelled_) {
+            receive_cancelled_ = true;
+            cancel(uring_op::client_recv);
+        }
+        if(connect_pending_) {
+            cancel(uring_op::upstream_connect);
+        }
+        if(sending_) {
+            cancel(uring_op::upstream_send);
+        }
+        if(retry_pending_) {
+            cancel(uring_op::retry_timer);
+        }
+        if(0 == inflight_) {
+            finish_close();
+        }
+    }
+
+    void uring_session::finish_close()
+    {
+        recycle_segments();
+        close_socket(upstream_socket_);
+        close_socket(client_socket_);
+        detach_backend();
+        // the session can be reused by the owner right away, must be the last call
+        owner_.on_session_closed(*this);
+    }
+
+    void uring_session::close_socket(int &socket)
+    {
+        if(-1 == socket) {
+            return;
+        }
+        // no operation of the session uses the socket anymore
+        auto &sqe{context_.ring.next_sqe()};
+        sqe.opcode = IORING_OP_CLOSE;
+        sqe.fd = socket;
+        socket = -1;
+    }
+
+    void uring_session::detach_backend() noexcept
+    {
+        if(backend_) {
+            auto &stats{backend_->stats()};
+            stats.active_sessions.fetch_sub(1, std::memory_order_relaxed);
+            stats.queued_bytes.fetch_sub(static_cast<std::int64_t>(ready_bytes_), std::memory_order_relaxed);
+            backend_.reset();
+            backend_traffic_ = nullptr;
+        }
+    }
+
+    void uring_session::on_received(const io_uring_cqe &cqe)
+    {
+        if(0 == (cqe.flags & IORING_CQE_F_MORE)) {
+            receiving_ = false;
+            --inflight_;
+        }
+        if(cqe.res > 0) {
+            const auto buffer_id{context_.buffers.take(cqe)};
+            const auto size{static_cast<std::size_t>(cqe.res)};
+            received_at_ = context_.now;
+            std::size_t offset{0};
+            segment received{no_buffer, 0, 0};
+            if(session_state::handshake == state_) {
+                offset = std::min(size, init_frame_.size() - init_length_);
+                std::memcpy(init_frame_.data() + init_length_, context_.buffers.data(buffer_id), offset);
+                init_length_ += offset;
+            }
+            // bytes that follow the init message are queued before routing
+            if(offset < size) {
+                received = queue_segment(buffer_id, offset, size - offset);
+            } else {
+                context_.buffers.recycle(buffer_id);
+            }
+            if(session_state::handshake == state_) {
+                if(init_frame_.size() != init_length_) {
+                    update_receiving();
+                    return;
+                }
+                read_init_message();
+                if(session_state::closing == state_) {
+                    return;
+                }
+                if(offset == size) {
+                    update_receiving();
+                    return;
+                }
+            }
+            if(!scan_segment(received)) {
+                return;
+            }
+            forward_complete_frames();
+            copy_incomplete_frame();
+            update_receiving();
+            return;
+        }
+
+        if(0 == cqe.res) {
+            on_client_eof();
+            return;
+        }
+        if(-ENOBUFS == cqe.res) {
+            // every buffer is taken, the owner resumes receiving when some are recycled
+            waiting_for_buffers_ = true;
+            owner_.on_buffers_exhausted(*this);
+            return;
+        }
+        if(-ECANCELED == cqe.res) {
+            // reading is paused
+            update_receiving();
+            return;
+        }
+        LOG4CPLUS_ERROR(context_.logger, "Can not receive from client: " << std::strerror(-cqe.res) << ", close session");
+        drop_session(close_reason::io_error);
+    }
+
+    void uring_session::on_client_eof()
+    {
+        client_eof_ = true;
+        switch(state_) {
+        case session_state::connecting:
+        case session_state::retrying:
+            // the kept messages are forwarded when the upstream connection is established
+            LOG4CPLUS_INFO(context_.logger, "Client closed connection before upstream connection is established");
+            break;
+        case session_state::forwarding:
+            if(0 != ready_bytes_) {
+                // the session is closed when the forwarded messages are sent
+                break;
+            }
+            LOG4CPLUS_INFO(context_.logger, "Close session");
+            drop_session(close_reason::client_closed);
+            break;
+        default:
+            LOG4CPLUS_INFO(context_.logger, "Close session");
+            drop_session(close_reason::client_closed);
+            break;
+        }
+    }
+
+    void uring_session::read_init_message()
+    {
+        if(proto::codec::check_header(init_frame_.data(), proto::message_type::init)) {
+            client_id_ = proto::codec::load_value(init_frame_.data());
+            LOG4CPLUS_INFO(context_.logger, "We connected with client: " << client_id_);
+            route_to_backend();
+        } else {
+            const auto type_uint{static_cast<std::uint32_t>(proto::codec::load_type(init_frame_.data()))};
+            LOG4CPLUS_ERROR(context_.logger, "Invalid init message, type is " << type_uint);
+            drop_session(close_reason::invalid_init);
+        }
+    }
+
+    void uring_session::route_to_backend()
+    {
+        // the snapshot is kept until the backend is chosen, the session
+        // keeps its backend even if the route map is reloaded later
+        const auto route_map{context_.route_map.get()};
+        const auto *group{route_map->find(client_id_)};
+        if(nullptr == group) {
+            // a reloaded route map can drop the client while its session retries
+            LOG4CPLUS_ERROR(context_.logger, "Have no information about client: " << client_id_);
+            drop_session(close_reason::unknown_client);
+            return;
+        }
+        if(nullptr == client_stats_) {
+            // only routed clients take slots in the stats table
+            client_stats_ = &context_.stats.clients.find(client_id_);
+        }
+
+        const auto *backend{context_.policy.choose(*group, failed_backend_.get())};
+        if(nullptr == backend && failed_backend_) {
+            // the failed backend is tried again if no other one is available
+            backend = context_.policy.choose(*group, nullptr);
+        }
+        if(nullptr == backend) {
+            LOG4CPLUS_ERROR(context_.logger, "All servers of client " << client_id_ << " are ejected");
+            drop_session(close_reason::no_healthy_backend);
+            return;
+        }
+        (*backend)->health().on_routed(std::chrono::steady_clock::now());
+        connect_to_server(*backend);
+    }
+
+    void uring_session::connect_to_server(const backend_ptr &backend)
+    {
+        const auto &server{backend->server()};
+        if(common::compression_type::none != backend->compression()) {
+            LOG4CPLUS_ERROR(context_.logger, "Can not start routing, server " << server
+                            << " needs compression, the io_uring engine does not compress");
+            drop_session(close_reason::routing_failed);
+            return;
+        }
+        // host names are resolved by the health checks of the control loop
+        const auto *address{backend->address()};
+        in_addr resolved;
+        if(nullptr != address) {
+            upstream_address_ = *address;
+        } else if(context_.dns_cache.find(server.host(), resolved)) {
+            upstream_address_ = common::make_sockaddr(ntohl(resolved.s_addr), server.port());
+        } else {
+            LOG4CPLUS_ERROR(context_.logger, "Address of server " << server << " is not resolved yet");
+            failed_backend_ = backend;
+            schedule_retry();
+            return;
+        }
+
+        upstream_socket_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if(-1 == upstream_socket_) {
+            LOG4CPLUS_ERROR(context_.logger, "Can not start routing, error: " << std::strerror(errno));
+            drop_session(close_reason::routing_failed);
+            return;
+        }
+        backend_ = backend;
+        backend_->stats().active_sessions.fetch_add(1, std::memory_order_relaxed);
+        backend_traffic_ = &context_.stats.backends.find(backend_->stats_slot(), backend_->id());
+        connect_started_at_ = std::chrono::steady_clock::now();
+        connect_timed_out_ = false;
+
+        auto &sqe{context_.ring.next_sqe()};
+        sqe.opcode = IORING_OP_CONNECT;
+        sqe.fd = upstream_socket_;
+        sqe.addr = reinterpret_cast<std::uint64_t>(&upstream_address_);
+        sqe.off = sizeof(upstream_address_);
+        sqe.user_data = user_data(uring_op::upstream_connect);
+        connect_pending_ = true;
+        ++inflight_;
+        state_ = session_state::connecting;
+        LOG4CPLUS_INFO(context_.logger, "Start routing packets from clietn " << client_id_ << " to server " << server);
+    }
+
+    void uring_session::on_connected(const io_uring_cqe &cqe)
+    {
+        connect_pending_ = false;
+        --inflight_;
+        if(0 != cqe.res) {
+            // nothing is forwarded before the connect, so a failed one loses no messages
+            if(!connect_timed_out_) {
+                LOG4CPLUS_ERROR(context_.logger, "Can not connect to server " << backend_->server()
+                                << ": " << std::strerror(-cqe.res));
+            }
+            report_failure();
+            failed_backend_ = backend_;
+            close_socket(upstream_socket_);
+            detach_backend();
+            schedule_retry();
+            return;
+        }
+
+        const auto latency{std::chrono::steady_clock::now() - connect_started_at_};
+        const auto latency_us{std::chrono::duration_cast<std::chrono::microseconds>(latency)};
+        backend_->stats().update_connect_latency(latency_us);
+        context_.stats.connect_latency_us.observe(static_cast<std::uint64_t>(latency_us.count()));
+        report_success();
+        start_forwarding();
+    }
+
+    void uring_session::start_forwarding()
+    {
+        state_ = session_state::forwarding;
+        failed_backend_.reset();
+        // messages received together with the init message or while connecting are sent first
+        forward_complete_frames();
+        if(client_eof_ && 0 == ready_bytes_) {
+            LOG4CPLUS_INFO(context_.logger, "Kept messages are forwarded, close session");
+            drop_session(close_reason::client_closed);
+            return;
+        }
+        update_receiving();
+    }
+
+    void uring_session::on_retry_timer()
+    {
+        route_to_backend();
+        if(session_state::closing != state_) {
+            update_receiving();
+        }
+    }
+
+    void uring_session::schedule_retry()
+    {
+        if(connect_attempts_ >= context_.options.session.connect_retries) {
+            LOG4CPLUS_ERROR(context_.logger, "Can not connect to server " << failed_backend_->server()
+                            << " after " << connect_attempts_ + 1 << " attempt(s), close session");
+            drop_session(close_reason::connect_failed);
+            return;
+        }
+
+        const auto delay{next_retry_delay()};
+        ++connect_attempts_;
+        increment(context_.stats.connect_retries);
+        state_ = session_state::retrying;
+        retry_delay_.tv_sec = delay.count() / 1000;
+        retry_delay_.tv_nsec = delay.count() % 1000 * 1000000;
+        auto &sqe{context_.ring.next_sqe()};
+        sqe.opcode = IORING_OP_TIMEOUT;
+        sqe.addr = reinterpret_cast<std::uint64_t>(&retry_delay_);
+        sqe.len = 1;
+        sqe.user_data = user_data(uring_op::retry_timer);
+        retry_pending_ = true;
+        ++inflight_;
+        LOG4CPLUS_INFO(context_.logger, "Can not connect to server " << failed_backend_->server()
+                       << ", retry in " << delay.count() << " ms");
+    }
+
+    std::chrono::milliseconds uring_session::next_retry_delay()
+    {
+        // exponential backoff with equal jitter as in tcp_session
+        const auto &options{context_.options.session};
+        const std::uint32_t shift{std::min<std::uint32_t>(connect_attempts_, 16)};
+        const auto backoff{std::min(options.retry_delay * (1 << shift), options.max_retry_delay)};
+        std::uniform_int_distribution<std::chrono::milliseconds::rep> jitter{0, backoff.count() / 2};
+        return backoff - backoff / 2 + std::chrono::milliseconds{jitter(retry_random)};
+    }
+
+    uring_session::segment uring_session::queue_segment(std::uint16_t buffer_id, std::size_t offset, std::size_t length)
+    {
+        // a buffer is held whole until all its bytes are sent, so a receive that fits
+        // after the last queued bytes is copied there and its own buffer is recycled;
+        // a send in flight covers only bytes before the appended ones
+        if(first_segment_ < segments_.size()) {
+            auto &last{segments_.back()};
+            const std::size_t end{last.offset + last.length};
+            if(no_buffer != last.buffer_id && length <= context_.buffers.buffer_size() - end) {
+                std::memcpy(context_.buffers.data(last.buffer_id) + end, context_.buffers.data(buffer_id) + offset, length);
+                context_.buffers.recycle(buffer_id);
+                last.length += static_cast<std::uint32_t>(length);
+                queued_bytes_ += length;
+                return segment{last.buffer_id, static_cast<std::uint32_t>(end), static_cast<std::uint32_t>(length)};
+            }
+        }
+
+        // sent segments are dropped from the front once they are half of the queue
+        if(first_segment_ > 0 && first_segment_ * 2 >= segments_.size()) {
+            segments_.erase(segments_.begin(), segments_.begin() + static_cast<std::ptrdiff_t>(first_segment_));
+            first_segment_ = 0;
+        }
+        segments_.push_back(segment{buffer_id, static_cast<std::uint32_t>(offset), static_cast<std::uint32_t>(length)});
+        queued_bytes_ += length;
+        ++held_buffers_;
+        return segments_.back();
+    }
+
+    bool uring_session::scan_segment(const segment &seg)
+    {
+        if(!scan_chunk(segment_data(seg), seg.length)) {
+            drop_session(close_reason::invalid_frame);
+            return false;
+        }
+        return true;
+    }
+
+    bool uring_session::scan_chunk(const std::uint8_t *data, std::size_t size)
+    {
+        const bool parse{forwarding_mode::parse == context_.options.session.forwarding};
+        std::size_t pos{0};
+        while(pos < size) {
+            // runs of regular frames are checked in bulk, other frames
+            // and frames split between buffers go through the parser
+            const std::size_t run_count{parser_.at_frame_start() ? (size - pos) / proto::codec::regular_length : 0};
+            if(run_count > 0) {
+                payloads_.resize(parse ? run_count : 0);
+                const auto result{proto::decode_regular_frames(data + pos, run_count, parse ? payloads_.data() : nullptr)};
+                for(std::size_t msg_idx = 0; parse && msg_idx < result.valid_frames; ++msg_idx) {
+                    COMMON_LOG_SAMPLED_INFO(context_.logger, common::log_category::message,
+                                            "Message with payload '" << payloads_[msg_idx] << "' has been received");
+                }
+                const std::size_t valid_bytes{result.valid_frames * proto::codec::regular_length};
+                add(client_stats_->frames_in, result.valid_frames);
+                add(client_stats_->bytes_in, valid_bytes);
+                complete_frames_ += result.valid_frames;
+                complete_bytes_ += valid_bytes;
+                pos += valid_bytes;
+                if(result.ok()) {
+                    continue;
+                }
+            }
+
+            pos += parser_.feed(data + pos, size - pos);
+            if(parser_.failed()) {
+                LOG4CPLUS_ERROR(context_.logger, "Invalid message from client: " << parser_.error() << ", close session");
+                return false;
+            }
+            if(parser_.complete()) {
+                const auto &frame{parser_.frame()};
+                if(proto::message_type::init == frame.type) {
+                    LOG4CPLUS_ERROR(context_.logger, "Unexpected init message from client, close session");
+                    return false;
+                }
+                increment(client_stats_->frames_in);
+                add(client_stats_->bytes_in, frame.length);
+                ++complete_frames_;
+                complete_bytes_ += frame.length;
+                if(!parse) {
+                    continue;
+                }
+                if(proto::message_type::batch == frame.type) {
+                    for(std::size_t value_pos = 0; value_pos < frame.value_length; value_pos += sizeof(std::uint32_t)) {
+                        COMMON_LOG_SAMPLED_INFO(context_.logger, common::log_category::message,
+                                                "Message with payload '" << proto::codec::load_uint32(frame.value + value_pos)
+                                                << "' has been received in batch");
+                    }
+                } else if(nullptr != frame.value || 0 == frame.value_length) {
+                    COMMON_LOG_SAMPLED_INFO(context_.logger, common::log_category::message,
+                                            "Message with payload '"
+                                            << proto::format_value(frame.kind, frame.value, frame.value_length)
+                                            << "' has been received");
+                }
+            }
+        }
+        return true;
+    }
+
+    void uring_session::forward_complete_frames()
+    {
+        if(session_state::forwarding != state_ || 0 == complete_bytes_) {
+            return;
+        }
+        ready_bytes_ += complete_bytes_;
+        count_forwarded(complete_frames_, complete_bytes_);
+        backend_->stats().queued_bytes.fetch_add(static_cast<std::int64_t>(complete_bytes_), std::memory_order_relaxed);
+        complete_bytes_ = 0;
+        complete_frames_ = 0;
+        context_.stats.upstream_queue_bytes.observe(ready_bytes_);
+
+        const auto &upstream{context_.options.upstream};
+        if(!throttled_ && 0 != upstream.high_watermark && held_bytes() > upstream.high_watermark) {
+            LOG4CPLUS_INFO(context_.logger, "Upstream connection to server " << backend_->server() << " is throttled, "
+                           << ready_bytes_ << " bytes are queued in " << held_buffers_ << " buffers");
+            throttled_ = true;
+            increment(context_.stats.upstream_throttles);
+            increment(context_.stats.session_pauses);
+        }
+        send_ready_bytes();
+    }
+
+    void uring_session::send_ready_bytes()
+    {
+        if(sending_ || 0 == ready_bytes_) {
+            return;
+        }
+        iovecs_.clear();
+        std::size_t left{ready_bytes_};
+        for(std::size_t segment_idx = first_segment_;
+            segment_idx < segments_.size() && left > 0 && iovecs_.size() < max_send_segments; ++segment_idx) {
+            const auto &seg{segments_[segment_idx]};
+            const std::size_t length{std::min<std::size_t>(seg.length, left)};
+            iovecs_.push_back(iovec{const_cast<std::uint8_t *>(segment_data(seg)), length});
+            left -= length;
+        }
+        std::memset(&message_, 0, sizeof(message_));
+        message_.msg_iov = iovecs_.data();
+        message_.msg_iovlen = iovecs_.size();
+
+        auto &sqe{context_.ring.next_sqe()};
+        sqe.opcode = IORING_OP_SENDMSG;
+        sqe.fd = upstream_socket_;
+        sqe.addr = reinterpret_cast<std::uint64_t>(&message_);
+        sqe.len = 1;
+        sqe.msg_flags = MSG_NOSIGNAL;
+        sqe.user_data = user_data(uring_op::upstream_send);
+        sending_ = true;
+        ++inflight_;
+        // the write timeout counts from the last progress of the queue
+        sent_at_ = context_.now;
+    }
+
+    void uring_session::on_sent(const io_uring_cqe &cqe)
+    {
+        sending_ = false;
+        --inflight_;
+        if(cqe.res < 0) {
+            LOG4CPLUS_ERROR(context_.logger, "Upstream connection to server " << backend_->server()
+                            << " is broken: " << std::strerror(-cqe.res));
+            report_failure();
+            drop_session(close_reason::upstream_closed);
+            return;
+        }
+
+        const auto sent{static_cast<std::size_t>(cqe.res)};
+        consume_sent(sent);
+        backend_->stats().queued_bytes.fetch_sub(static_cast<std::int64_t>(sent), std::memory_order_relaxed);
+        add(backend_traffic_->sent_bytes, sent);
+        // the buffer of an incomplete frame is held until the frame is copied out
+        if(throttled_ && (0 == ready_bytes_ || held_bytes() <= context_.options.upstream.low_watermark)) {
+            LOG4CPLUS_INFO(context_.logger, "Upstream connection to server " << backend_->server() << " is drained");
+            throttled_ = false;
+        }
+        if(client_eof_ && 0 == ready_bytes_) {
+            LOG4CPLUS_INFO(context_.logger, "Kept messages are forwarded, close session");
+            drop_session(close_reason::client_closed);
+            return;
+        }
+        send_ready_bytes();
+        copy_incomplete_frame();
+        update_receiving();
+    }
+
+    void uring_session::consume_sent(std::size_t size) noexcept
+    {
+        ready_bytes_ -= size;
+        queued_bytes_ -= size;
+        while(size > 0) {
+            auto &seg{segments_[first_segment_]};
+            const std::size_t length{std::min<std::size_t>(seg.length, size)};
+            seg.offset += static_cast<std::uint32_t>(length);
+            seg.length -= static_cast<std::uint32_t>(length);
+            size -= length;
+            if(0 != seg.length) {
+                break;
+            }
+            if(no_buffer != seg.buffer_id) {
+                context_.buffers.recycle(seg.buffer_id);
+                --held_buffers_;
+            }
+            ++first_segment_;
+        }
+        if(segments_.size() == first_segment_) {
+            segments_.clear();
+            first_segment_ = 0;
+        }
+    }
+
+    void uring_session::copy_incomplete_frame()
+    {
+        // a frame that is not complete yet does not hold a receive buffer,
+        // the copy is made only when nothing else is queued
+        if(sending_ || 0 != ready_bytes_ || 0 != complete_bytes_ || 1 != segments_.size() - first_segment_) {
+            return;
+        }
+        auto &seg{segments_[first_segment_]};
+        if(no_buffer == seg.buffer_id) {
+            return;
+        }
+        const auto *data{segment_data(seg)};
+        incomplete_frame_.assign(data, data + seg.length);
+        context_.buffers.recycle(seg.buffer_id);
+        --held_buffers_;
+        seg = segment{no_buffer, 0, seg.length};
+    }
+
+    void uring_session::recycle_segments() noexcept
+    {
+        for(std::size_t segment_idx = first_segment_; segment_idx < segments_.size(); ++segment_idx) {
+            if(no_buffer != segments_[segment_idx].buffer_id) {
+                context_.buffers.recycle(segments_[segment_idx].buffer_id);
+            }
+        }
+        segments_.clear();
+        first_segment_ = 0;
+        queued_bytes_ = 0;
+        held_buffers_ = 0;
+    }
+
+    void uring_session::update_receiving()
+    {
+        if(!wants_to_receive()) {
+            if(receiving_ && !receive_cancelled_) {
+                // the receive ends with ECANCELED, it is armed again when reading is resumed
+                receive_cancelled_ = true;
+                cancel(uring_op::client_recv);
+            }
+            return;
+        }
+        // a multishot receive takes every buffer a ready socket fills, so before
+        // forwarding, near its share of buffers and when the ring runs short
+        // the session takes them one receive at a time
+        const auto &buffers{context_.buffers};
+        const bool multishot{session_state::forwarding == state_ && buffers.taken() * 2 < buffers.count()
+                             && held_buffers_ + multishot_buffers <= buffer_share()};
+        if(receiving_) {
+            if(receive_multishot_ && !multishot && !receive_cancelled_) {
+                // the receive ends with ECANCELED and is armed again as a single one
+                receive_cancelled_ = true;
+                cancel(uring_op::client_recv);
+            }
+            return;
+        }
+        if(waiting_for_buffers_) {
+            return;
+        }
+        auto &sqe{context_.ring.next_sqe()};
+        sqe.opcode = IORING_OP_RECV;
+        sqe.fd = client_socket_;
+        sqe.ioprio = multishot ? IORING_RECV_MULTISHOT : 0;
+        sqe.flags = IOSQE_BUFFER_SELECT;
+        sqe.buf_group = context_.buffers.group_id();
+        sqe.user_data = user_data(uring_op::client_recv);
+        receiving_ = true;
+        receive_cancelled_ = false;
+        receive_multishot_ = multishot;
+        ++inflight_;
+        // time of a pause does not count as idle time
+        received_at_ = context_.now;
+    }
+
+    bool uring_session::wants_to_receive() const noexcept
+    {
+        if(client_eof_) {
+            return false;
+        }
+        const std::size_t max_pending_bytes{context_.options.session.max_pending_bytes};
+        switch(state_) {
+        case session_state::handshake:
+            return true;
+        case session_state::connecting:
+        case session_state::retrying:
+            return may_take_buffer() && (0 == max_pending_bytes || held_bytes() < max_pending_bytes);
+        case session_state::forwarding:
+            // buffers of an incomplete frame are held until it is received
+            return !throttled_ && (0 == ready_bytes_ || may_take_buffer());
+        default:
+            return false;
+        }
+    }
+
+    std::size_t uring_session::held_bytes() const noexcept
+    {
+        // a receive buffer can not be reused until all its bytes are sent
+        return std::max(queued_bytes_, held_buffers_ * context_.buffers.buffer_size());
+    }
+
+    bool uring_session::may_take_buffer() const noexcept
+    {
+        // the last quarter of the ring is kept for sessions that hold no buffer,
+        // new ones among them, so sessions that wait for their upstream can not
+        // take every buffer of the worker
+        const auto &buffers{context_.buffers};
+        return 0 == held_buffers_
+               || (held_buffers_ < buffer_share() && buffers.taken() < buffers.count() - buffers.count() / 4);
+    }
+
+    std::size_t uring_session::buffer_share() const noexcept
+    {
+        // the held part of the ring is split between sessions of the worker
+        const unsigned count{context_.buffers.count()};
+        const auto sessions{std::max<std::int64_t>(1, context_.stats.active_sessions.load(std::memory_order_relaxed))};
+        return std::max<std::size_t>(1, (count - count / 4) / static_cast<std::size_t>(sessions));
+    }
+
+    void uring_session::cancel(uring_op op)
+    {
+        auto &sqe{context_.ring.next_sqe()};
+        sqe.opcode = uring_op::retry_timer == op ? IORING_OP_TIMEOUT_REMOVE : IORING_OP_ASYNC_CANCEL;
+        sqe.addr = user_data(op);
+    }
+
+    const std::uint8_t *uring_session::segment_data(const segment &seg) const noexcept
+    {
+        const auto *data{no_buffer == seg.buffer_id ? incomplete_frame_.data() : context_.buffers.data(seg.buffer_id)};
+        return data + seg.offset;
+    }
+
+    void uring_session::count_forwarded(std::size_t frames, std::size_t bytes) noexcept
+    {
+        add(client_stats_->frames_out, frames);
+        add(client_stats_->bytes_out, bytes);
+        add(backend_traffic_->frames_out, frames);
+        add(backend_traffic_->bytes_out, bytes);
+    }
+
+    void uring_session::report_success()
+    {
+        if(backend_->health().on_success()) {
+            LOG4CPLUS_INFO(context_.logger, "Server " << backend_->server() << " is healthy again");
+        }
+    }
+
+    void uring_session::report_failure()
+    {
+        auto &health{backend_->health()};
+        if(health.on_failure(std::chrono::steady_clock::now(), context_.options.upstream.health)) {
+            LOG4CPLUS_ERROR(context_.logger, "Server " << backend_->server() << " is ejected for "
+                            << health.ejection_time().count() << " ms after failures");
+        }
+    }
+
+}
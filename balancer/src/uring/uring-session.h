@@ -0,0 +1,196 @@
+#pragma once
+
+#include "../common.h"
+#include "../stats/worker-stats.h"
+#include "../tcp-server/object-pool.h"
+#include "io-ring.h"
+#include <common/src/dns-cache.h>
+#include <proto/src/codec.h>
+#include <proto/src/init-message.h>
+#include <proto/src/stream-parser.h>
+
+#include <chrono>
+#include <vector>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <log4cplus/logger.h>
+
+namespace balancer {
+
+    // Operations of a session, kept in the low bits of user_data of their entries
+    enum class uring_op : std::uint64_t {
+        client_recv = 1,
+        upstream_connect,
+        upstream_send,
+        retry_timer
+    };
+
+    constexpr std::uint64_t uring_op_mask{7};
+
+    // What the sessions of one io_uring worker share
+    struct uring_context {
+        io_ring &ring;
+        buffer_ring &buffers;
+        route_map_view &route_map;
+        routing_policy &policy;
+        common::dns_cache &dns_cache;
+        const balancer_options &options;
+        worker_stats &stats;
+        log4cplus::Logger &logger;
+        // taken once per loop iteration
+        std::chrono::steady_clock::time_point now;
+    };
+
+    class uring_session;
+
+    class uring_session_owner {
+    public:
+        virtual ~uring_session_owner() = default;
+        // the session can be reused by the owner
+        virtual void on_session_closed(uring_session &session) = 0;
+        // receiving is resumed by resume_receiving() when some buffers are free
+        virtual void on_buffers_exhausted(uring_session &session) = 0;
+    };
+
+    /*
+     * Session of the io_uring engine with the state machine of tcp_session:
+     * the init message, routing with connect retries and forwarding.
+     * One multishot receive with provided buffers reads the client for the
+     * whole session. Received buffers are queued as they are and complete
+     * frames are sent to the dedicated upstream connection by sendmsg()
+     * straight from them, one send at a time, a buffer is recycled when
+     * all its bytes are sent. A frame that is not complete yet is copied
+     * out of its buffer, so an idle client holds no receive buffer, and a
+     * receive that fits after the last queued bytes is appended to them, so
+     * small frames do not take a buffer each.
+     * Reading is paused by cancelling the receive: above max_pending_bytes
+     * while connecting and above the high watermark of the upstream queue,
+     * both count every held buffer as full, and when the session holds its
+     * share of the worker's buffers.
+     * Timeouts are checked by the worker tick, a closed session waits for
+     * completions of its cancelled operations before it goes back to the owner.
+     */
+    class uring_session
+        : public intrusive_list_hook
+    {
+    public:
+        uring_session(uring_context &context, uring_session_owner &owner);
+
+    public:
+        void start(int socket);
+        void on_completion(uring_op op, const io_uring_cqe &cqe);
+        void check_timeouts();
+        void resume_receiving();
+        // closes the sockets right away, for the worker that is stopped
+        void abort() noexcept;
+
+    private:
+        enum class session_state {
+            handshake,      // the init message is not read yet
+            connecting,     // the upstream connection is not established yet
+            retrying,       // waiting for the next connect after a failed one
+            forwarding,
+            closing         // waiting for completions of cancelled operations
+        };
+
+        static constexpr std::uint16_t no_buffer{0xffff};
+
+        // received bytes that are not sent yet, the copy of an incomplete frame has no buffer
+        struct segment {
+            std::uint16_t buffer_id;
+            std::uint32_t offset;
+            std::uint32_t length;
+        };
+
+    private:
+        void reset() noexcept;
+        std::uint64_t user_data(uring_op op) const noexcept;
+        void drop_session(close_reason reason);
+        void finish_close();
+        void on_received(const io_uring_cqe &cqe);
+        void on_client_eof();
+        void read_init_message();
+        // Both leave the session connecting, retrying or closed
+        void route_to_backend();
+        void connect_to_server(const backend_ptr &backend);
+        void on_connected(const io_uring_cqe &cqe);
+        void on_sent(const io_uring_cqe &cqe);
+        void on_retry_timer();
+        void start_forwarding();
+        void schedule_retry();
+        std::chrono::milliseconds next_retry_delay();
+        void close_socket(int &socket);
+        void detach_backend() noexcept;
+        // returns the queued bytes, they can be appended to the buffer of the last segment
+        segment queue_segment(std::uint16_t buffer_id, std::size_t offset, std::size_t length);
+        // returns false if the session is closed
+        bool scan_segment(const segment &seg);
+        bool scan_chunk(const std::uint8_t *data, std::size_t size);
+        void forward_complete_frames();
+        void send_ready_bytes();
+        void consume_sent(std::size_t size) noexcept;
+        void copy_incomplete_frame();
+        void recycle_segments() noexcept;
+        void update_receiving();
+        bool wants_to_receive() const noexcept;
+        std::size_t held_bytes() const noexcept;
+        bool may_take_buffer() const noexcept;
+        std::size_t buffer_share() const noexcept;
+        void cancel(uring_op op);
+        const std::uint8_t *segment_data(const segment &seg) const noexcept;
+        void count_forwarded(std::size_t frames, std::size_t bytes) noexcept;
+        void report_success();
+        void report_failure();
+
+    private:
+        uring_context &context_;
+        uring_session_owner &owner_;
+        session_state state_{session_state::handshake};
+        int client_socket_{-1};
+        int upstream_socket_{-1};
+        // operations whose last completion is not reaped yet
+        unsigned inflight_{0};
+        bool receiving_{false};
+        bool receive_cancelled_{false};
+        bool receive_multishot_{false};
+        bool waiting_for_buffers_{false};
+        bool connect_pending_{false};
+        bool connect_timed_out_{false};
+        bool retry_pending_{false};
+        bool sending_{false};
+        bool throttled_{false};
+        bool client_eof_{false};
+        proto::codec::init_frame init_frame_;
+        std::size_t init_length_{0};
+        proto::init_message::client_id_t client_id_{0};
+        client_stats *client_stats_{nullptr};
+        backend_ptr backend_;
+        backend_traffic *backend_traffic_{nullptr};
+        // the backend of the last failed connect is avoided by the next one
+        backend_ptr failed_backend_;
+        std::uint32_t connect_attempts_{0};
+        sockaddr_in upstream_address_;
+        __kernel_timespec retry_delay_;
+        std::chrono::steady_clock::time_point started_at_;
+        std::chrono::steady_clock::time_point received_at_;
+        std::chrono::steady_clock::time_point connect_started_at_;
+        std::chrono::steady_clock::time_point sent_at_;
+        std::vector<segment> segments_;
+        std::size_t first_segment_{0};
+        proto::bytes incomplete_frame_;
+        // bytes of all queued segments and complete frames at their front
+        std::size_t queued_bytes_{0};
+        std::size_t ready_bytes_{0};
+        // receive buffers taken by queued segments
+        std::size_t held_buffers_{0};
+        // complete frames scanned but not handed to the send queue yet
+        std::size_t complete_bytes_{0};
+        std::size_t complete_frames_{0};
+        proto::stream_parser parser_;
+        std::vector<std::uint32_t> payloads_;
+        std::vector<iovec> iovecs_;
+        msghdr message_;
+    };
+
+}
@@ -0,0 +1,97 @@
+#include "control-loop.h"
+#include <common/src/utils.h>
+
+#include <stdexcept>
+#include <log4cplus/loggingmacros.h>
+
+namespace {
+
+    const timeval resolve_interval{1, 0};
+
+}
+
+namespace balancer {
+
+    control_loop::control_loop(const route_map_holder &route_map,
+                               const balancer_options &options,
+                               common::dns_cache &dns_cache)
+        : route_map_{route_map}
+        , options_{options}
+        , dns_cache_{dns_cache}
+        , logger_{common::make_logger("control_loop")}
+    { }
+
+    void control_loop::bind()
+    {
+        eb_ = common::event_base_ptr(event_base_new());
+        if(!eb_) {
+            throw std::runtime_error{"Can not create new event_base"};
+        }
+        timeouts_ = std::make_unique<common::common_timeouts>(eb_.get(), options_.timeouts);
+        resolver_ = std::make_unique<common::async_resolver>(eb_.get(), dns_cache_);
+
+        const auto on_timer = [](evutil_socket_t /*fd*/, short /*what*/, void *ctx)
+        {
+            static_cast<control_loop *>(ctx)->resolve_backends();
+        };
+        resolve_timer_ = common::event_ptr(event_new(eb_.get(), -1, EV_PERSIST, on_timer, this));
+        if(!resolve_timer_ || -1 == evtimer_add(resolve_timer_.get(), &resolve_interval)) {
+            throw std::runtime_error{"Can not start backend resolve timer"};
+        }
+        resolve_backends();
+    }
+
+    void control_loop::resolve_backends()
+    {
+        const auto route_map{route_map_.load()};
+        for(const auto &backend : route_map->backends()) {
+            if(nullptr != backend.second->address()) {
+                continue;
+            }
+            // concurrent requests of a host are merged, the result is taken from the cache
+            const auto &server{backend.second->server()};
+            const auto on_resolved{[this, server](int error, const sockaddr_in &/*sock*/) {
+                if(0 != error) {
+                    LOG4CPLUS_ERROR(logger_, "Can not resolve server " << server
+                                    << ", error: " << common::async_resolver::error_message(error));
+                }
+            }};
+            sockaddr_in sock;
+            common::async_resolver::request_id_t request_id;
+            resolver_->resolve(server, sock, on_resolved, request_id);
+        }
+    }
+
+    void control_loop::run()
+    {
+        if(-1 == event_base_dispatch(eb_.get())) {
+            throw std::runtime_error{"Can not run control event loop"};
+        }
+    }
+
+    void control_loop::stop()
+    {
+        resolve_timer_.reset();
+        resolver_.reset();
+        if(eb_) {
+            event_base_loopbreak(eb_.get());
+            eb_.reset();
+        }
+    }
+
+    event_base *control_loop::base() const noexcept
+    {
+        return eb_.get();
+    }
+
+    const common::common_timeouts &control_loop::timeouts() const noexcept
+    {
+        return *timeouts_;
+    }
+
+    common::async_resolver &control_loop::resolver() noexcept
+    {
+        return *resolver_;
+    }
+
+}
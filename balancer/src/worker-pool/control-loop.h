@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../common.h"
+#include "../tcp-server/io-worker.h"
+#include "../route-map/route-map-holder.h"
+#include <common/src/types.h>
+
+#include <memory>
+#include <log4cplus/logger.h>
+
+namespace balancer {
+
+    /*
+     * Event loop without sessions for the metrics endpoint and health checks
+     * when workers have no event_base of their own, as io_uring workers do.
+     * It runs on the thread that started the workers. Such workers can not
+     * resolve host names, so the loop keeps addresses of all backends of
+     * the route map in the dns_cache, missing ones are resolved every second.
+     */
+    class control_loop
+        : public service_loop
+    {
+    public:
+        control_loop(const route_map_holder &route_map,
+                     const balancer_options &options,
+                     common::dns_cache &dns_cache);
+
+    public:
+        void bind();
+        // returns when the loop has no events
+        void run();
+        void stop();
+        event_base *base() const noexcept override;
+        const common::common_timeouts &timeouts() const noexcept override;
+        common::async_resolver &resolver() noexcept override;
+
+    private:
+        void resolve_backends();
+
+    private:
+        const route_map_holder &route_map_;
+        const balancer_options &options_;
+        common::dns_cache &dns_cache_;
+        common::event_base_ptr eb_;
+        std::unique_ptr<common::common_timeouts> timeouts_;
+        std::unique_ptr<common::async_resolver> resolver_;
+        common::event_ptr resolve_timer_;
+        log4cplus::Logger logger_;
+    };
+
+}
@@ -0,0 +1,138 @@
+#include "worker-pool.h"
+#include "../metrics/metrics-collector.h"
+#include <common/src/utils.h>
+
+#include <thread>
+#include <stdexcept>
+#include <log4cplus/loggingmacros.h>
+
+namespace balancer {
+
+    worker_pool::worker_pool(std::size_t workers_count,
+                             std::uint16_t port,
+                             const route_map_holder &route_map,
+                             const balancer_options &options,
+                             common::dns_cache &dns_cache)
+        : logger_{common::make_logger("worker_pool")}
+        , route_map_{route_map}
+        , metrics_port_{options.metrics_port}
+        , health_options_{options.upstream.health}
+    {
+        if(0 == workers_count) {
+            throw std::invalid_argument{"Workers count must be greater than zero"};
+        }
+        const bool reuse_port{workers_count > 1};
+        workers_.reserve(workers_count);
+        for(std::size_t worker_id = 0; worker_id < workers_count; ++worker_id) {
+            if(io_engine::uring == options.engine) {
+                workers_.emplace_back(std::make_unique<uring_server>(port, route_map, options, dns_cache,
+                                                                     worker_id, reuse_port));
+                continue;
+            }
+            auto worker{std::make_unique<tcp_server>(port, route_map, options, dns_cache, worker_id, reuse_port)};
+            if(nullptr == services_) {
+                services_ = worker.get();
+            }
+            workers_.emplace_back(std::move(worker));
+        }
+        if(io_engine::uring == options.engine) {
+            control_loop_ = std::make_unique<control_loop>(route_map, options, dns_cache);
+            services_ = control_loop_.get();
+        }
+    }
+
+    void worker_pool::start()
+    {
+        for(auto &worker : workers_) {
+            worker->bind();
+        }
+        if(control_loop_) {
+            control_loop_->bind();
+        }
+        if(0 != metrics_port_) {
+            metrics_server_ = std::make_unique<metrics_server>(services_->base(), metrics_port_,
+                                                               [this]() { return collect_metrics(); });
+            metrics_server_->start();
+        }
+        if(0 != health_options_.check_interval.count()) {
+            health_checker_ = std::make_unique<health_checker>(services_->base(), route_map_, health_options_,
+                                                               services_->timeouts(), services_->resolver());
+            health_checker_->start();
+        }
+
+        LOG4CPLUS_INFO(logger_, "Start " << workers_.size() << " worker(s)");
+        // this thread runs the loop of the services
+        const auto first_thread_worker{control_loop_ ? workers_.begin() : std::next(workers_.begin())};
+        std::vector<std::thread> threads;
+        threads.reserve(workers_.size());
+        for(auto worker_it = first_thread_worker; worker_it != workers_.end(); ++worker_it) {
+            auto &worker{**worker_it};
+            threads.emplace_back([this, &worker]() { run_worker(worker); });
+        }
+        if(control_loop_) {
+            run_control_loop();
+        } else {
+            run_worker(*workers_.front());
+        }
+
+        for(auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    void worker_pool::stop()
+    {
+        std::uint64_t upstream_throttles{0};
+        std::uint64_t session_pauses{0};
+        // the endpoint and the checker are freed before the event loop of their worker
+        if(metrics_server_) {
+            metrics_server_->stop();
+            metrics_server_.reset();
+        }
+        if(health_checker_) {
+            health_checker_->stop();
+            health_checker_.reset();
+        }
+        for(auto &worker : workers_) {
+            worker->stop();
+            upstream_throttles += worker->stats().upstream_throttles.load(std::memory_order_relaxed);
+            session_pauses += worker->stats().session_pauses.load(std::memory_order_relaxed);
+        }
+        if(control_loop_) {
+            control_loop_->stop();
+        }
+        LOG4CPLUS_INFO(logger_, "Upstream connections were throttled " << upstream_throttles
+                       << " time(s), client sessions were paused " << session_pauses << " time(s)");
+    }
+
+    std::string worker_pool::collect_metrics() const
+    {
+        std::vector<const worker_stats *> stats;
+        stats.reserve(workers_.size());
+        for(const auto &worker : workers_) {
+            stats.push_back(&worker->stats());
+        }
+        return balancer::collect_metrics(stats, *route_map_.load());
+    }
+
+    void worker_pool::run_control_loop() noexcept
+    {
+        try {
+            control_loop_->run();
+        } catch (const std::exception &ex) {
+            LOG4CPLUS_ERROR(logger_, "Control loop failed with error: " << ex.what());
+        }
+    }
+
+    void worker_pool::run_worker(io_worker &worker) noexcept
+    {
+        try {
+            worker.run();
+        } catch (const std::exception &ex) {
+            LOG4CPLUS_ERROR(logger_, "Worker failed with error: " << ex.what());
+        } catch (...) {
+            LOG4CPLUS_ERROR(logger_, "Worker failed with unknown error");
+        }
+    }
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "../common.h"
+#include "../tcp-server/tcp-server.h"
+#include "../uring/uring-server.h"
+#include "control-loop.h"
+#include "../metrics/metrics-server.h"
+#include "../health/health-checker.h"
+
+#include <vector>
+#include <memory>
+
+namespace balancer {
+
+    /*
+     * Every worker is a tcp_server with its own event_base, listener and
+     * session list (or a uring_server with its own ring with the io_uring
+     * engine), workers share only read-only route map and options.
+     * Listeners are bound with SO_REUSEPORT, so the kernel spreads
+     * incoming connections between workers.
+     * Metrics of all workers and health checks of backends are served
+     * by the loop of the first tcp_server, io_uring workers have no
+     * event loop for them, so a control_loop runs on the starting thread.
+     */
+    class worker_pool {
+    public:
+        worker_pool(std::size_t workers_count,
+                    std::uint16_t port,
+                    const route_map_holder &route_map,
+                    const balancer_options &options,
+                    common::dns_cache &dns_cache);
+        void start();
+        void stop();
+
+    private:
+        void run_worker(io_worker &worker) noexcept;
+        void run_control_loop() noexcept;
+        std::string collect_metrics() const;
+
+    private:
+        log4cplus::Logger logger_;
+        const route_map_holder &route_map_;
+        const std::uint16_t metrics_port_;
+        const health_options &health_options_;
+        std::vector<std::unique_ptr<io_worker>> workers_;
+        std::unique_ptr<control_loop> control_loop_;
+        // the first tcp_server or the control loop
+        service_loop *services_{nullptr};
+        std::unique_ptr<metrics_server> metrics_server_;
+        std::unique_ptr<health_checker> health_checker_;
+    };
+
+}
@@ -0,0 +1,63 @@
+#include "alloc-counter.h"
+
+#include <event2/event.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+    std::atomic<std::uint64_t> allocations{0};
+
+    void count_allocation() noexcept
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+}
+
+namespace benchmarks {
+
+    std::uint64_t allocations_count() noexcept
+    {
+        return allocations.load(std::memory_order_relaxed);
+    }
+
+    void count_libevent_allocations()
+    {
+        const auto malloc_fn = [](std::size_t size) {
+            count_allocation();
+            return std::malloc(size);
+        };
+        const auto realloc_fn = [](void *ptr, std::size_t size) {
+            count_allocation();
+            return std::realloc(ptr, size);
+        };
+        const auto free_fn = [](void *ptr) {
+            std::free(ptr);
+        };
+        event_set_mem_functions(malloc_fn, realloc_fn, free_fn);
+    }
+
+}
+
+// array and nothrow forms call these ones
+void *operator new(std::size_t size)
+{
+    count_allocation();
+    if(void *ptr = std::malloc(0 == size ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t /*size*/) noexcept
+{
+    std::free(ptr);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+namespace benchmarks {
+
+    // Count of heap allocations in the process since its start: operator new calls
+    // and allocations of libevent after count_libevent_allocations()
+    std::uint64_t allocations_count() noexcept;
+
+    // Must be called before any libevent object is created
+    void count_libevent_allocations();
+
+}
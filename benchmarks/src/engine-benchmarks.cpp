@@ -0,0 +1,288 @@
+#include "utils.h"
+#include "syscall-counter.h"
+
+#include <balancer/src/tcp-server/tcp-server.h>
+#include <balancer/src/uring/uring-server.h>
+#include <common/src/utils.h>
+#include <proto/src/codec.h>
+
+#include <ctime>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+#include <functional>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+namespace {
+
+    using namespace benchmarks;
+
+    constexpr std::uint16_t balancer_port{18888};
+    constexpr std::size_t frames_per_client{4096};
+    constexpr int poll_timeout_ms{5000};
+
+    int make_socket()
+    {
+        const int socket{::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+        if(-1 == socket) {
+            throw std::runtime_error{"Can not create socket"};
+        }
+        return socket;
+    }
+
+    void set_nonblocking(int socket)
+    {
+        if(-1 == fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK)) {
+            throw std::runtime_error{"Can not make socket nonblocking"};
+        }
+    }
+
+    std::chrono::nanoseconds thread_cpu_time(std::thread &thread)
+    {
+        clockid_t clock_id;
+        timespec time;
+        if(0 != pthread_getcpuclockid(thread.native_handle(), &clock_id) || -1 == clock_gettime(clock_id, &time)) {
+            return std::chrono::nanoseconds{0};
+        }
+        return std::chrono::seconds{time.tv_sec} + std::chrono::nanoseconds{time.tv_nsec};
+    }
+
+    /*
+     * One worker of an I/O engine on its own thread between clients and
+     * a backend of this thread, all over loopback. Both sides are driven
+     * by poll() of the benchmark thread, so the worker thread does only
+     * the work of the balancer.
+     */
+    class engine_bench {
+    public:
+        engine_bench(balancer::io_engine engine, std::size_t clients);
+        ~engine_bench();
+
+    public:
+        // Every client writes its frames once, returns when the backend has read all of them
+        void transfer();
+        std::uint64_t worker_syscalls() const noexcept;
+        std::chrono::nanoseconds worker_cpu_time();
+
+    private:
+        balancer::route_map_ptr make_route_map();
+        void connect_clients(std::size_t clients);
+        void shutdown() noexcept;
+
+    private:
+        int backend_{-1};
+        balancer::route_map_holder route_map_;
+        balancer::balancer_options options_;
+        common::dns_cache dns_cache_{std::chrono::seconds{60}};
+        std::unique_ptr<balancer::io_worker> worker_;
+        std::function<void()> break_loop_;
+        std::thread thread_;
+        std::vector<int> clients_;
+        std::vector<int> upstreams_;
+        proto::bytes frames_;
+        proto::bytes sink_;
+    };
+
+    engine_bench::engine_bench(balancer::io_engine engine, std::size_t clients)
+        : route_map_{make_route_map()}
+    {
+        options_.engine = engine;
+        options_.upstream.health.max_failures = 0;
+        if(balancer::io_engine::uring == engine) {
+            auto worker{std::make_unique<balancer::uring_server>(balancer_port, route_map_, options_, dns_cache_)};
+            auto *uring_worker{worker.get()};
+            break_loop_ = [uring_worker]() { uring_worker->break_loop(); };
+            worker_ = std::move(worker);
+        } else {
+            // the loop is broken from the benchmark thread
+            auto worker{std::make_unique<balancer::tcp_server>(balancer_port, route_map_, options_, dns_cache_)};
+            auto *tcp_worker{worker.get()};
+            break_loop_ = [tcp_worker]() { event_base_loopbreak(tcp_worker->base()); };
+            worker_ = std::move(worker);
+        }
+
+        try {
+            worker_->bind();
+            thread_ = std::thread{[this]() {
+                count_thread_syscalls();
+                worker_->run();
+            }};
+            connect_clients(clients);
+        } catch (...) {
+            shutdown();
+            throw;
+        }
+
+        frames_.resize(frames_per_client * proto::codec::regular_length);
+        for(std::size_t frame_idx = 0; frame_idx < frames_per_client; ++frame_idx) {
+            proto::codec::store_regular(frames_.data() + frame_idx * proto::codec::regular_length,
+                                        static_cast<std::uint32_t>(frame_idx));
+        }
+        sink_.resize(256 * 1024);
+    }
+
+    engine_bench::~engine_bench()
+    {
+        shutdown();
+    }
+
+    void engine_bench::transfer()
+    {
+        std::vector<std::size_t> sent(clients_.size(), 0);
+        std::size_t to_receive{frames_.size() * clients_.size()};
+        std::vector<pollfd> poll_fds;
+        while(to_receive > 0) {
+            poll_fds.clear();
+            for(std::size_t client_idx = 0; client_idx < clients_.size(); ++client_idx) {
+                if(sent[client_idx] < frames_.size()) {
+                    poll_fds.push_back({clients_[client_idx], POLLOUT, 0});
+                }
+            }
+            const std::size_t first_upstream{poll_fds.size()};
+            for(const int upstream : upstreams_) {
+                poll_fds.push_back({upstream, POLLIN, 0});
+            }
+            if(poll(poll_fds.data(), poll_fds.size(), poll_timeout_ms) <= 0) {
+                throw std::runtime_error{"Frames are not forwarded in time"};
+            }
+
+            for(std::size_t fd_idx = 0, client_idx = 0; fd_idx < first_upstream; ++client_idx) {
+                if(sent[client_idx] == frames_.size()) {
+                    continue;
+                }
+                if(poll_fds[fd_idx++].revents & POLLOUT) {
+                    const ssize_t result{send(clients_[client_idx], frames_.data() + sent[client_idx],
+                                              frames_.size() - sent[client_idx], MSG_NOSIGNAL)};
+                    sent[client_idx] += result > 0 ? static_cast<std::size_t>(result) : 0;
+                }
+            }
+            for(std::size_t fd_idx = first_upstream; fd_idx < poll_fds.size(); ++fd_idx) {
+                if(0 == (poll_fds[fd_idx].revents & (POLLIN | POLLHUP))) {
+                    continue;
+                }
+                const ssize_t result{recv(poll_fds[fd_idx].fd, sink_.data(), sink_.size(), 0)};
+                if(0 == result) {
+                    throw std::runtime_error{"Balancer closed backend connection"};
+                }
+                to_receive -= result > 0 ? static_cast<std::size_t>(result) : 0;
+            }
+        }
+    }
+
+    std::uint64_t engine_bench::worker_syscalls() const noexcept
+    {
+        return syscalls_count() + worker_->stats().uring_enters.load(std::memory_order_relaxed);
+    }
+
+    std::chrono::nanoseconds engine_bench::worker_cpu_time()
+    {
+        return thread_cpu_time(thread_);
+    }
+
+    balancer::route_map_ptr engine_bench::make_route_map()
+    {
+        backend_ = make_socket();
+        const sockaddr_in backend{common::make_sockaddr(INADDR_LOOPBACK, 0)};
+        sockaddr_in bound;
+        socklen_t bound_length{sizeof(bound)};
+        if(-1 == bind(backend_, reinterpret_cast<const sockaddr *>(&backend), sizeof(backend))
+                || -1 == listen(backend_, SOMAXCONN)
+                || -1 == getsockname(backend_, reinterpret_cast<sockaddr *>(&bound), &bound_length)) {
+            close(backend_);
+            throw std::runtime_error{"Can not start backend"};
+        }
+        set_nonblocking(backend_);
+        auto route_map{std::make_shared<balancer::route_map>()};
+        const common::remote_server server{"127.0.0.1", ntohs(bound.sin_port)};
+        route_map->set_default_route({std::make_shared<balancer::backend>(server)});
+        route_map->build();
+        return route_map;
+    }
+
+    void engine_bench::connect_clients(std::size_t clients)
+    {
+        const auto init_frame{proto::codec::make_init_frame(1)};
+        const sockaddr_in balancer{common::make_sockaddr(INADDR_LOOPBACK, balancer_port)};
+        for(std::size_t client_idx = 0; client_idx < clients; ++client_idx) {
+            clients_.push_back(make_socket());
+            if(-1 == connect(clients_.back(), reinterpret_cast<const sockaddr *>(&balancer), sizeof(balancer))
+                    || static_cast<ssize_t>(init_frame.size()) != send(clients_.back(), init_frame.data(),
+                                                                        init_frame.size(), MSG_NOSIGNAL)) {
+                throw std::runtime_error{"Can not connect to balancer"};
+            }
+            set_nonblocking(clients_.back());
+            // every session connects to the backend when its init message is read
+            pollfd backend{backend_, POLLIN, 0};
+            const int upstream{poll(&backend, 1, poll_timeout_ms) > 0
+                    ? accept4(backend_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK) : -1};
+            if(-1 == upstream) {
+                throw std::runtime_error{"Balancer does not connect to backend"};
+            }
+            upstreams_.push_back(upstream);
+        }
+    }
+
+    void engine_bench::shutdown() noexcept
+    {
+        for(const int socket : clients_) {
+            close(socket);
+        }
+        clients_.clear();
+        for(const int socket : upstreams_) {
+            close(socket);
+        }
+        upstreams_.clear();
+        if(thread_.joinable()) {
+            break_loop_();
+            thread_.join();
+        }
+        worker_->stop();
+        if(-1 != backend_) {
+            close(backend_);
+            backend_ = -1;
+        }
+    }
+
+    // Arg is the clients count, every client forwards 4096 frames per iteration through one worker.
+    // Syscalls and cpu time are those of the worker thread, io_uring_enter calls are counted
+    // by the io_uring engine itself, the others are taken from libc
+    void engine_forward(benchmark::State &state, balancer::io_engine engine)
+    {
+        const auto clients{static_cast<std::size_t>(state.range(0))};
+        std::unique_ptr<engine_bench> bench;
+        try {
+            bench = std::make_unique<engine_bench>(engine, clients);
+        } catch (const std::exception &ex) {
+            state.SkipWithError(ex.what());
+            return;
+        }
+        const auto syscalls_at_start{bench->worker_syscalls()};
+        const auto cpu_at_start{bench->worker_cpu_time()};
+        {
+            frame_counters counters{state, frames_per_client * clients};
+            for(auto _ : state) {
+                try {
+                    bench->transfer();
+                } catch (const std::exception &ex) {
+                    state.SkipWithError(ex.what());
+                    break;
+                }
+            }
+        }
+
+        const auto frames{static_cast<double>(frames_per_client * clients * static_cast<std::size_t>(state.iterations()))};
+        state.counters["syscalls_per_frame"] = static_cast<double>(bench->worker_syscalls() - syscalls_at_start) / frames;
+        state.counters["worker_cpu_per_frame"] = benchmark::Counter(
+                    std::chrono::duration<double>(bench->worker_cpu_time() - cpu_at_start).count() / frames);
+    }
+    BENCHMARK_CAPTURE(engine_forward, libevent, balancer::io_engine::libevent)
+        ->ArgName("clients")->Arg(1)->Arg(16)->UseRealTime();
+    BENCHMARK_CAPTURE(engine_forward, uring, balancer::io_engine::uring)
+        ->ArgName("clients")->Arg(1)->Arg(16)->UseRealTime();
+
+}
@@ -0,0 +1,35 @@
+#include "alloc-counter.h"
+
+#include <benchmark/benchmark.h>
+#include <event2/thread.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Results are printed as JSON unless another format is asked for,
+// so that runs of different builds can be compared by compare.py of Google Benchmark
+int main(int argc, char **argv)
+{
+    benchmarks::count_libevent_allocations();
+    // engine benchmarks break event loops of their worker threads
+    evthread_use_pthreads();
+
+    std::vector<char *> args{argv, argv + argc};
+    bool has_format{false};
+    for(int arg_idx = 1; arg_idx < argc; ++arg_idx) {
+        has_format = has_format || 0 == std::strncmp(argv[arg_idx], "--benchmark_format", std::strlen("--benchmark_format"));
+    }
+    std::string json_format{"--benchmark_format=json"};
+    if(!has_format) {
+        args.push_back(&json_format[0]);
+    }
+
+    int args_count{static_cast<int>(args.size())};
+    benchmark::Initialize(&args_count, args.data());
+    if(benchmark::ReportUnrecognizedArguments(args_count, args.data())) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
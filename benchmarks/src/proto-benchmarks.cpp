@@ -0,0 +1,139 @@
+#include "utils.h"
+
+#include <proto/src/init-message.h>
+#include <proto/src/regular-message.h>
+#include <proto/src/bulk-decoder.h>
+#include <proto/src/stream-parser.h>
+
+namespace {
+
+    using namespace benchmarks;
+
+    constexpr std::size_t frames_count{4096};
+
+    proto::bytes make_regular_frames(std::size_t count)
+    {
+        proto::bytes data(count * proto::codec::regular_length);
+        for(std::size_t idx = 0; idx < count; ++idx) {
+            proto::codec::store_regular(data.data() + idx * proto::codec::regular_length, static_cast<std::uint32_t>(idx));
+        }
+        return data;
+    }
+
+    // Messages, the compatibility API which owns bytes
+
+    void init_message_save(benchmark::State &state)
+    {
+        frame_counters counters{state, 1};
+        proto::init_message::client_id_t client_id{0};
+        for(auto _ : state) {
+            auto msg{proto::make_message<proto::init_message>(++client_id)};
+            benchmark::DoNotOptimize(msg.as_bytes().data());
+        }
+    }
+    BENCHMARK(init_message_save);
+
+    void init_message_load(benchmark::State &state)
+    {
+        frame_counters counters{state, 1};
+        const auto data{proto::make_init_message(42).as_bytes()};
+        for(auto _ : state) {
+            proto::init_message msg{data};
+            msg.load();
+            benchmark::DoNotOptimize(msg.client_id());
+        }
+    }
+    BENCHMARK(init_message_load);
+
+    void regular_message_save(benchmark::State &state)
+    {
+        frame_counters counters{state, 1};
+        proto::regular_message::payload_t payload{0};
+        for(auto _ : state) {
+            auto msg{proto::make_message<proto::regular_message>(++payload)};
+            benchmark::DoNotOptimize(msg.as_bytes().data());
+        }
+    }
+    BENCHMARK(regular_message_save);
+
+    void regular_message_load(benchmark::State &state)
+    {
+        frame_counters counters{state, 1};
+        const auto data{proto::make_message<proto::regular_message>(42).as_bytes()};
+        for(auto _ : state) {
+            proto::regular_message msg{data};
+            msg.load();
+            benchmark::DoNotOptimize(msg.payload());
+        }
+    }
+    BENCHMARK(regular_message_load);
+
+    // Codec, what the hot path uses instead of messages
+
+    void codec_store_regular(benchmark::State &state)
+    {
+        frame_counters counters{state, 1};
+        std::uint32_t payload{0};
+        for(auto _ : state) {
+            auto frame{proto::codec::make_regular_frame(++payload)};
+            benchmark::DoNotOptimize(frame);
+        }
+    }
+    BENCHMARK(codec_store_regular);
+
+    void codec_decode_regular(benchmark::State &state)
+    {
+        frame_counters counters{state, 1};
+        const auto frame{proto::codec::make_regular_frame(42)};
+        for(auto _ : state) {
+            std::uint32_t payload{0};
+            benchmark::DoNotOptimize(proto::codec::decode(frame.data(), frame.size(), proto::message_type::regular, payload));
+            benchmark::DoNotOptimize(payload);
+        }
+    }
+    BENCHMARK(codec_decode_regular);
+
+    // Arg is proto::bulk_decoder_impl
+    void bulk_decode_regular(benchmark::State &state)
+    {
+        const auto impl{static_cast<proto::bulk_decoder_impl>(state.range(0))};
+        if(!proto::is_supported(impl)) {
+            state.SkipWithError("Not supported by the CPU");
+            return;
+        }
+        frame_counters counters{state, frames_count};
+        const auto data{make_regular_frames(frames_count)};
+        std::vector<std::uint32_t> payloads(frames_count);
+        for(auto _ : state) {
+            benchmark::DoNotOptimize(proto::decode_regular_frames(impl, data.data(), frames_count, payloads.data()));
+            benchmark::ClobberMemory();
+        }
+    }
+    BENCHMARK(bulk_decode_regular)
+        ->ArgName("impl")
+        ->Arg(static_cast<int>(proto::bulk_decoder_impl::scalar))
+        ->Arg(static_cast<int>(proto::bulk_decoder_impl::sse4))
+        ->Arg(static_cast<int>(proto::bulk_decoder_impl::avx2));
+
+    // Arg is the size of pieces the stream is fed by
+    void stream_parser_regular(benchmark::State &state)
+    {
+        frame_counters counters{state, frames_count};
+        const auto data{make_regular_frames(frames_count)};
+        const auto piece_size{static_cast<std::size_t>(state.range(0))};
+        proto::stream_parser parser;
+        for(auto _ : state) {
+            std::size_t frames{0};
+            for(std::size_t piece_pos = 0; piece_pos < data.size(); piece_pos += piece_size) {
+                const std::size_t piece_length{std::min(piece_size, data.size() - piece_pos)};
+                for(std::size_t pos = 0; pos < piece_length;) {
+                    pos += parser.feed(data.data() + piece_pos + pos, piece_length - pos);
+                    frames += parser.complete() ? 1 : 0;
+                }
+            }
+            benchmark::DoNotOptimize(frames);
+        }
+    }
+    BENCHMARK(stream_parser_regular)->ArgName("piece")->Arg(7)->Arg(4096)->Arg(64 * 1024);
+
+}
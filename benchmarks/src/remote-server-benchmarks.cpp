@@ -0,0 +1,21 @@
+#include "utils.h"
+
+#include <common/src/remote-server.h>
+
+namespace {
+
+    using namespace benchmarks;
+
+    // Address of a backend as it is made on every upstream connect without the dns cache
+    void remote_server_sockaddr(benchmark::State &state, const std::string &host)
+    {
+        const common::remote_server server{host, 9000};
+        frame_counters counters{state, 1};
+        for(auto _ : state) {
+            benchmark::DoNotOptimize(server.sockaddr());
+        }
+    }
+    BENCHMARK_CAPTURE(remote_server_sockaddr, ipv4, std::string{"127.0.0.1"});
+    BENCHMARK_CAPTURE(remote_server_sockaddr, localhost, std::string{"localhost"});
+
+}
@@ -0,0 +1,61 @@
+#include "utils.h"
+
+#include <balancer/src/route-map/route-map.h>
+
+#include <random>
+
+namespace {
+
+    using namespace benchmarks;
+
+    constexpr std::size_t lookups_count{4096};
+
+    balancer::route_map make_route_map(std::size_t routes_count, std::uint32_t id_step)
+    {
+        std::vector<balancer::backend_group> groups;
+        for(std::uint16_t port = 9000; port < 9008; ++port) {
+            groups.push_back({std::make_shared<balancer::backend>(common::remote_server{"127.0.0.1", port})});
+        }
+        balancer::route_map route_map;
+        for(std::size_t route_idx = 0; route_idx < routes_count; ++route_idx) {
+            route_map.add_route(static_cast<std::uint32_t>(route_idx) * id_step, groups[route_idx % groups.size()]);
+        }
+        route_map.build();
+        return route_map;
+    }
+
+    // Ids of routed clients in random order, so lookups do not walk the table sequentially
+    std::vector<std::uint32_t> make_lookups(std::size_t routes_count, std::uint32_t id_step)
+    {
+        std::mt19937 generator{42};
+        std::uniform_int_distribution<std::size_t> route_idx{0, routes_count - 1};
+        std::vector<std::uint32_t> lookups(lookups_count);
+        for(auto &client_id : lookups) {
+            client_id = static_cast<std::uint32_t>(route_idx(generator)) * id_step;
+        }
+        return lookups;
+    }
+
+    // Args are routes count and the step between client ids, big steps make the table sparse
+    void route_map_find(benchmark::State &state)
+    {
+        const auto routes_count{static_cast<std::size_t>(state.range(0))};
+        const auto id_step{static_cast<std::uint32_t>(state.range(1))};
+        const auto route_map{make_route_map(routes_count, id_step)};
+        const auto lookups{make_lookups(routes_count, id_step)};
+
+        frame_counters counters{state, lookups_count};
+        for(auto _ : state) {
+            for(const auto client_id : lookups) {
+                benchmark::DoNotOptimize(route_map.find(client_id));
+            }
+        }
+    }
+    BENCHMARK(route_map_find)
+        ->ArgNames({"routes", "step"})
+        ->Args({1000, 1})
+        ->Args({100000, 1})
+        ->Args({1000, 100000})
+        ->Args({100000, 10000});
+
+}
@@ -0,0 +1,98 @@
+#include "utils.h"
+
+#include <balancer/src/tcp-session/input-scanner.h>
+#include <common/src/types.h>
+
+#include <stdexcept>
+#include <sys/uio.h>
+
+namespace {
+
+    using namespace benchmarks;
+
+    constexpr std::size_t frames_count{16 * 1024};
+
+    // Counts frames found by the scanner of tcp_session, without logging and stats
+    class frame_counter : public balancer::input_observer {
+    public:
+        void on_regular_frames(const std::uint32_t */*payloads*/, std::size_t count) override
+        {
+            frames += count;
+        }
+
+        balancer::scan_action on_frame(const proto::frame_info &/*frame*/) override
+        {
+            ++frames;
+            return balancer::scan_action::next;
+        }
+
+        void on_invalid_input(const std::string &error) override
+        {
+            throw std::runtime_error{"Invalid frame: " + error};
+        }
+
+    public:
+        std::size_t frames{0};
+    };
+
+    proto::bytes make_regular_frames(std::size_t count)
+    {
+        proto::bytes data(count * proto::codec::regular_length);
+        for(std::size_t idx = 0; idx < count; ++idx) {
+            proto::codec::store_regular(data.data() + idx * proto::codec::regular_length, static_cast<std::uint32_t>(idx));
+        }
+        return data;
+    }
+
+    // Every chain of the buffer holds 'chunk_size' bytes of 'data' as bufferevent reads them
+    void add_chunks(evbuffer *buffer, const proto::bytes &data, std::size_t chunk_size)
+    {
+        for(std::size_t pos = 0; pos < data.size(); pos += chunk_size) {
+            const std::size_t length{std::min(chunk_size, data.size() - pos)};
+            if(0 != evbuffer_add_reference(buffer, data.data() + pos, length, nullptr, nullptr)) {
+                throw std::runtime_error{"Can not add chunk to buffer"};
+            }
+        }
+    }
+
+    // Arg is the chain size, frames are split between chains unless it is a multiple of 12
+    void session_scan_input(benchmark::State &state)
+    {
+        const auto data{make_regular_frames(frames_count)};
+        const common::evbuffer_ptr input{evbuffer_new()};
+        add_chunks(input.get(), data, static_cast<std::size_t>(state.range(0)));
+        // as a session scans in the parse forwarding mode
+        balancer::input_scanner scanner{proto::stream_parser::default_max_value_length, true, true};
+        frame_counter counter;
+
+        frame_counters counters{state, frames_count};
+        for(auto _ : state) {
+            benchmark::DoNotOptimize(scanner.scan(input.get(), counter));
+            // the input is kept, so the same frames are scanned again
+            benchmark::DoNotOptimize(scanner.take_complete());
+        }
+    }
+    BENCHMARK(session_scan_input)->ArgName("chain")->Arg(4096)->Arg(12 * 1024)->Arg(64 * 1024);
+
+    // The whole zero copy path: chains are added, scanned and moved to the upstream buffer
+    void session_forward_input(benchmark::State &state)
+    {
+        const auto data{make_regular_frames(frames_count)};
+        const common::evbuffer_ptr input{evbuffer_new()};
+        const common::evbuffer_ptr output{evbuffer_new()};
+        const auto chunk_size{static_cast<std::size_t>(state.range(0))};
+        // as a session scans in the parse forwarding mode
+        balancer::input_scanner scanner{proto::stream_parser::default_max_value_length, true, true};
+        frame_counter counter;
+
+        frame_counters counters{state, frames_count};
+        for(auto _ : state) {
+            add_chunks(input.get(), data, chunk_size);
+            benchmark::DoNotOptimize(scanner.scan(input.get(), counter));
+            evbuffer_remove_buffer(input.get(), output.get(), scanner.take_complete());
+            evbuffer_drain(output.get(), data.size());
+        }
+    }
+    BENCHMARK(session_forward_input)->ArgName("chain")->Arg(4096)->Arg(12 * 1024)->Arg(64 * 1024);
+
+}
@@ -0,0 +1,172 @@
+#include "syscall-counter.h"
+
+#include <atomic>
+#include <cstdarg>
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+namespace {
+
+    std::atomic<std::uint64_t> syscalls{0};
+    thread_local bool counted_thread{false};
+
+    void count_call() noexcept
+    {
+        if(counted_thread) {
+            syscalls.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // The libc function hidden by the one of this file
+    template<typename fn_t>
+    fn_t next_fn(const char *name) noexcept
+    {
+        return reinterpret_cast<fn_t>(dlsym(RTLD_NEXT, name));
+    }
+
+}
+
+namespace benchmarks {
+
+    std::uint64_t syscalls_count() noexcept
+    {
+        return syscalls.load(std::memory_order_relaxed);
+    }
+
+    void count_thread_syscalls() noexcept
+    {
+        counted_thread = true;
+    }
+
+}
+
+// Calls of libevent and of the engines go through these ones
+
+ssize_t read(int fd, void *buf, size_t count)
+{
+    static const auto next{next_fn<decltype(&read)>("read")};
+    count_call();
+    return next(fd, buf, count);
+}
+
+ssize_t write(int fd, const void *buf, size_t count)
+{
+    static const auto next{next_fn<decltype(&write)>("write")};
+    count_call();
+    return next(fd, buf, count);
+}
+
+ssize_t readv(int fd, const iovec *iov, int iovcnt)
+{
+    static const auto next{next_fn<decltype(&readv)>("readv")};
+    count_call();
+    return next(fd, iov, iovcnt);
+}
+
+ssize_t writev(int fd, const iovec *iov, int iovcnt)
+{
+    static const auto next{next_fn<decltype(&writev)>("writev")};
+    count_call();
+    return next(fd, iov, iovcnt);
+}
+
+ssize_t recv(int fd, void *buf, size_t len, int flags)
+{
+    static const auto next{next_fn<decltype(&recv)>("recv")};
+    count_call();
+    return next(fd, buf, len, flags);
+}
+
+ssize_t send(int fd, const void *buf, size_t len, int flags)
+{
+    static const auto next{next_fn<decltype(&send)>("send")};
+    count_call();
+    return next(fd, buf, len, flags);
+}
+
+ssize_t recvmsg(int fd, msghdr *msg, int flags)
+{
+    static const auto next{next_fn<decltype(&recvmsg)>("recvmsg")};
+    count_call();
+    return next(fd, msg, flags);
+}
+
+ssize_t sendmsg(int fd, const msghdr *msg, int flags)
+{
+    static const auto next{next_fn<decltype(&sendmsg)>("sendmsg")};
+    count_call();
+    return next(fd, msg, flags);
+}
+
+int accept4(int fd, sockaddr *addr, socklen_t *addrlen, int flags)
+{
+    static const auto next{next_fn<decltype(&accept4)>("accept4")};
+    count_call();
+    return next(fd, addr, addrlen, flags);
+}
+
+int connect(int fd, const sockaddr *addr, socklen_t addrlen)
+{
+    static const auto next{next_fn<decltype(&connect)>("connect")};
+    count_call();
+    return next(fd, addr, addrlen);
+}
+
+int socket(int domain, int type, int protocol) noexcept
+{
+    static const auto next{next_fn<decltype(&socket)>("socket")};
+    count_call();
+    return next(domain, type, protocol);
+}
+
+int getsockopt(int fd, int level, int optname, void *optval, socklen_t *optlen) noexcept
+{
+    static const auto next{next_fn<decltype(&getsockopt)>("getsockopt")};
+    count_call();
+    return next(fd, level, optname, optval, optlen);
+}
+
+int setsockopt(int fd, int level, int optname, const void *optval, socklen_t optlen) noexcept
+{
+    static const auto next{next_fn<decltype(&setsockopt)>("setsockopt")};
+    count_call();
+    return next(fd, level, optname, optval, optlen);
+}
+
+int close(int fd)
+{
+    static const auto next{next_fn<decltype(&close)>("close")};
+    count_call();
+    return next(fd);
+}
+
+// evbuffer_read asks for the readable bytes count first
+int ioctl(int fd, unsigned long request, ...) noexcept
+{
+    using ioctl_fn = int (*)(int, unsigned long, void *);
+    static const auto next{next_fn<ioctl_fn>("ioctl")};
+    va_list args;
+    va_start(args, request);
+    void *arg{va_arg(args, void *)};
+    va_end(args);
+    count_call();
+    return next(fd, request, arg);
+}
+
+int epoll_wait(int epfd, epoll_event *events, int maxevents, int timeout)
+{
+    static const auto next{next_fn<decltype(&epoll_wait)>("epoll_wait")};
+    count_call();
+    return next(epfd, events, maxevents, timeout);
+}
+
+int epoll_ctl(int epfd, int op, int fd, epoll_event *event) noexcept
+{
+    static const auto next{next_fn<decltype(&epoll_ctl)>("epoll_ctl")};
+    count_call();
+    return next(epfd, op, fd, event);
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+namespace benchmarks {
+
+    // Count of socket and epoll calls made through libc by threads that called
+    // count_thread_syscalls(), io_uring_enter calls are counted by the io_uring engine
+    std::uint64_t syscalls_count() noexcept;
+
+    // Calls of the current thread are counted from now on
+    void count_thread_syscalls() noexcept;
+
+}
@@ -0,0 +1,21 @@
+#include "utils.h"
+
+namespace benchmarks {
+
+    frame_counters::frame_counters(benchmark::State &state, std::size_t frames)
+        : state_{state}
+        , frames_{frames}
+        , allocations_at_start_{allocations_count()}
+    { }
+
+    frame_counters::~frame_counters()
+    {
+        const auto frames{static_cast<double>(frames_ * static_cast<std::size_t>(state_.iterations()))};
+        state_.SetItemsProcessed(static_cast<std::int64_t>(frames));
+        // seconds per frame, printed as ns by the console reporter
+        state_.counters["time_per_frame"] = benchmark::Counter(frames, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+        state_.counters["allocs_per_frame"] = frames > 0
+                ? static_cast<double>(allocations_count() - allocations_at_start_) / frames : 0;
+    }
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "alloc-counter.h"
+
+#include <benchmark/benchmark.h>
+
+namespace benchmarks {
+
+    /*
+     * Per frame counters of a benchmark: time and heap allocations.
+     * Created before the benchmark loop, 'frames' are processed by one iteration,
+     * benchmarks of lookups count one lookup as a frame.
+     */
+    class frame_counters {
+    public:
+        frame_counters(benchmark::State &state, std::size_t frames);
+        ~frame_counters();
+
+    private:
+        benchmark::State &state_;
+        const std::size_t frames_;
+        const std::uint64_t allocations_at_start_;
+    };
+
+}
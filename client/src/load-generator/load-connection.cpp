@@ -0,0 +1,256 @@
+#include "load-connection.h"
+
+#include <algorithm>
+
+namespace tcp_client {
+
+    void load_stats::merge(const load_stats &other)
+    {
+        messages += other.messages;
+        bytes += other.bytes;
+        connected += other.connected;
+        failed += other.failed;
+        timed_out += other.timed_out;
+        connect_latency_us.merge(other.connect_latency_us);
+        send_lag_us.merge(other.send_lag_us);
+    }
+
+    load_connection::load_connection(event_base *base,
+                                     std::uint32_t client_id,
+                                     const sockaddr_in &server,
+                                     const load_options &options,
+                                     const common::common_timeouts &timeouts,
+                                     std::mt19937_64 &random,
+                                     load_stats &stats,
+                                     close_op_t close_op)
+        : client_id_{client_id}
+        , server_(server)
+        , options_{options}
+        , timeouts_{timeouts}
+        , rate_{options.rate / static_cast<double>(std::max<std::size_t>(options.connections, 1))}
+        , random_{random}
+        , intervals_{rate_ > 0 ? rate_ : 1}
+        , stats_{stats}
+        , close_op_{std::move(close_op)}
+        , buffer_{common::bufferevent_ptr(bufferevent_socket_new(base, -1, BEV_OPT_CLOSE_ON_FREE))}
+    { }
+
+    void load_connection::start()
+    {
+        check_null(buffer_, "Can not create new bufferevent");
+
+        const auto on_write = [](bufferevent */*bev*/, void *ctx)
+        {
+            auto *self{static_cast<load_connection *>(ctx)};
+            self->on_ready_write();
+        };
+
+        const auto on_event = [](bufferevent */*bev*/, short what, void *ctx)
+        {
+            auto *self{static_cast<load_connection *>(ctx)};
+            self->on_next_event(what);
+        };
+
+        const auto on_send_timer = [](evutil_socket_t /*fd*/, short /*what*/, void *ctx)
+        {
+            auto *self{static_cast<load_connection *>(ctx)};
+            self->on_send_timer();
+        };
+
+        auto *bev{buffer_.get()};
+        send_timer_ = common::event_ptr(evtimer_new(bufferevent_get_base(bev), on_send_timer, this));
+        check_null(send_timer_, "Can not create send timer");
+        bufferevent_setcb(bev, nullptr, on_write, on_event, this);
+        check_result_code(bufferevent_enable(bev, EV_WRITE), "Can not enable bufferevent for writing");
+        // the write timeout of a connecting bufferevent limits the connect
+        check_result_code(bufferevent_set_timeouts(bev, nullptr, timeouts_.connect()), "Can not set connect timeout");
+
+        // the init message waits in the output buffer until the connection is established
+        const auto init_frame{proto::codec::make_init_frame(client_id_)};
+        check_result_code(bufferevent_write(bev, init_frame.data(), init_frame.size()), "Can not write init message");
+
+        connect_started_at_ = clock_t::now();
+        check_result_code(bufferevent_socket_connect(bev, reinterpret_cast<const sockaddr *>(&server_), sizeof(server_)),
+                          "Can not start connection procedure to server");
+    }
+
+    void load_connection::stop()
+    {
+        send_timer_.reset();
+        buffer_.reset();
+    }
+
+    void load_connection::on_connected()
+    {
+        if(-1 == bufferevent_set_timeouts(buffer_.get(), nullptr, timeouts_.write())) {
+            ++stats_.failed;
+            close();
+            return;
+        }
+        const auto now{clock_t::now()};
+        ++stats_.connected;
+        stats_.connect_latency_us.record(static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(now - connect_started_at_).count()));
+
+        deadline_ = 0 == options_.duration.count() ? clock_t::time_point::max() : now + options_.duration;
+        if(is_rate_limited()) {
+            next_send_at_ = now;
+            send_due_messages();
+        } else {
+            // refilled when half of the pipeline is sent
+            bufferevent_setwatermark(buffer_.get(), EV_WRITE, options_.pipeline_bytes / 2, 0);
+            fill_pipeline();
+        }
+    }
+
+    void load_connection::on_ready_write()
+    {
+        if(finishing_) {
+            // the write callback is called when the output buffer is empty
+            close();
+        } else if(!is_rate_limited() && clock_t::time_point{} != deadline_) {
+            fill_pipeline();
+        }
+    }
+
+    void load_connection::on_send_timer()
+    {
+        send_due_messages();
+    }
+
+    void load_connection::on_next_event(short what)
+    {
+        if(what & BEV_EVENT_CONNECTED) {
+            on_connected();
+            return;
+        }
+        if(what & BEV_EVENT_TIMEOUT) {
+            ++stats_.timed_out;
+        }
+        if(what & BEV_EVENT_EOF || what & BEV_EVENT_ERROR || what & BEV_EVENT_TIMEOUT) {
+            ++stats_.failed;
+            close();
+        }
+    }
+
+    void load_connection::fill_pipeline()
+    {
+        const std::size_t queued{evbuffer_get_length(bufferevent_get_output(buffer_.get()))};
+        if(queued < options_.pipeline_bytes && !is_finished(clock_t::now())) {
+            std::size_t count{(options_.pipeline_bytes - queued + frame_length() - 1) / frame_length()};
+            if(0 != options_.max_messages) {
+                count = std::min<std::size_t>(count, options_.max_messages - sent_);
+            }
+            write_frames(count);
+        }
+        if(is_finished(clock_t::now())) {
+            finish();
+        }
+    }
+
+    void load_connection::send_due_messages()
+    {
+        const auto now{clock_t::now()};
+        std::size_t count{0};
+        // every message that is due is sent now, the lag shows how late it is
+        while(next_send_at_ <= now && !is_finished(next_send_at_)) {
+            stats_.send_lag_us.record(static_cast<std::uint64_t>(
+                        std::chrono::duration_cast<std::chrono::microseconds>(now - next_send_at_).count()));
+            next_send_at_ += next_interval();
+            ++count;
+            // sent_ is checked by is_finished
+            if(0 != options_.max_messages && sent_ + count >= options_.max_messages) {
+                break;
+            }
+        }
+        write_frames(count);
+
+        if(is_finished(next_send_at_)) {
+            finish();
+        } else {
+            schedule_next_send(now);
+        }
+    }
+
+    void load_connection::schedule_next_send(clock_t::time_point now)
+    {
+        const auto delay{std::chrono::duration_cast<std::chrono::microseconds>(next_send_at_ - now).count()};
+        const timeval timeout{static_cast<time_t>(delay / 1000000), static_cast<suseconds_t>(delay % 1000000)};
+        check_result_code(evtimer_add(send_timer_.get(), &timeout), "Can not start send timer");
+    }
+
+    void load_connection::write_frames(std::size_t count)
+    {
+        if(0 == count) {
+            return;
+        }
+        const std::size_t length{frame_length()};
+        frames_.resize(count * length);
+        if(options_.timestamps) {
+            const auto timestamp{static_cast<std::uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now().time_since_epoch()).count())};
+            for(std::size_t idx = 0; idx < count; ++idx) {
+                auto *frame{frames_.data() + idx * length};
+                proto::codec::store_typed_header(frame, proto::value_type::uint64, sizeof(std::uint64_t));
+                proto::codec::store_uint64(frame + proto::codec::typed_header_length, timestamp);
+            }
+        } else {
+            for(std::size_t idx = 0; idx < count; ++idx) {
+                proto::codec::store_regular(frames_.data() + idx * length, static_cast<std::uint32_t>(sent_ + idx));
+            }
+        }
+        check_result_code(bufferevent_write(buffer_.get(), frames_.data(), frames_.size()),
+                          "Can not write messages to bufferevent");
+        sent_ += static_cast<std::uint32_t>(count);
+        stats_.messages += count;
+        stats_.bytes += frames_.size();
+    }
+
+    void load_connection::finish()
+    {
+        finishing_ = true;
+        evtimer_del(send_timer_.get());
+        if(0 == evbuffer_get_length(bufferevent_get_output(buffer_.get()))) {
+            close();
+            return;
+        }
+        bufferevent_setwatermark(buffer_.get(), EV_WRITE, 0, 0);
+    }
+
+    void load_connection::close()
+    {
+        stop();
+        // destroys this object, must be the last call
+        close_op_();
+    }
+
+    std::size_t load_connection::frame_length() const noexcept
+    {
+        return options_.timestamps ? proto::codec::typed_header_length + sizeof(std::uint64_t)
+                                   : proto::codec::regular_length;
+    }
+
+    bool load_connection::is_rate_limited() const noexcept
+    {
+        return rate_ > 0;
+    }
+
+    bool load_connection::is_finished(clock_t::time_point now) const noexcept
+    {
+        return (0 != options_.max_messages && sent_ >= options_.max_messages) || now >= deadline_;
+    }
+
+    load_connection::clock_t::duration load_connection::next_interval()
+    {
+        const double seconds{arrival_type::poisson == options_.arrival ? intervals_(random_) : 1 / rate_};
+        return std::chrono::duration_cast<clock_t::duration>(std::chrono::duration<double>{seconds});
+    }
+
+    void load_connection::check_result_code(int result_code, const char *error_msg)
+    {
+        if(-1 == result_code) {
+            throw std::runtime_error{error_msg};
+        }
+    }
+
+}
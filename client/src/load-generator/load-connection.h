@@ -0,0 +1,123 @@
+#pragma once
+
+#include <common/src/types.h>
+#include <common/src/latency-histogram.h>
+#include <common/src/timeouts.h>
+#include <proto/src/codec.h>
+
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <functional>
+
+namespace tcp_client {
+
+    enum class arrival_type {
+        constant,   // messages are sent at equal intervals
+        poisson     // intervals are exponentially distributed
+    };
+
+    struct load_options {
+        std::size_t connections{100};
+        std::size_t threads{1};
+        // messages per second of all connections, 0 - as fast as possible
+        double rate{0};
+        arrival_type arrival{arrival_type::constant};
+        // per connection, sending is stopped by whichever limit comes first
+        std::uint32_t max_messages{1000};
+        std::chrono::seconds duration{0};   // 0 - no limit
+        // without rate, output buffer of a connection is refilled up to this size
+        std::size_t pipeline_bytes{64 * 1024};
+        // messages are typed uint64 with the steady clock time of sending in nanoseconds,
+        // so a backend on the same host can measure one-way latency
+        bool timestamps{false};
+        // only connect and write timeouts are used by the client
+        common::timeouts timeouts;
+    };
+
+    // Results of the connections of one thread
+    struct load_stats {
+        std::uint64_t messages{0};
+        std::uint64_t bytes{0};
+        std::uint64_t connected{0};
+        std::uint64_t failed{0};
+        std::uint64_t timed_out{0};
+        common::latency_histogram connect_latency_us;
+        // how late messages were written compared to their schedule
+        common::latency_histogram send_lag_us;
+
+        void merge(const load_stats &other);
+    };
+
+    /*
+     * One generated client: sends the init message and then regular messages
+     * with sequential payloads or timestamps. With a rate messages are scheduled in advance
+     * (open loop), a late timer sends all messages that are due, so a slow
+     * balancer does not lower the offered load. Without a rate the output
+     * buffer is kept filled, sending never waits for anything but the socket.
+     */
+    class load_connection {
+        using close_op_t = std::function<void()>;
+        using clock_t = std::chrono::steady_clock;
+
+    public:
+        load_connection(event_base *base,
+                        std::uint32_t client_id,
+                        const sockaddr_in &server,
+                        const load_options &options,
+                        const common::common_timeouts &timeouts,
+                        std::mt19937_64 &random,
+                        load_stats &stats,
+                        close_op_t close_op);
+
+    public:
+        void start();
+        void stop();
+
+    private:
+        void on_connected();
+        void on_ready_write();
+        void on_send_timer();
+        void on_next_event(short what);
+        void fill_pipeline();
+        void send_due_messages();
+        void schedule_next_send(clock_t::time_point now);
+        void write_frames(std::size_t count);
+        std::size_t frame_length() const noexcept;
+        void finish();
+        void close();
+        bool is_rate_limited() const noexcept;
+        bool is_finished(clock_t::time_point now) const noexcept;
+        clock_t::duration next_interval();
+        // the message is a literal, write_frames checks every refill
+        void check_result_code(int result_code, const char *error_msg);
+
+        template<typename t, typename deleter_t>
+        void check_null(const std::unique_ptr<t, deleter_t> &ptr, const std::string &error_msg)
+        {
+            if(!ptr) {
+                throw std::runtime_error{error_msg};
+            }
+        }
+
+    private:
+        const std::uint32_t client_id_;
+        const sockaddr_in server_;
+        const load_options &options_;
+        const common::common_timeouts &timeouts_;
+        const double rate_;
+        std::mt19937_64 &random_;
+        std::exponential_distribution<double> intervals_;
+        load_stats &stats_;
+        const close_op_t close_op_;
+        common::bufferevent_ptr buffer_;
+        common::event_ptr send_timer_;
+        clock_t::time_point connect_started_at_;
+        clock_t::time_point deadline_;
+        clock_t::time_point next_send_at_;
+        std::uint32_t sent_{0};
+        bool finishing_{false};
+        proto::bytes frames_;
+    };
+
+}
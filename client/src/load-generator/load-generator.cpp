@@ -0,0 +1,140 @@
+#include "load-generator.h"
+#include <common/src/utils.h>
+
+#include <thread>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <log4cplus/loggingmacros.h>
+
+namespace {
+
+    void print_latencies(const char *name, const common::latency_histogram &histogram)
+    {
+        std::cout << name << " (us): p50 " << histogram.value_at_percentile(50)
+                  << ", p99 " << histogram.value_at_percentile(99)
+                  << ", p99.9 " << histogram.value_at_percentile(99.9)
+                  << ", max " << histogram.max() << std::endl;
+    }
+
+}
+
+namespace tcp_client {
+
+    load_worker::load_worker(const sockaddr_in &server, const load_options &options,
+                             std::vector<std::uint32_t> client_ids)
+        : server_(server)
+        , options_{options}
+        , client_ids_{std::move(client_ids)}
+        , random_{std::random_device{}()}
+    { }
+
+    void load_worker::run()
+    {
+        // messages are scheduled with microseconds, not with the milliseconds of epoll
+        const common::event_config_ptr config{event_config_new()};
+        if(!config || -1 == event_config_set_flag(config.get(), EVENT_BASE_FLAG_PRECISE_TIMER)) {
+            throw std::runtime_error{"Can not create event_base config"};
+        }
+        eb_ = common::event_base_ptr(event_base_new_with_config(config.get()));
+        if(!eb_) {
+            throw std::runtime_error{"Can not create new event_base"};
+        }
+        const common::common_timeouts timeouts{eb_.get(), options_.timeouts};
+        for(const auto client_id : client_ids_) {
+            const auto connection_it{connections_.emplace(connections_.end())};
+            const auto close_op{[this, connection_it]() { connections_.erase(connection_it); }};
+            *connection_it = std::make_unique<load_connection>(eb_.get(), client_id, server_, options_,
+                                                               timeouts, random_, stats_, close_op);
+            try {
+                (*connection_it)->start();
+            } catch (...) {
+                ++stats_.failed;
+                connections_.erase(connection_it);
+            }
+        }
+        // the loop exits when the last connection is closed
+        if(-1 == event_base_dispatch(eb_.get())) {
+            throw std::runtime_error{"Can not run event loop"};
+        }
+        connections_.clear();
+        eb_.reset();
+    }
+
+    const load_stats &load_worker::stats() const noexcept
+    {
+        return stats_;
+    }
+
+    load_generator::load_generator(std::uint32_t first_client_id, const std::string &host,
+                                   std::uint16_t port, const load_options &options)
+        : logger_{common::make_logger("load_generator")}
+        , first_client_id_{first_client_id}
+        , r_server_{host, port}
+        , options_{options}
+    { }
+
+    void load_generator::start()
+    {
+        if(0 == options_.connections || 0 == options_.threads) {
+            throw std::invalid_argument{"Connections and threads count must be greater than zero"};
+        }
+        if(0 == options_.max_messages && 0 == options_.duration.count()) {
+            throw std::invalid_argument{"Max messages or duration must be set"};
+        }
+        const sockaddr_in server{r_server_.sockaddr()};
+
+        const std::size_t threads_count{std::min(options_.threads, options_.connections)};
+        std::vector<std::vector<std::uint32_t>> client_ids(threads_count);
+        for(std::size_t conn_idx = 0; conn_idx < options_.connections; ++conn_idx) {
+            client_ids[conn_idx % threads_count].push_back(first_client_id_ + static_cast<std::uint32_t>(conn_idx));
+        }
+        std::vector<std::unique_ptr<load_worker>> workers;
+        for(auto &ids : client_ids) {
+            workers.emplace_back(std::make_unique<load_worker>(server, options_, std::move(ids)));
+        }
+
+        LOG4CPLUS_INFO(logger_, "Start " << options_.connections << " connection(s) in " << threads_count
+                       << " thread(s) to server: " << r_server_);
+        const auto started_at{std::chrono::steady_clock::now()};
+        std::vector<std::thread> threads;
+        threads.reserve(workers.size());
+        for(auto &worker : workers) {
+            auto *load_worker{worker.get()};
+            threads.emplace_back([this, load_worker]() {
+                try {
+                    load_worker->run();
+                } catch (const std::exception &ex) {
+                    LOG4CPLUS_ERROR(logger_, "Load worker failed with error: " << ex.what());
+                }
+            });
+        }
+        for(auto &thread : threads) {
+            thread.join();
+        }
+        const std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - started_at};
+
+        load_stats total;
+        for(const auto &worker : workers) {
+            total.merge(worker->stats());
+        }
+        print_summary(total, elapsed);
+    }
+
+    void load_generator::print_summary(const load_stats &stats, std::chrono::duration<double> elapsed) const
+    {
+        const double seconds{std::max(elapsed.count(), 1e-9)};
+        std::cout << std::fixed << std::setprecision(1)
+                  << "Connections: " << stats.connected << " connected, " << stats.failed << " failed ("
+                  << stats.timed_out << " timed out)" << std::endl
+                  << "Sent " << stats.messages << " message(s), " << stats.bytes << " byte(s) in "
+                  << seconds << " s" << std::endl
+                  << "Throughput: " << static_cast<double>(stats.messages) / seconds << " msg/s, "
+                  << static_cast<double>(stats.bytes) / seconds / (1024 * 1024) << " MiB/s" << std::endl;
+        print_latencies("Connect latency", stats.connect_latency_us);
+        if(0 != stats.send_lag_us.count()) {
+            print_latencies("Send lag behind schedule", stats.send_lag_us);
+        }
+    }
+
+}
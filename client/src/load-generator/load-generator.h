@@ -0,0 +1,55 @@
+#pragma once
+
+#include "load-connection.h"
+#include <common/src/remote-server.h>
+
+#include <list>
+#include <memory>
+#include <vector>
+
+namespace tcp_client {
+
+    // Connections of one thread with their own event loop
+    class load_worker {
+    public:
+        load_worker(const sockaddr_in &server, const load_options &options, std::vector<std::uint32_t> client_ids);
+
+    public:
+        // returns when all connections are finished
+        void run();
+        const load_stats &stats() const noexcept;
+
+    private:
+        const sockaddr_in server_;
+        const load_options &options_;
+        const std::vector<std::uint32_t> client_ids_;
+        std::mt19937_64 random_;
+        load_stats stats_;
+        common::event_base_ptr eb_;
+        std::list<std::unique_ptr<load_connection>> connections_;
+    };
+
+    /*
+     * Load generator mode of the client: many connections with sequential
+     * client ids are spread between threads, a summary of throughput
+     * and latencies is printed when all of them are finished.
+     */
+    class load_generator {
+    public:
+        load_generator(std::uint32_t first_client_id, const std::string &host,
+                       std::uint16_t port, const load_options &options);
+
+    public:
+        void start();
+
+    private:
+        void print_summary(const load_stats &stats, std::chrono::duration<double> elapsed) const;
+
+    private:
+        log4cplus::Logger logger_;
+        const std::uint32_t first_client_id_;
+        const common::remote_server r_server_;
+        const load_options options_;
+    };
+
+}
@@ -1,5 +1,10 @@
 #include "./tcp-client/tcp-client.h"
+#include "./load-generator/load-generator.h"
 
+#include <common/src/async-appender.h>
+#include <common/src/log-sampler.h>
+
+#include <algorithm>
 #include <signal.h>
 #include <iostream>
 #include <boost/program_options.hpp>
@@ -16,7 +21,33 @@ boost::program_options::variables_map parse_command_line(int argc, const char* c
         ("client,c", po::value<std::uint32_t>()->required(), "Client ID")
         ("host,h", po::value<std::string>()->default_value("example.com"), "Host to connect")
         ("port,p", po::value<std::uint16_t>()->default_value(8888), "Port to connect")
-        ("max_messages,m", po::value<std::uint32_t>()->default_value(1000), "Max messages count to send");
+        ("max_messages,m", po::value<std::uint32_t>()->default_value(1000),
+         "Max messages count to send, per connection in load mode (0 - no limit if duration is set)")
+        ("interval_ms", po::value<std::uint32_t>()->default_value(1000), "Milliseconds between messages")
+        ("batch_size", po::value<std::size_t>()->default_value(0),
+         "Payloads coalesced into one batch message, 0 or 1 - send regular messages")
+        ("batch_timeout_ms", po::value<std::uint32_t>()->default_value(100),
+         "Max milliseconds the first payload of a batch waits for the batch to fill")
+        ("message_log_rate", po::value<std::uint32_t>()->default_value(100),
+         "Max per-message log records per second, 0 - no limit")
+        ("message_log_sample", po::value<std::uint32_t>()->default_value(1), "Log one of every N messages")
+        ("load", po::bool_switch(), "Load generator mode: many connections with client ids starting from client")
+        ("connections", po::value<std::size_t>()->default_value(100), "Connections count in load mode")
+        ("threads", po::value<std::size_t>()->default_value(1), "Threads count in load mode")
+        ("rate", po::value<double>()->default_value(0),
+         "Messages per second of all connections in load mode, 0 - as fast as possible")
+        ("arrival", po::value<std::string>()->default_value("constant"),
+         "Intervals between messages in load mode: constant or poisson")
+        ("duration_s", po::value<std::uint32_t>()->default_value(0), "Seconds to send messages in load mode, 0 - no limit")
+        ("pipeline_bytes", po::value<std::size_t>()->default_value(64 * 1024),
+         "Bytes kept in the output buffer of a connection when the rate is not set")
+        ("connect_timeout_ms", po::value<std::uint32_t>()->default_value(5000),
+         "Milliseconds to connect to the server, 0 - no limit")
+        ("write_timeout_ms", po::value<std::uint32_t>()->default_value(30000),
+         "Milliseconds the server may take no queued data before the connection is closed, 0 - no limit")
+        ("timestamps", po::bool_switch(),
+         "Put the send time into typed uint64 messages in load mode, Receiver measures latency by it, "
+         "needs rate");
         po::store(po::parse_command_line(argc, argv, desc), vm);
         po::notify(vm);
     } catch (const po::required_option &ex) {
@@ -29,21 +60,66 @@ boost::program_options::variables_map parse_command_line(int argc, const char* c
     return vm;
 }
 
+tcp_client::arrival_type read_arrival_type(const std::string &arrival)
+{
+    if("constant" == arrival) {
+        return tcp_client::arrival_type::constant;
+    }
+    if("poisson" == arrival) {
+        return tcp_client::arrival_type::poisson;
+    }
+    throw std::invalid_argument{"Unknown arrival type: " + arrival};
+}
 
 int main(int argc, char **argv)
 {
     signal(SIGPIPE, SIG_IGN);
+    const common::async_logging logging;
     try {
         const auto params{parse_command_line(argc, argv)};
         if(params.count("help")) {
             return 0;
         }
+
+        common::log_limits message_log_limits;
+        message_log_limits.max_per_second = params["message_log_rate"].as<std::uint32_t>();
+        message_log_limits.sample_every = std::max<std::uint32_t>(params["message_log_sample"].as<std::uint32_t>(), 1);
+        common::set_log_limits(common::log_category::message, message_log_limits);
         const std::uint32_t client_id{params["client"].as<std::uint32_t>()};
         const std::string host{params["host"].as<std::string>()};
         const std::uint16_t port{params["port"].as<std::uint16_t>()};
         const std::uint32_t max_msg{params["max_messages"].as<std::uint32_t>()};
+        common::timeouts timeouts;
+        timeouts.connect = std::chrono::milliseconds{params["connect_timeout_ms"].as<std::uint32_t>()};
+        timeouts.write = std::chrono::milliseconds{params["write_timeout_ms"].as<std::uint32_t>()};
+
+        if(params["load"].as<bool>()) {
+            tcp_client::load_options options;
+            options.connections = params["connections"].as<std::size_t>();
+            options.threads = params["threads"].as<std::size_t>();
+            options.rate = params["rate"].as<double>();
+            options.arrival = read_arrival_type(params["arrival"].as<std::string>());
+            options.max_messages = max_msg;
+            options.duration = std::chrono::seconds{params["duration_s"].as<std::uint32_t>()};
+            options.pipeline_bytes = params["pipeline_bytes"].as<std::size_t>();
+            options.timestamps = params["timestamps"].as<bool>();
+            // without a rate a whole pipeline refill is stamped at once and waits in the buffer
+            if(options.timestamps && options.rate <= 0) {
+                throw std::invalid_argument{"Timestamps need a rate"};
+            }
+            options.timeouts = timeouts;
+
+            tcp_client::load_generator generator{client_id, host, port, options};
+            generator.start();
+            return 0;
+        }
+
+        const std::chrono::milliseconds send_interval{params["interval_ms"].as<std::uint32_t>()};
+        tcp_client::batch_options batching;
+        batching.size = params["batch_size"].as<std::size_t>();
+        batching.timeout = std::chrono::milliseconds{params["batch_timeout_ms"].as<std::uint32_t>()};
 
-        tcp_client::tcp_client client{client_id, host, port, max_msg};
+        tcp_client::tcp_client client{client_id, host, port, max_msg, send_interval, batching, timeouts};
         client.start();
         client.stop();
     } catch (const std::exception &ex) {
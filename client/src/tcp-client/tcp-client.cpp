@@ -1,20 +1,26 @@
 #include "tcp-client.h"
 #include <common/src/utils.h>
+#include <common/src/log-sampler.h>
 #include <proto/src/init-message.h>
 #include <proto/src/regular-message.h>
+#include <proto/src/batch-message.h>
 
-#include <chrono>
-#include <thread>
 #include <log4cplus/loggingmacros.h>
 
 namespace tcp_client {
 
     tcp_client::tcp_client(std::uint32_t client_id, const std::string &host,
-                           std::uint16_t port, std::uint32_t max_msg_count)
+                           std::uint16_t port, std::uint32_t max_msg_count,
+                           std::chrono::milliseconds send_interval,
+                           const batch_options &batching,
+                           const common::timeouts &timeouts)
         : logger_{common::make_logger("tcp_client")}
         , client_id_{client_id}
         , r_server_{host, port}
         , max_msg_count_{max_msg_count}
+        , send_interval_{send_interval}
+        , batching_{batching}
+        , timeouts_{timeouts}
     { }
 
     void tcp_client::start()
@@ -24,6 +30,11 @@ namespace tcp_client {
 
         eb_ = common::event_base_ptr(event_base_new());
         check_null(eb_, "Can not create new event_base");
+        try {
+            common_timeouts_ = std::make_unique<common::common_timeouts>(eb_.get(), timeouts_);
+        } catch (const std::exception &ex) {
+            log_error_stop_and_throw(ex.what());
+        }
 
         buffer_ = common::bufferevent_ptr(bufferevent_socket_new(eb_.get(), -1, BEV_OPT_CLOSE_ON_FREE));
         check_null(buffer_, "Can not create new bufferevent");
@@ -40,9 +51,29 @@ namespace tcp_client {
             self->on_next_event(what);
         };
 
+        const auto on_send_timer = [](evutil_socket_t /*fd*/, short /*what*/, void *ctx)
+        {
+            auto *self{static_cast<tcp_client *>(ctx)};
+            self->on_send_timer();
+        };
+
+        const auto on_batch_timer = [](evutil_socket_t /*fd*/, short /*what*/, void *ctx)
+        {
+            auto *self{static_cast<tcp_client *>(ctx)};
+            self->flush_batch();
+        };
+
+        send_timer_ = common::event_ptr(event_new(eb_.get(), -1, EV_PERSIST, on_send_timer, this));
+        check_null(send_timer_, "Can not create send timer");
+        batch_timer_ = common::event_ptr(evtimer_new(eb_.get(), on_batch_timer, this));
+        check_null(batch_timer_, "Can not create batch timer");
+
         auto *bev{buffer_.get()};
         bufferevent_setcb(bev, nullptr, on_write, on_event, this);
         check_result_code(bufferevent_enable(bev, EV_WRITE), "Can not enable bufferevent for writing");
+        // the write timeout of a connecting bufferevent limits the connect
+        check_result_code(bufferevent_set_timeouts(bev, nullptr, common_timeouts_->connect()),
+                          "Can not set connect timeout");
 
         const auto init_message{proto::make_init_message(client_id_)};
         write_message(init_message.as_bytes());
@@ -63,6 +94,8 @@ namespace tcp_client {
 
     void tcp_client::stop()
     {
+        send_timer_.reset();
+        batch_timer_.reset();
         if(buffer_) {
             bufferevent_disable(buffer_.get(), EV_WRITE);
             buffer_.reset();
@@ -81,33 +114,91 @@ namespace tcp_client {
     }
 
     void tcp_client::on_ready_write()
+    {
+        // all messages are generated and the output buffer is empty
+        if(!send_timer_ && batch_.empty() && is_server_finished_read()) {
+            LOG4CPLUS_INFO(logger_, "Last message was sent");
+            // resources are freed by stop() after the loop exits
+            event_base_loopbreak(eb_.get());
+        }
+    }
+
+    void tcp_client::on_send_timer()
     {
         if(curr_msg_number_++ < max_msg_count_) {
             const auto regular_msg{proto::make_regular_message()};
-            LOG4CPLUS_INFO(logger_, "Send next message: " << curr_msg_number_
-                           << " with payload: " << regular_msg.payload());
-            write_message(regular_msg.as_bytes());
-            using namespace std::chrono_literals;
-            std::this_thread::sleep_for(1s);
-        } else {
-            if(is_server_finished_read()) {
-                LOG4CPLUS_INFO(logger_, "Last message was sent");
-                stop();
+            COMMON_LOG_SAMPLED_INFO(logger_, common::log_category::message, "Send next message: " << curr_msg_number_
+                                    << " with payload: " << regular_msg.payload());
+            if(is_batching()) {
+                add_to_batch(regular_msg.payload());
+            } else {
+                write_message(regular_msg.as_bytes());
             }
         }
+
+        if(curr_msg_number_ >= max_msg_count_) {
+            send_timer_.reset();
+            flush_batch();
+            on_ready_write();
+        }
+    }
+
+    void tcp_client::add_to_batch(std::uint32_t payload)
+    {
+        if(batch_.empty()) {
+            const timeval timeout{to_timeval(batching_.timeout)};
+            check_result_code(evtimer_add(batch_timer_.get(), &timeout), "Can not start batch timer");
+        }
+        batch_.push_back(payload);
+        if(batch_.size() >= batching_.size) {
+            flush_batch();
+        }
+    }
+
+    void tcp_client::flush_batch()
+    {
+        if(batch_.empty()) {
+            return;
+        }
+        evtimer_del(batch_timer_.get());
+        const auto batch_msg{proto::make_batch_message(std::move(batch_))};
+        batch_.clear();
+        write_message(batch_msg.as_bytes());
     }
 
     void tcp_client::on_next_event(short what)
     {
+        if(what & BEV_EVENT_TIMEOUT) {
+            LOG4CPLUS_ERROR(logger_, (connected_ ? "Write" : "Connection") << " timeout. Stop client");
+            event_base_loopbreak(eb_.get());
+            return;
+        }
         if(what & BEV_EVENT_ERROR) {
             LOG4CPLUS_ERROR(logger_, "Some error from bufferevent. Stop client");
-            stop();
+            event_base_loopbreak(eb_.get());
+            return;
         }
         if(what & BEV_EVENT_CONNECTED) {
             LOG4CPLUS_INFO(logger_, "Connected to server: " << r_server_);
+            connected_ = true;
+            check_result_code(bufferevent_set_timeouts(buffer_.get(), nullptr, common_timeouts_->write()),
+                              "Can not set write timeout");
+            const timeval interval{to_timeval(send_interval_)};
+            check_result_code(evtimer_add(send_timer_.get(), &interval), "Can not start send timer");
         }
     }
 
+    bool tcp_client::is_batching() const noexcept
+    {
+        return batching_.size > 1;
+    }
+
+    timeval tcp_client::to_timeval(std::chrono::milliseconds duration) noexcept
+    {
+        const auto ms{duration.count()};
+        return timeval{static_cast<time_t>(ms / 1000), static_cast<suseconds_t>(ms % 1000 * 1000)};
+    }
+
     bool tcp_client::is_server_finished_read() const noexcept
     {
         const auto evbuff{bufferevent_get_output(buffer_.get())};
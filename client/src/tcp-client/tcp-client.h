@@ -2,24 +2,43 @@
 
 #include <common/src/types.h>
 #include <common/src/remote-server.h>
+#include <common/src/timeouts.h>
 #include <proto/src/base-message.h>
 
+#include <chrono>
+#include <vector>
+
 struct bufferevent;
 
 namespace tcp_client {
 
+    // Payloads are coalesced into batch messages when size is greater than 1,
+    // a batch is sent when it is full or its first payload waits for timeout
+    struct batch_options {
+        std::size_t size{0};
+        std::chrono::milliseconds timeout{100};
+    };
+
     class tcp_client {
     public:
         tcp_client(std::uint32_t client_id, const std::string &host,
-                   std::uint16_t port, std::uint32_t max_msg_count);
+                   std::uint16_t port, std::uint32_t max_msg_count,
+                   std::chrono::milliseconds send_interval = std::chrono::seconds{1},
+                   const batch_options &batching = batch_options{},
+                   const common::timeouts &timeouts = common::timeouts{});
         void start();
         void stop();
 
     private:
         void write_message(const proto::bytes &msg);
         void on_ready_write();
+        void on_send_timer();
+        void add_to_batch(std::uint32_t payload);
+        void flush_batch();
         void on_next_event(short what);
         bool is_server_finished_read() const noexcept;
+        bool is_batching() const noexcept;
+        static timeval to_timeval(std::chrono::milliseconds duration) noexcept;
 
         template<typename t, typename deleter_t>
         void check_null(const std::unique_ptr<t, deleter_t> &ptr, const std::string &error_msg)
@@ -37,9 +56,17 @@ namespace tcp_client {
         const std::uint32_t client_id_;
         const common::remote_server r_server_;
         const std::uint32_t max_msg_count_;
+        const std::chrono::milliseconds send_interval_;
+        const batch_options batching_;
+        const common::timeouts timeouts_;
         common::event_base_ptr eb_;
+        std::unique_ptr<common::common_timeouts> common_timeouts_;
         common::bufferevent_ptr buffer_;
+        common::event_ptr send_timer_;
+        common::event_ptr batch_timer_;
+        std::vector<std::uint32_t> batch_;
         std::uint32_t curr_msg_number_{0};
+        bool connected_{false};
     };
 
 }
@@ -0,0 +1,111 @@
+#include "async-appender.h"
+
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+
+#include <log4cplus/spi/loggingevent.h>
+
+namespace {
+
+    // producers do not wake the writer, it polls the ring
+    const std::chrono::milliseconds write_interval{10};
+
+    std::atomic<common::async_appender *> installed_appender{nullptr};
+
+}
+
+namespace common {
+
+    async_appender::async_appender(std::size_t capacity)
+        : ring_{capacity}
+        , writer_{&async_appender::write_loop, this}
+    { }
+
+    async_appender::~async_appender()
+    {
+        destructorImpl();
+    }
+
+    void async_appender::close()
+    {
+        if(stopped_.exchange(true)) {
+            return;
+        }
+        {
+            const std::lock_guard<std::mutex> lock{wakeup_mutex_};
+            wakeup_.notify_one();
+        }
+        writer_.join();
+        closed = true;
+    }
+
+    void async_appender::append(const log4cplus::spi::InternalLoggingEvent &event)
+    {
+        const auto &text{formatEvent(event)};
+        if(!ring_.push(text.data(), text.size())) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void async_appender::push_record(const char *level, const std::string &msg) noexcept
+    {
+        // the ring truncates records to its slot size anyway
+        thread_local char record[log_ring::record_size];
+        const int length{std::snprintf(record, sizeof(record), "%s - %s\n", level, msg.c_str())};
+        const std::size_t size{std::min(static_cast<std::size_t>(std::max(length, 0)), sizeof(record) - 1)};
+        if(!ring_.push(record, size)) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    async_appender *async_appender::installed() noexcept
+    {
+        return installed_appender.load(std::memory_order_acquire);
+    }
+
+    void async_appender::write_loop()
+    {
+        std::string out;
+        while(!stopped_.load(std::memory_order_acquire)) {
+            drain(out);
+            std::unique_lock<std::mutex> lock{wakeup_mutex_};
+            wakeup_.wait_for(lock, write_interval, [this] { return stopped_.load(std::memory_order_acquire); });
+        }
+        drain(out);
+    }
+
+    void async_appender::drain(std::string &out)
+    {
+        out.clear();
+        while(ring_.pop(out)) {
+            if(out.size() >= 64 * 1024) {
+                std::fwrite(out.data(), 1, out.size(), stdout);
+                out.clear();
+            }
+        }
+        const std::uint64_t dropped{dropped_.exchange(0, std::memory_order_relaxed)};
+        if(0 != dropped) {
+            out += "WARN - " + std::to_string(dropped) + " log message(s) dropped\n";
+        }
+        if(!out.empty()) {
+            std::fwrite(out.data(), 1, out.size(), stdout);
+        }
+        std::fflush(stdout);
+    }
+
+    async_logging::async_logging()
+        : appender_{new async_appender{}}
+    {
+        log4cplus::Logger::getRoot().addAppender(appender_);
+        installed_appender.store(static_cast<async_appender *>(appender_.get()), std::memory_order_release);
+    }
+
+    async_logging::~async_logging()
+    {
+        installed_appender.store(nullptr, std::memory_order_release);
+        log4cplus::Logger::getRoot().removeAppender(appender_);
+        appender_->close();
+    }
+
+}
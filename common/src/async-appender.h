@@ -0,0 +1,66 @@
+#pragma once
+
+#include "log-ring.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <log4cplus/appender.h>
+#include <log4cplus/logger.h>
+
+namespace common {
+
+    /*
+     * Console appender that never blocks the logging thread on output:
+     * formatted events are pushed into a lock-free ring and written to
+     * stdout by a background thread. When the ring is full events are
+     * dropped and the number of dropped events is reported later.
+     * Events logged through log4cplus are still formatted under its appender
+     * lock, per-message records skip both by push_record.
+     */
+    class async_appender : public log4cplus::Appender {
+    public:
+        explicit async_appender(std::size_t capacity = 8192);
+        ~async_appender() override;
+
+    public:
+        void close() override;
+        // Pushes a record formatted like by the default layout straight into the ring,
+        // safe to call from any thread without locking
+        void push_record(const char *level, const std::string &msg) noexcept;
+
+        // The appender of the current async_logging scope, nullptr outside of it
+        static async_appender *installed() noexcept;
+
+    protected:
+        void append(const log4cplus::spi::InternalLoggingEvent &event) override;
+
+    private:
+        void write_loop();
+        void drain(std::string &out);
+
+    private:
+        log_ring ring_;
+        std::atomic<std::uint64_t> dropped_{0};
+        std::atomic<bool> stopped_{false};
+        std::mutex wakeup_mutex_;
+        std::condition_variable wakeup_;
+        std::thread writer_;
+    };
+
+    // Installs async_appender as the only root appender for the scope lifetime,
+    // the rest of the log is flushed on destruction
+    class async_logging {
+    public:
+        async_logging();
+        ~async_logging();
+        async_logging(const async_logging &) = delete;
+        async_logging &operator=(const async_logging &) = delete;
+
+    private:
+        log4cplus::SharedAppenderPtr appender_;
+    };
+
+}
@@ -0,0 +1,141 @@
+#include "async-resolver.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+
+namespace common {
+
+    async_resolver::async_resolver(event_base *base, dns_cache &cache)
+        : cache_{cache}
+        , dns_base_{evdns_base_new(base, EVDNS_BASE_INITIALIZE_NAMESERVERS|EVDNS_BASE_DISABLE_WHEN_INACTIVE)}
+    {
+        if(!dns_base_) {
+            throw std::runtime_error{"Can not create new evdns_base"};
+        }
+    }
+
+    async_resolver::~async_resolver()
+    {
+        for(auto &request : requests_) {
+            request.second->waiters.clear();
+        }
+        dns_base_.reset();
+    }
+
+    bool async_resolver::resolve(const remote_server &server, sockaddr_in &sock,
+                                 callback_t callback, request_id_t &request_id)
+    {
+        if(server.is_ipv4()) {
+            sock = server.sockaddr();
+            return true;
+        }
+        if(find_in_cache(server, sock)) {
+            return true;
+        }
+
+        const std::string &host{server.host()};
+        if(0 == requests_.count(host)) {
+            // request is completed right away when the host is found in the hosts file or can not be resolved
+            start_request(host);
+            if(find_in_cache(server, sock)) {
+                return true;
+            }
+            if(0 == requests_.count(host)) {
+                throw std::invalid_argument{"Can not get host by name: " + host};
+            }
+        }
+
+        request_id = ++last_request_id_;
+        requests_[host]->waiters.emplace(request_id, waiter{server.port(), std::move(callback)});
+        request_hosts_.emplace(request_id, host);
+        return false;
+    }
+
+    void async_resolver::cancel(request_id_t request_id) noexcept
+    {
+        const auto host_it{request_hosts_.find(request_id)};
+        if(request_hosts_.end() == host_it) {
+            return;
+        }
+        const auto request_it{requests_.find(host_it->second)};
+        if(requests_.end() != request_it) {
+            request_it->second->waiters.erase(request_id);
+        }
+        request_hosts_.erase(host_it);
+    }
+
+    std::string async_resolver::error_message(int error)
+    {
+        return evutil_gai_strerror(error);
+    }
+
+    bool async_resolver::find_in_cache(const remote_server &server, sockaddr_in &sock) const
+    {
+        in_addr addr;
+        if(!cache_.find(server.host(), addr)) {
+            return false;
+        }
+        sock = make_sockaddr(ntohl(addr.s_addr), server.port());
+        return true;
+    }
+
+    void async_resolver::start_request(const std::string &host)
+    {
+        auto &request{requests_[host]};
+        request.reset(new pending_request{this, host, {}});
+
+        evutil_addrinfo hints;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+
+        if(nullptr == evdns_getaddrinfo(dns_base_.get(), host.c_str(), nullptr, &hints,
+                                        async_resolver::on_resolved_cb, request.get())) {
+            // request is already completed and callback was called
+            requests_.erase(host);
+        }
+    }
+
+    void async_resolver::on_resolved(pending_request &request, int result, evutil_addrinfo *addr_info)
+    {
+        const std::string host{std::move(request.host)};
+        const auto waiters{std::move(request.waiters)};
+        requests_.erase(host);
+
+        const sockaddr_in *resolved{nullptr};
+        for(auto *info = addr_info; 0 == result && nullptr != info; info = info->ai_next) {
+            if(AF_INET == info->ai_family) {
+                resolved = reinterpret_cast<const sockaddr_in *>(info->ai_addr);
+                break;
+            }
+        }
+        if(0 == result && nullptr == resolved) {
+            result = EVUTIL_EAI_NODATA;
+        }
+        if(nullptr != resolved) {
+            cache_.store(host, resolved->sin_addr);
+        }
+
+        for(const auto &waiter_it : waiters) {
+            request_hosts_.erase(waiter_it.first);
+            sockaddr_in sock;
+            std::memset(&sock, 0, sizeof(sock));
+            if(nullptr != resolved) {
+                sock = make_sockaddr(ntohl(resolved->sin_addr.s_addr), waiter_it.second.port);
+            }
+            waiter_it.second.callback(result, sock);
+        }
+
+        if(nullptr != addr_info) {
+            evutil_freeaddrinfo(addr_info);
+        }
+    }
+
+    void async_resolver::on_resolved_cb(int result, evutil_addrinfo *addr_info, void *arg)
+    {
+        auto *request{static_cast<pending_request *>(arg)};
+        request->resolver->on_resolved(*request, result, addr_info);
+    }
+
+}
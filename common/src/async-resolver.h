@@ -0,0 +1,63 @@
+#pragma once
+
+#include "types.h"
+#include "dns-cache.h"
+#include "remote-server.h"
+
+#include <map>
+#include <memory>
+#include <functional>
+
+namespace common {
+
+    /*
+     * Non-blocking host name resolution on top of evdns, one resolver per event_base.
+     * Results are stored in the shared dns_cache, concurrent requests for
+     * the same host are merged into one DNS query.
+     */
+    class async_resolver {
+    public:
+        using request_id_t = std::uint64_t;
+        using callback_t = std::function<void(int error, const sockaddr_in &sock)>;
+
+    public:
+        async_resolver(event_base *base, dns_cache &cache);
+        ~async_resolver();
+
+    public:
+        // Returns true and fills 'sock' if address is known right away,
+        // otherwise 'callback' is called from the event loop later
+        // and 'request_id' can be used to cancel it
+        bool resolve(const remote_server &server, sockaddr_in &sock,
+                     callback_t callback, request_id_t &request_id);
+        void cancel(request_id_t request_id) noexcept;
+        static std::string error_message(int error);
+
+    private:
+        struct waiter {
+            std::uint16_t port;
+            callback_t callback;
+        };
+
+        struct pending_request {
+            async_resolver *resolver;
+            std::string host;
+            std::map<request_id_t, waiter> waiters;
+        };
+
+    private:
+        bool find_in_cache(const remote_server &server, sockaddr_in &sock) const;
+        void start_request(const std::string &host);
+        void on_resolved(pending_request &request, int result, evutil_addrinfo *addr_info);
+        static void on_resolved_cb(int result, evutil_addrinfo *addr_info, void *arg);
+
+    private:
+        dns_cache &cache_;
+        request_id_t last_request_id_{0};
+        std::map<std::string, std::unique_ptr<pending_request>> requests_;
+        std::map<request_id_t, std::string> request_hosts_;
+        // must be destroyed first, freeing it fails pending requests
+        evdns_base_ptr dns_base_;
+    };
+
+}
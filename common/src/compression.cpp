@@ -0,0 +1,296 @@
+#include "compression.h"
+
+#include <stdexcept>
+
+#include <event2/buffer.h>
+#include <lz4frame.h>
+#include <zstd.h>
+
+namespace {
+
+    using namespace common;
+
+    // input is compressed by parts, so output space reserved at once is bounded
+    const std::size_t max_part_size{64 * 1024};
+    // zstd level tuned for speed, the stream is compressed on the forwarding path
+    const int zstd_level{1};
+
+    // Reserves 'size' bytes at the end of 'out', data is added by commit
+    class output_space {
+    public:
+        output_space(evbuffer *out, std::size_t size)
+            : out_{out}
+        {
+            if(1 != evbuffer_reserve_space(out_, static_cast<ev_ssize_t>(size), &vec_, 1) || vec_.iov_len < size) {
+                throw std::runtime_error{"Can not reserve space in output buffer"};
+            }
+        }
+
+        void *data() const noexcept
+        {
+            return vec_.iov_base;
+        }
+
+        std::size_t size() const noexcept
+        {
+            return vec_.iov_len;
+        }
+
+        void commit(std::size_t size)
+        {
+            vec_.iov_len = size;
+            if(-1 == evbuffer_commit_space(out_, &vec_, 1)) {
+                throw std::runtime_error{"Can not commit space in output buffer"};
+            }
+        }
+
+    private:
+        evbuffer *out_;
+        evbuffer_iovec vec_;
+    };
+
+    void check_lz4_result(std::size_t result)
+    {
+        if(LZ4F_isError(result)) {
+            throw std::runtime_error{std::string{"LZ4 error: "} + LZ4F_getErrorName(result)};
+        }
+    }
+
+    void check_zstd_result(std::size_t result)
+    {
+        if(ZSTD_isError(result)) {
+            throw std::runtime_error{std::string{"zstd error: "} + ZSTD_getErrorName(result)};
+        }
+    }
+
+    class lz4_compressor : public compressor {
+    public:
+        lz4_compressor()
+        {
+            check_lz4_result(LZ4F_createCompressionContext(&ctx_, LZ4F_VERSION));
+            prefs_.frameInfo.blockSizeID = LZ4F_max64KB;
+            prefs_.frameInfo.blockMode = LZ4F_blockLinked;
+            // every update is flushed
+            prefs_.autoFlush = 1;
+        }
+
+        ~lz4_compressor() override
+        {
+            LZ4F_freeCompressionContext(ctx_);
+        }
+
+        void compress(const void *data, std::size_t size, evbuffer *out) override
+        {
+            begin(out);
+            const auto *part{static_cast<const char *>(data)};
+            while(size > 0) {
+                const std::size_t part_size{std::min(size, max_part_size)};
+                output_space space{out, LZ4F_compressBound(part_size, &prefs_)};
+                const std::size_t written{LZ4F_compressUpdate(ctx_, space.data(), space.size(), part, part_size, nullptr)};
+                check_lz4_result(written);
+                space.commit(written);
+                part += part_size;
+                size -= part_size;
+            }
+        }
+
+        void finish(evbuffer *out) override
+        {
+            begin(out);
+            output_space space{out, LZ4F_compressBound(0, &prefs_)};
+            const std::size_t written{LZ4F_compressEnd(ctx_, space.data(), space.size(), nullptr)};
+            check_lz4_result(written);
+            space.commit(written);
+        }
+
+    private:
+        void begin(evbuffer *out)
+        {
+            if(started_) {
+                return;
+            }
+            output_space space{out, LZ4F_HEADER_SIZE_MAX};
+            const std::size_t written{LZ4F_compressBegin(ctx_, space.data(), space.size(), &prefs_)};
+            check_lz4_result(written);
+            space.commit(written);
+            started_ = true;
+        }
+
+    private:
+        LZ4F_cctx *ctx_{nullptr};
+        LZ4F_preferences_t prefs_{};
+        bool started_{false};
+    };
+
+    class lz4_decompressor : public decompressor {
+    public:
+        lz4_decompressor()
+        {
+            check_lz4_result(LZ4F_createDecompressionContext(&ctx_, LZ4F_VERSION));
+        }
+
+        ~lz4_decompressor() override
+        {
+            LZ4F_freeDecompressionContext(ctx_);
+        }
+
+        void decompress(const void *data, std::size_t size, evbuffer *out) override
+        {
+            const auto *in{static_cast<const char *>(data)};
+            // decoded bytes can stay in the context after all input is consumed,
+            // the call is repeated while it fills the whole output space
+            bool output_full{false};
+            while(size > 0 || output_full) {
+                output_space space{out, max_part_size};
+                const std::size_t space_size{space.size()};
+                std::size_t written{space_size};
+                std::size_t consumed{size};
+                check_lz4_result(LZ4F_decompress(ctx_, space.data(), &written, in, &consumed, nullptr));
+                space.commit(written);
+                in += consumed;
+                size -= consumed;
+                output_full = written == space_size;
+            }
+        }
+
+    private:
+        LZ4F_dctx *ctx_{nullptr};
+    };
+
+    class zstd_compressor : public compressor {
+    public:
+        zstd_compressor()
+            : ctx_{ZSTD_createCCtx()}
+        {
+            if(nullptr == ctx_) {
+                throw std::runtime_error{"Can not create zstd context"};
+            }
+            check_zstd_result(ZSTD_CCtx_setParameter(ctx_, ZSTD_c_compressionLevel, zstd_level));
+        }
+
+        ~zstd_compressor() override
+        {
+            ZSTD_freeCCtx(ctx_);
+        }
+
+        void compress(const void *data, std::size_t size, evbuffer *out) override
+        {
+            ZSTD_inBuffer in{data, size, 0};
+            stream(in, ZSTD_e_flush, out);
+        }
+
+        void finish(evbuffer *out) override
+        {
+            ZSTD_inBuffer in{nullptr, 0, 0};
+            stream(in, ZSTD_e_end, out);
+        }
+
+    private:
+        void stream(ZSTD_inBuffer &in, ZSTD_EndDirective directive, evbuffer *out)
+        {
+            std::size_t remaining{0};
+            do {
+                output_space space{out, ZSTD_CStreamOutSize()};
+                ZSTD_outBuffer out_buffer{space.data(), space.size(), 0};
+                remaining = ZSTD_compressStream2(ctx_, &out_buffer, &in, directive);
+                check_zstd_result(remaining);
+                space.commit(out_buffer.pos);
+            } while(0 != remaining || in.pos < in.size);
+        }
+
+    private:
+        ZSTD_CCtx *ctx_;
+    };
+
+    class zstd_decompressor : public decompressor {
+    public:
+        zstd_decompressor()
+            : ctx_{ZSTD_createDCtx()}
+        {
+            if(nullptr == ctx_) {
+                throw std::runtime_error{"Can not create zstd context"};
+            }
+        }
+
+        ~zstd_decompressor() override
+        {
+            ZSTD_freeDCtx(ctx_);
+        }
+
+        void decompress(const void *data, std::size_t size, evbuffer *out) override
+        {
+            ZSTD_inBuffer in{data, size, 0};
+            // a full output buffer can leave decoded bytes in the context
+            // after all input is consumed, zstd flushes them by the next call
+            bool output_full{false};
+            while(in.pos < in.size || output_full) {
+                output_space space{out, ZSTD_DStreamOutSize()};
+                ZSTD_outBuffer out_buffer{space.data(), space.size(), 0};
+                check_zstd_result(ZSTD_decompressStream(ctx_, &out_buffer, &in));
+                space.commit(out_buffer.pos);
+                output_full = out_buffer.pos == out_buffer.size;
+            }
+        }
+
+    private:
+        ZSTD_DCtx *ctx_;
+    };
+
+}
+
+namespace common {
+
+    compression_type read_compression_type(const std::string &name)
+    {
+        if("none" == name) {
+            return compression_type::none;
+        }
+        if("lz4" == name) {
+            return compression_type::lz4;
+        }
+        if("zstd" == name) {
+            return compression_type::zstd;
+        }
+        throw std::invalid_argument{"Unknown compression: " + name};
+    }
+
+    const char *compression_name(compression_type type) noexcept
+    {
+        switch(type) {
+        case compression_type::lz4:
+            return "lz4";
+        case compression_type::zstd:
+            return "zstd";
+        case compression_type::none:
+            break;
+        }
+        return "none";
+    }
+
+    std::unique_ptr<compressor> make_compressor(compression_type type)
+    {
+        switch(type) {
+        case compression_type::lz4:
+            return std::make_unique<lz4_compressor>();
+        case compression_type::zstd:
+            return std::make_unique<zstd_compressor>();
+        case compression_type::none:
+            break;
+        }
+        return nullptr;
+    }
+
+    std::unique_ptr<decompressor> make_decompressor(compression_type type)
+    {
+        switch(type) {
+        case compression_type::lz4:
+            return std::make_unique<lz4_decompressor>();
+        case compression_type::zstd:
+            return std::make_unique<zstd_decompressor>();
+        case compression_type::none:
+            break;
+        }
+        return nullptr;
+    }
+
+}
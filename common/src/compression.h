@@ -0,0 +1,45 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+struct evbuffer;
+
+namespace common {
+
+    enum class compression_type {
+        none,
+        lz4,    // LZ4 frame format
+        zstd
+    };
+
+    // throws std::invalid_argument for unknown names
+    compression_type read_compression_type(const std::string &name);
+    const char *compression_name(compression_type type) noexcept;
+
+    /*
+     * Streaming compressor of one connection. Output of every compress call
+     * is flushed, so the receiver can decode everything written so far.
+     * Errors are reported with std::runtime_error.
+     */
+    class compressor {
+    public:
+        virtual ~compressor() = default;
+        // appends compressed data to 'out'
+        virtual void compress(const void *data, std::size_t size, evbuffer *out) = 0;
+        // appends the end of the stream to 'out'
+        virtual void finish(evbuffer *out) = 0;
+    };
+
+    class decompressor {
+    public:
+        virtual ~decompressor() = default;
+        // appends decompressed data to 'out'
+        virtual void decompress(const void *data, std::size_t size, evbuffer *out) = 0;
+    };
+
+    // Both return nullptr for compression_type::none
+    std::unique_ptr<compressor> make_compressor(compression_type type);
+    std::unique_ptr<decompressor> make_decompressor(compression_type type);
+
+}
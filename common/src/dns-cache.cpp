@@ -0,0 +1,26 @@
+#include "dns-cache.h"
+
+namespace common {
+
+    dns_cache::dns_cache(std::chrono::seconds ttl)
+        : ttl_{ttl}
+    { }
+
+    bool dns_cache::find(const std::string &host, in_addr &addr) const
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        const auto entry_it{entries_.find(host)};
+        if(entries_.cend() == entry_it || entry_it->second.expires_at < clock_t::now()) {
+            return false;
+        }
+        addr = entry_it->second.addr;
+        return true;
+    }
+
+    void dns_cache::store(const std::string &host, const in_addr &addr)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        entries_[host] = entry{addr, clock_t::now() + ttl_};
+    }
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <arpa/inet.h>
+
+namespace common {
+
+    /*
+     * Resolved IPv4 addresses keyed by host name.
+     * Can be shared between threads, every entry lives for ttl.
+     */
+    class dns_cache {
+        using clock_t = std::chrono::steady_clock;
+
+    public:
+        explicit dns_cache(std::chrono::seconds ttl);
+        bool find(const std::string &host, in_addr &addr) const;
+        void store(const std::string &host, const in_addr &addr);
+
+    private:
+        struct entry {
+            in_addr addr;
+            clock_t::time_point expires_at;
+        };
+
+    private:
+        const std::chrono::seconds ttl_;
+        mutable std::mutex mutex_;
+        std::unordered_map<std::string, entry> entries_;
+    };
+
+}
@@ -0,0 +1,116 @@
+#include "latency-histogram.h"
+
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+namespace common {
+
+    constexpr unsigned latency_histogram::default_significant_bits;
+
+    latency_histogram::latency_histogram(unsigned significant_bits)
+        : significant_bits_{significant_bits}
+        , sub_buckets_count_{std::uint64_t{1} << significant_bits}
+    {
+        if(0 == significant_bits || significant_bits > 16) {
+            throw std::invalid_argument{"Histogram precision must be from 1 to 16 bits"};
+        }
+        // values below sub_buckets_count_ are exact, then every power of two
+        // up to 2^64 takes half of sub-buckets
+        counts_.resize(static_cast<std::size_t>(sub_buckets_count_ + (64 - significant_bits) * (sub_buckets_count_ / 2)));
+    }
+
+    void latency_histogram::record(std::uint64_t value) noexcept
+    {
+        ++counts_[index_of(value)];
+        ++count_;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+        sum_ += static_cast<double>(value);
+    }
+
+    void latency_histogram::merge(const latency_histogram &other)
+    {
+        if(other.significant_bits_ != significant_bits_) {
+            throw std::invalid_argument{"Can not merge histograms with different precision"};
+        }
+        for(std::size_t idx = 0; idx < counts_.size(); ++idx) {
+            counts_[idx] += other.counts_[idx];
+        }
+        count_ += other.count_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+        sum_ += other.sum_;
+    }
+
+    void latency_histogram::reset() noexcept
+    {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        count_ = 0;
+        min_ = UINT64_MAX;
+        max_ = 0;
+        sum_ = 0;
+    }
+
+    std::uint64_t latency_histogram::count() const noexcept
+    {
+        return count_;
+    }
+
+    std::uint64_t latency_histogram::min() const noexcept
+    {
+        return 0 == count_ ? 0 : min_;
+    }
+
+    std::uint64_t latency_histogram::max() const noexcept
+    {
+        return max_;
+    }
+
+    double latency_histogram::mean() const noexcept
+    {
+        return 0 == count_ ? 0 : sum_ / static_cast<double>(count_);
+    }
+
+    std::uint64_t latency_histogram::value_at_percentile(double percentile) const noexcept
+    {
+        if(0 == count_) {
+            return 0;
+        }
+        const double rank{std::ceil(std::min(std::max(percentile, 0.0), 100.0) / 100 * static_cast<double>(count_))};
+        const std::uint64_t target{std::max<std::uint64_t>(static_cast<std::uint64_t>(rank), 1)};
+        std::uint64_t cumulative{0};
+        for(std::size_t idx = 0; idx < counts_.size(); ++idx) {
+            cumulative += counts_[idx];
+            if(cumulative >= target) {
+                return std::min(highest_value_at(idx), max_);
+            }
+        }
+        return max_;
+    }
+
+    std::size_t latency_histogram::index_of(std::uint64_t value) const noexcept
+    {
+        if(value < sub_buckets_count_) {
+            return static_cast<std::size_t>(value);
+        }
+        // value >> shift keeps significant_bits_ bits, the highest of them is set
+        const unsigned msb{static_cast<unsigned>(63 - __builtin_clzll(value))};
+        const unsigned shift{msb - significant_bits_ + 1};
+        const std::uint64_t half{sub_buckets_count_ / 2};
+        return static_cast<std::size_t>(sub_buckets_count_ + (shift - 1) * half + ((value >> shift) - half));
+    }
+
+    std::uint64_t latency_histogram::highest_value_at(std::size_t idx) const noexcept
+    {
+        if(idx < sub_buckets_count_) {
+            return idx;
+        }
+        const std::uint64_t half{sub_buckets_count_ / 2};
+        const std::uint64_t relative{idx - sub_buckets_count_};
+        const unsigned shift{static_cast<unsigned>(relative / half + 1)};
+        const std::uint64_t sub_bucket{relative % half + half};
+        return ((sub_bucket + 1) << shift) - 1;
+    }
+
+}
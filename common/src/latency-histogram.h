@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace common {
+
+    /*
+     * HDR style histogram of non-negative integer values (usually latencies
+     * in microseconds or nanoseconds). Values are grouped by powers of two
+     * and every group is split into linear sub-buckets, so a value is kept
+     * with relative error below 2^-significant_bits whatever its magnitude.
+     * Recording is a single increment, histograms of threads are merged.
+     */
+    class latency_histogram {
+    public:
+        static constexpr unsigned default_significant_bits{7};
+
+    public:
+        explicit latency_histogram(unsigned significant_bits = default_significant_bits);
+
+    public:
+        void record(std::uint64_t value) noexcept;
+        // histograms must have the same precision
+        void merge(const latency_histogram &other);
+        void reset() noexcept;
+
+        std::uint64_t count() const noexcept;
+        std::uint64_t min() const noexcept;
+        std::uint64_t max() const noexcept;
+        double mean() const noexcept;
+        // the highest value equivalent to the one at the percentile, 0 for an empty histogram
+        std::uint64_t value_at_percentile(double percentile) const noexcept;
+
+    private:
+        std::size_t index_of(std::uint64_t value) const noexcept;
+        std::uint64_t highest_value_at(std::size_t idx) const noexcept;
+
+    private:
+        const unsigned significant_bits_;
+        const std::uint64_t sub_buckets_count_;
+        std::vector<std::uint64_t> counts_;
+        std::uint64_t count_{0};
+        std::uint64_t min_{UINT64_MAX};
+        std::uint64_t max_{0};
+        // sum is kept in a double to never overflow
+        double sum_{0};
+    };
+
+}
@@ -0,0 +1,72 @@
+#include "log-ring.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+    const char truncated_tail[]{"...\n"};
+
+}
+
+namespace common {
+
+    constexpr std::size_t log_ring::record_size;
+
+    log_ring::log_ring(std::size_t capacity)
+        : mask_{capacity - 1}
+        , slots_{new slot[capacity]}
+    {
+        if(0 == capacity || 0 != (capacity & mask_)) {
+            throw std::invalid_argument{"Log ring capacity must be a power of two"};
+        }
+        for(std::size_t idx = 0; idx < capacity; ++idx) {
+            slots_[idx].sequence.store(idx, std::memory_order_relaxed);
+        }
+    }
+
+    bool log_ring::push(const char *data, std::size_t size) noexcept
+    {
+        std::size_t pos{push_pos_.load(std::memory_order_relaxed)};
+        slot *curr_slot{nullptr};
+        while(true) {
+            curr_slot = &slots_[pos & mask_];
+            const std::size_t sequence{curr_slot->sequence.load(std::memory_order_acquire)};
+            const auto diff{static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos)};
+            if(0 == diff) {
+                if(push_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(diff < 0) {
+                return false;
+            } else {
+                pos = push_pos_.load(std::memory_order_relaxed);
+            }
+        }
+
+        if(size <= record_size) {
+            std::copy_n(data, size, curr_slot->data.begin());
+            curr_slot->size = size;
+        } else {
+            const std::size_t tail_size{sizeof(truncated_tail) - 1};
+            std::copy_n(data, record_size - tail_size, curr_slot->data.begin());
+            std::copy_n(truncated_tail, tail_size, curr_slot->data.end() - tail_size);
+            curr_slot->size = record_size;
+        }
+        curr_slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool log_ring::pop(std::string &out)
+    {
+        slot &curr_slot{slots_[pop_pos_ & mask_]};
+        if(curr_slot.sequence.load(std::memory_order_acquire) != pop_pos_ + 1) {
+            return false;
+        }
+        out.append(curr_slot.data.data(), curr_slot.size);
+        curr_slot.sequence.store(pop_pos_ + mask_ + 1, std::memory_order_release);
+        ++pop_pos_;
+        return true;
+    }
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace common {
+
+    /*
+     * Bounded lock-free queue of formatted log records, many threads push,
+     * one thread pops. Every slot has a sequence number telling whether
+     * it is free for the producer with the same position or ready for
+     * the consumer. Records longer than a slot are truncated.
+     */
+    class log_ring {
+    public:
+        static constexpr std::size_t record_size{256};
+
+    public:
+        // capacity must be a power of two
+        explicit log_ring(std::size_t capacity);
+        log_ring(const log_ring &) = delete;
+        log_ring &operator=(const log_ring &) = delete;
+
+    public:
+        // returns false if the ring is full
+        bool push(const char *data, std::size_t size) noexcept;
+        // appends the next record to 'out', returns false if the ring is empty
+        bool pop(std::string &out);
+
+    private:
+        struct slot {
+            std::atomic<std::size_t> sequence;
+            std::size_t size;
+            std::array<char, record_size> data;
+        };
+
+    private:
+        const std::size_t mask_;
+        std::unique_ptr<slot[]> slots_;
+        std::atomic<std::size_t> push_pos_{0};
+        // keeps producers and the consumer on different cache lines
+        char padding_[64];
+        std::size_t pop_pos_{0};
+    };
+
+}
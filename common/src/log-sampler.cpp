@@ -0,0 +1,86 @@
+#include "log-sampler.h"
+#include "async-appender.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace {
+
+    const std::size_t categories_count{static_cast<std::size_t>(common::log_category::count)};
+
+    struct shared_limits {
+        std::atomic<std::uint32_t> max_per_second{common::log_limits{}.max_per_second};
+        std::atomic<std::uint32_t> sample_every{common::log_limits{}.sample_every};
+    };
+
+    struct sampler_state {
+        std::uint64_t seen{0};
+        std::uint64_t suppressed{0};
+        std::int64_t window{-1};
+        std::uint32_t logged_in_window{0};
+    };
+
+    shared_limits limits[categories_count];
+    thread_local sampler_state states[categories_count];
+
+}
+
+namespace common {
+
+    void set_log_limits(log_category category, const log_limits &new_limits) noexcept
+    {
+        auto &category_limits{limits[static_cast<std::size_t>(category)]};
+        category_limits.max_per_second.store(new_limits.max_per_second, std::memory_order_relaxed);
+        category_limits.sample_every.store(new_limits.sample_every, std::memory_order_relaxed);
+    }
+
+    bool should_log(log_category category, std::uint64_t &suppressed) noexcept
+    {
+        const auto idx{static_cast<std::size_t>(category)};
+        auto &state{states[idx]};
+
+        const std::uint32_t sample_every{limits[idx].sample_every.load(std::memory_order_relaxed)};
+        if(sample_every > 1 && 0 != state.seen++ % sample_every) {
+            ++state.suppressed;
+            return false;
+        }
+
+        const std::uint32_t max_per_second{limits[idx].max_per_second.load(std::memory_order_relaxed)};
+        if(0 != max_per_second) {
+            const auto now{std::chrono::steady_clock::now().time_since_epoch()};
+            const std::int64_t window{std::chrono::duration_cast<std::chrono::seconds>(now).count()};
+            if(window != state.window) {
+                state.window = window;
+                state.logged_in_window = 0;
+            }
+            if(state.logged_in_window >= max_per_second) {
+                ++state.suppressed;
+                return false;
+            }
+            ++state.logged_in_window;
+        }
+
+        suppressed = state.suppressed;
+        state.suppressed = 0;
+        return true;
+    }
+
+    std::ostringstream &sampled_log_stream()
+    {
+        thread_local std::ostringstream stream;
+        stream.str(std::string{});
+        stream.clear();
+        return stream;
+    }
+
+    void log_sampled_info(const log4cplus::Logger &logger, const std::string &msg)
+    {
+        auto *appender{async_appender::installed()};
+        if(nullptr != appender) {
+            appender->push_record("INFO", msg);
+        } else {
+            LOG4CPLUS_INFO(logger, msg);
+        }
+    }
+
+}
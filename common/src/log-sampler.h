@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include <log4cplus/loggingmacros.h>
+#include <log4cplus/loglevel.h>
+
+namespace common {
+
+    // Kinds of frequent events which are sampled and rate limited
+    enum class log_category : std::uint8_t {
+        message,
+        count
+    };
+
+    struct log_limits {
+        // 0 means no limit
+        std::uint32_t max_per_second{100};
+        // log one of every 'sample_every' events
+        std::uint32_t sample_every{1};
+    };
+
+    // Limits are shared by all threads, counters are per thread
+    void set_log_limits(log_category category, const log_limits &limits) noexcept;
+
+    // Returns true if the next event of the category should be logged,
+    // 'suppressed' is the number of events skipped since the last logged one
+    bool should_log(log_category category, std::uint64_t &suppressed) noexcept;
+
+    // Empty stream of the current thread to build a sampled record in
+    std::ostringstream &sampled_log_stream();
+
+    // Pushes an INFO record straight into the ring of the async appender when it
+    // is installed, the appender lock of log4cplus is not taken then
+    void log_sampled_info(const log4cplus::Logger &logger, const std::string &msg);
+
+}
+
+/*
+ * Per-message logging, compiled out entirely with COMMON_NO_SAMPLED_LOGS
+ */
+#ifdef COMMON_NO_SAMPLED_LOGS
+#define COMMON_LOG_SAMPLED_INFO(logger, category, msg) do { } while(0)
+#else
+#define COMMON_LOG_SAMPLED_INFO(logger, category, msg) \
+    do { \
+        std::uint64_t suppressed_{0}; \
+        if((logger).isEnabledFor(log4cplus::INFO_LOG_LEVEL) && common::should_log(category, suppressed_)) { \
+            auto &stream_{common::sampled_log_stream()}; \
+            stream_ << msg; \
+            if(0 != suppressed_) { \
+                stream_ << " (" << suppressed_ << " similar suppressed)"; \
+            } \
+            common::log_sampled_info(logger, stream_.str()); \
+        } \
+    } while(0)
+#endif
@@ -18,6 +18,16 @@ namespace common {
         return make_sockaddr(resolve_host_by_name(), port_);
     }
 
+    const std::string &remote_server::host() const noexcept
+    {
+        return host_;
+    }
+
+    std::uint16_t remote_server::port() const noexcept
+    {
+        return port_;
+    }
+
     bool remote_server::is_ipv4() const noexcept
     {
         sockaddr_in sa;
@@ -40,4 +50,12 @@ namespace common {
         return os;
     }
 
+    bool operator<(const remote_server &lhs, const remote_server &rhs) noexcept
+    {
+        if(lhs.port() != rhs.port()) {
+            return lhs.port() < rhs.port();
+        }
+        return lhs.host() < rhs.host();
+    }
+
 }
@@ -10,10 +10,12 @@ namespace common {
     public:
         remote_server(const std::string &host, std::uint16_t port);
         sockaddr_in sockaddr() const;
+        const std::string &host() const noexcept;
+        std::uint16_t port() const noexcept;
+        bool is_ipv4() const noexcept;
         friend std::ostream &operator<<(std::ostream &os, const remote_server &rs);
 
     private:
-        bool is_ipv4() const noexcept;
         std::string resolve_host_by_name() const;
 
     private:
@@ -23,4 +25,6 @@ namespace common {
 
     std::ostream& operator<<(std::ostream& os, const remote_server &rs);
 
+    bool operator<(const remote_server &lhs, const remote_server &rhs) noexcept;
+
 }
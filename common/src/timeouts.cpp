@@ -0,0 +1,51 @@
+#include "timeouts.h"
+
+#include <string>
+#include <stdexcept>
+
+namespace common {
+
+    common_timeouts::common_timeouts(event_base *base, const timeouts &durations)
+        : base_{base}
+        , handshake_{get(durations.handshake)}
+        , connect_{get(durations.connect)}
+        , idle_{get(durations.idle)}
+        , write_{get(durations.write)}
+    { }
+
+    const timeval *common_timeouts::handshake() const noexcept
+    {
+        return handshake_;
+    }
+
+    const timeval *common_timeouts::connect() const noexcept
+    {
+        return connect_;
+    }
+
+    const timeval *common_timeouts::idle() const noexcept
+    {
+        return idle_;
+    }
+
+    const timeval *common_timeouts::write() const noexcept
+    {
+        return write_;
+    }
+
+    const timeval *common_timeouts::get(std::chrono::milliseconds duration) const
+    {
+        if(duration <= std::chrono::milliseconds::zero()) {
+            return nullptr;
+        }
+        const auto ms{duration.count()};
+        const timeval timeout{static_cast<time_t>(ms / 1000), static_cast<suseconds_t>(ms % 1000 * 1000)};
+        // the base keeps one queue per duration, equal durations share it
+        const auto *common_timeout{event_base_init_common_timeout(base_, &timeout)};
+        if(nullptr == common_timeout) {
+            throw std::runtime_error{"Can not create common timeout of " + std::to_string(ms) + " ms"};
+        }
+        return common_timeout;
+    }
+
+}
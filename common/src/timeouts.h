@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <event2/event.h>
+
+namespace common {
+
+    // Zero duration disables a timeout
+    struct timeouts {
+        // from accept until the init message is read
+        std::chrono::milliseconds handshake{10000};
+        // from the start of connect until the connection is established
+        std::chrono::milliseconds connect{5000};
+        // without any data read from an established connection
+        std::chrono::milliseconds idle{300000};
+        // while written data is queued and the socket does not take any of it
+        std::chrono::milliseconds write{30000};
+    };
+
+    /*
+     * Timeouts of one event_base registered as libevent common timeouts.
+     * Events with the same common timeout are kept in one queue ordered
+     * by deadline instead of the timer heap, so adding and removing them is O(1)
+     * and the heap holds a single event per duration whatever the number of
+     * bufferevents is. Returned timevals are passed to bufferevent_set_timeouts
+     * or evtimer_add of the same base, nullptr means the timeout is disabled.
+     */
+    class common_timeouts {
+    public:
+        common_timeouts(event_base *base, const timeouts &durations);
+
+    public:
+        const timeval *handshake() const noexcept;
+        const timeval *connect() const noexcept;
+        const timeval *idle() const noexcept;
+        const timeval *write() const noexcept;
+        // any other duration of the same base, for example idle time of pooled connections
+        const timeval *get(std::chrono::milliseconds duration) const;
+
+    private:
+        event_base *base_;
+        const timeval *handshake_;
+        const timeval *connect_;
+        const timeval *idle_;
+        const timeval *write_;
+    };
+
+}
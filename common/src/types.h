@@ -1,6 +1,8 @@
 #pragma once
 
 #include <memory>
+#include <event2/dns.h>
+#include <event2/http.h>
 #include <event2/event.h>
 #include <event2/buffer.h>
 #include <event2/listener.h>
@@ -17,6 +19,15 @@ namespace common {
     using event_base_ptr = std::unique_ptr<event_base, event_base_deleter>;
 
 
+    struct event_config_deleter {
+        void operator()(event_config *ptr) const noexcept {
+            event_config_free(ptr);
+        }
+    };
+
+    using event_config_ptr = std::unique_ptr<event_config, event_config_deleter>;
+
+
     struct evconnlistener_deleter {
         void operator()(evconnlistener *ptr) const noexcept {
             evconnlistener_free(ptr);
@@ -34,4 +45,41 @@ namespace common {
 
     using bufferevent_ptr = std::unique_ptr<bufferevent, bufferevent_deleter>;
 
+
+    struct event_deleter {
+        void operator()(event *ptr) const noexcept {
+            event_free(ptr);
+        }
+    };
+
+    using event_ptr = std::unique_ptr<event, event_deleter>;
+
+
+    struct evdns_base_deleter {
+        void operator()(evdns_base *ptr) const noexcept {
+            // pending requests are failed, their callbacks are called
+            evdns_base_free(ptr, 1);
+        }
+    };
+
+    using evdns_base_ptr = std::unique_ptr<evdns_base, evdns_base_deleter>;
+
+
+    struct evbuffer_deleter {
+        void operator()(evbuffer *ptr) const noexcept {
+            evbuffer_free(ptr);
+        }
+    };
+
+    using evbuffer_ptr = std::unique_ptr<evbuffer, evbuffer_deleter>;
+
+
+    struct evhttp_deleter {
+        void operator()(evhttp *ptr) const noexcept {
+            evhttp_free(ptr);
+        }
+    };
+
+    using evhttp_ptr = std::unique_ptr<evhttp, evhttp_deleter>;
+
 }
@@ -1,7 +1,6 @@
 #include "utils.h"
 
 #include <cstring>
-#include <log4cplus/consoleappender.h>
 
 namespace {
 
@@ -40,10 +39,8 @@ namespace common {
 
     log4cplus::Logger make_logger(const std::string &logger_name)
     {
-        log4cplus::Logger logger{log4cplus::Logger::getInstance(LOG4CPLUS_TEXT(logger_name))};
-        log4cplus::SharedAppenderPtr consoleAppender(new log4cplus::ConsoleAppender(false, true));
-        logger.addAppender(consoleAppender);
-        return logger;
+        // output goes through the root appenders, see async_logging
+        return log4cplus::Logger::getInstance(LOG4CPLUS_TEXT(logger_name));
     }
 
 }
@@ -0,0 +1,91 @@
+#include "../src/compression.h"
+#include "../src/types.h"
+
+#include <string>
+#include <vector>
+
+#include <event2/buffer.h>
+#include <gtest/gtest.h>
+
+using namespace common;
+
+namespace {
+
+    // regular frames with the same payload, decoded data is many times larger
+    // than its input, so the output space is filled before the input is consumed
+    std::string make_frames(std::size_t count)
+    {
+        const std::string frame{"msg#\x00\x00\x00\x01\x00\x00\x00\x07", 12};
+        std::string data;
+        data.reserve(count * frame.size());
+        for(std::size_t frame_idx = 0; frame_idx < count; ++frame_idx) {
+            data += frame;
+        }
+        return data;
+    }
+
+    std::string drain(evbuffer *buffer)
+    {
+        std::string data(evbuffer_get_length(buffer), '\0');
+        evbuffer_remove(buffer, &data[0], data.size());
+        return data;
+    }
+
+    // Compresses 'data' by parts of 'part_size' bytes as a connection does, every
+    // compressed part is decompressed by pieces of 'piece_size' bytes right away
+    // and must give all data compressed so far
+    void round_trip(compression_type type, const std::string &data, std::size_t part_size, std::size_t piece_size)
+    {
+        auto compressor{make_compressor(type)};
+        auto decompressor{make_decompressor(type)};
+        common::evbuffer_ptr compressed{evbuffer_new()};
+        common::evbuffer_ptr decompressed{evbuffer_new()};
+        const auto decompress_all = [&]() {
+            const auto part{drain(compressed.get())};
+            for(std::size_t pos = 0; pos < part.size(); pos += piece_size) {
+                decompressor->decompress(part.data() + pos, std::min(piece_size, part.size() - pos), decompressed.get());
+            }
+        };
+        for(std::size_t pos = 0; pos < data.size(); pos += part_size) {
+            const std::size_t size{std::min(part_size, data.size() - pos)};
+            compressor->compress(data.data() + pos, size, compressed.get());
+            decompress_all();
+            ASSERT_EQ(pos + size, evbuffer_get_length(decompressed.get()));
+        }
+        compressor->finish(compressed.get());
+        decompress_all();
+        EXPECT_TRUE(data == drain(decompressed.get()));
+    }
+
+}
+
+TEST(compression, ReadCompressionType)
+{
+    for(const auto type : {compression_type::none, compression_type::lz4, compression_type::zstd}) {
+        EXPECT_EQ(type, read_compression_type(compression_name(type)));
+    }
+    EXPECT_THROW(read_compression_type("gzip"), std::invalid_argument);
+}
+
+TEST(compression, NoCompressor)
+{
+    EXPECT_EQ(nullptr, make_compressor(compression_type::none));
+    EXPECT_EQ(nullptr, make_decompressor(compression_type::none));
+}
+
+TEST(compression, RoundTripCompressibleStream)
+{
+    // a compressed part decodes to many output spaces, the last one can be
+    // filled exactly while decoded bytes are still in the decoder
+    const auto data{make_frames(1024 * 1024)};
+    for(const auto type : {compression_type::lz4, compression_type::zstd}) {
+        SCOPED_TRACE(compression_name(type));
+        for(const std::size_t part_size : {std::size_t{4096}, std::size_t{5000}, data.size()}) {
+            SCOPED_TRACE(part_size);
+            for(const std::size_t piece_size : {std::size_t{7}, std::size_t{1000}, data.size()}) {
+                SCOPED_TRACE(piece_size);
+                round_trip(type, data, part_size, piece_size);
+            }
+        }
+    }
+}
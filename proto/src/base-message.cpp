@@ -1,14 +1,7 @@
 #include "base-message.h"
 
-#include <arpa/inet.h>
 #include <stdexcept>
 
-namespace {
-
-    const std::string prefix{"msg#"};
-
-}
-
 namespace proto {
 
     base_message::base_message(message_type type)
@@ -17,13 +10,14 @@ namespace proto {
 
     base_message::base_message(bytes data)
         : data_{std::move(data)}
-        , read_pos_{std::next(data_.cbegin(), static_cast<bytes::difference_type>(prefix.size()))}
     { }
 
     void base_message::save()
     {
-        save_message_prefix();
-        save_uint32(static_cast<std::uint32_t>(type_));
+        // derived messages append one value, allocate once for the whole frame
+        data_.reserve(codec::header_length + sizeof(std::uint32_t));
+        data_.resize(codec::header_length);
+        codec::store_header(data_.data(), type_);
     }
 
     void base_message::load()
@@ -41,36 +35,41 @@ namespace proto {
         return type_;
     }
 
-    std::size_t base_message::message_length() noexcept
+    bool base_message::check_header(const byte *data, message_type type) noexcept
     {
-        return prefix.size() + sizeof(message_type);
+        return codec::check_header(data, type);
     }
 
     void base_message::save_uint32(std::uint32_t value)
     {
-        const std::uint32_t be_value{htonl(value)};
-        data_.reserve(data_.size() + sizeof(std::uint32_t));
-        const auto *start_pos{reinterpret_cast<const char *>(&be_value)};
-        std::copy(start_pos, start_pos + sizeof(std::uint32_t), std::back_inserter(data_));
+        const std::size_t write_pos{data_.size()};
+        data_.resize(write_pos + sizeof(std::uint32_t));
+        codec::store_uint32(data_.data() + write_pos, value);
     }
 
-    std::uint32_t base_message::load_uint32()
+    void base_message::save_bytes(const bytes &value)
     {
-        const auto dist{std::distance(read_pos_, data_.cend())};
-        const auto uint32_diff_size{static_cast<bytes::difference_type>(sizeof(std::uint32_t))};
-        if(dist < uint32_diff_size) {
-            throw std::runtime_error{"Can not read uint32: too little data"};
+        data_.insert(data_.end(), value.cbegin(), value.cend());
+    }
+
+    bytes base_message::load_bytes(std::size_t length)
+    {
+        if(read_pos_ > data_.size() || data_.size() - read_pos_ < length) {
+            throw std::runtime_error{"Can not read bytes: too little data"};
         }
-        const std::uint32_t *value_ptr{reinterpret_cast<const std::uint32_t *>(&(*read_pos_))};
-        const std::uint32_t value{ntohl(*value_ptr)};
-        std::advance(read_pos_, sizeof(std::uint32_t));
-        return value;
+        const auto start_pos{data_.cbegin() + static_cast<bytes::difference_type>(read_pos_)};
+        read_pos_ += length;
+        return bytes(start_pos, start_pos + static_cast<bytes::difference_type>(length));
     }
 
-    void base_message::save_message_prefix()
+    std::uint32_t base_message::load_uint32()
     {
-        data_.reserve(prefix.size());
-        std::copy(prefix.cbegin(), prefix.cend(), std::back_inserter(data_));
+        if(read_pos_ > data_.size() || data_.size() - read_pos_ < sizeof(std::uint32_t)) {
+            throw std::runtime_error{"Can not read uint32: too little data"};
+        }
+        const std::uint32_t value{codec::load_uint32(data_.data() + read_pos_)};
+        read_pos_ += sizeof(std::uint32_t);
+        return value;
     }
 
 }
@@ -1,23 +1,19 @@
 #pragma once
 
+#include "codec.h"
+
 #include <vector>
 #include <string>
 
 namespace proto {
 
-    using byte = std::uint8_t;
-    using bytes = std::vector<byte>;
-
-    enum class message_type : std::uint32_t {
-        init = 0,
-        regular
-    };
-
     /*
      * base_message
      * |*****prefix*****|*****type*****|
      * |                               |
      * |--------message_length---------|
+     *
+     * Owns its bytes, kept for compatibility, the hot path uses proto::codec
      */
 
     class base_message {
@@ -28,7 +24,11 @@ namespace proto {
 
     public:
         message_type type() const noexcept;
-        static std::size_t message_length() noexcept;
+        static constexpr std::size_t message_length() noexcept
+        {
+            return codec::header_length;
+        }
+        static bool check_header(const byte *data, message_type type) noexcept;
 
     public:
         void save();
@@ -38,14 +38,13 @@ namespace proto {
     protected:
         void save_uint32(std::uint32_t value);
         std::uint32_t load_uint32();
-
-    private:
-        void save_message_prefix();
+        void save_bytes(const bytes &value);
+        bytes load_bytes(std::size_t length);
 
     private:
         message_type type_;
         bytes data_;
-        bytes::const_iterator read_pos_;
+        std::size_t read_pos_{codec::prefix_length};
     };
 
     template<typename msg_t,
@@ -0,0 +1,45 @@
+#include "batch-message.h"
+
+namespace proto {
+
+    batch_message::batch_message(payloads_t payloads)
+        : base_message(message_type::batch)
+        , payloads_{std::move(payloads)}
+    { }
+
+    batch_message::batch_message(bytes data)
+        : base_message(std::move(data))
+    { }
+
+    const batch_message::payloads_t &batch_message::payloads() const noexcept
+    {
+        return payloads_;
+    }
+
+    void batch_message::save()
+    {
+        base_message::save();
+        save_uint32(static_cast<std::uint32_t>(payloads_.size()));
+        for(const auto payload : payloads_) {
+            save_uint32(payload);
+        }
+    }
+
+    void batch_message::load()
+    {
+        base_message::load();
+        const std::uint32_t count{load_uint32()};
+        payloads_.clear();
+        for(std::uint32_t idx = 0; idx < count; ++idx) {
+            payloads_.push_back(load_uint32());
+        }
+    }
+
+    batch_message make_batch_message(batch_message::payloads_t payloads)
+    {
+        batch_message msg{std::move(payloads)};
+        msg.save();
+        return msg;
+    }
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "regular-message.h"
+
+namespace proto {
+
+    /*
+     * batch_message
+     * |*****base_message*****|*****count:uint32*****|*****payload:uint32*****|...
+     * |                                                                        |
+     * |-----------------------------message_length-----------------------------|
+     */
+
+    class batch_message
+        : public base_message
+    {
+    public:
+        using payload_t = regular_message::payload_t;
+        using payloads_t = std::vector<payload_t>;
+
+    public:
+        explicit batch_message(payloads_t payloads);
+        explicit batch_message(bytes data);
+        batch_message(batch_message &&rhs) = default;
+
+    public:
+        const payloads_t &payloads() const noexcept;
+        static constexpr std::size_t message_length(std::size_t count) noexcept
+        {
+            return codec::batch_length(count);
+        }
+
+    public:
+        void save();
+        void load();
+
+    private:
+        payloads_t payloads_;
+    };
+
+    batch_message make_batch_message(batch_message::payloads_t payloads);
+
+}
@@ -0,0 +1,222 @@
+#include "bulk-decoder.h"
+
+#include <stdexcept>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PROTO_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace {
+
+    using namespace proto;
+
+    using decode_func_t = std::size_t (*)(const byte *data, std::size_t frames_count, std::uint32_t *payloads);
+
+    // Decodes frames one by one, returns the number of valid frames
+    std::size_t decode_scalar(const byte *data, std::size_t frames_count, std::uint32_t *payloads)
+    {
+        for(std::size_t frame_idx = 0; frame_idx < frames_count; ++frame_idx) {
+            const byte *frame{data + frame_idx * codec::regular_length};
+            if(!codec::check_header(frame, message_type::regular)) {
+                return frame_idx;
+            }
+            if(nullptr != payloads) {
+                payloads[frame_idx] = codec::load_value(frame);
+            }
+        }
+        return frames_count;
+    }
+
+#ifdef PROTO_X86_SIMD
+
+    // Expected bytes of 'frames' consecutive regular frames and the mask of
+    // payload bytes which are not compared
+    template<std::size_t frames>
+    struct frames_pattern {
+        alignas(32) byte expected[frames * codec::regular_length];
+        alignas(32) byte ignored[frames * codec::regular_length];
+
+        frames_pattern()
+        {
+            for(std::size_t frame_idx = 0; frame_idx < frames; ++frame_idx) {
+                byte *frame{expected + frame_idx * codec::regular_length};
+                codec::store_regular(frame, 0);
+                for(std::size_t idx = 0; idx < codec::regular_length; ++idx) {
+                    ignored[frame_idx * codec::regular_length + idx] = idx < codec::header_length ? 0x00 : 0xff;
+                }
+            }
+        }
+    };
+
+    // 4 frames are 3 xmm registers
+    const frames_pattern<4> sse4_pattern;
+    // 8 frames are 3 ymm registers
+    const frames_pattern<8> avx2_pattern;
+
+    __attribute__((target("sse4.1")))
+    bool check_sse4_block(const byte *data)
+    {
+        __m128i all_equal{_mm_set1_epi8(-1)};
+        for(std::size_t reg_idx = 0; reg_idx < 3; ++reg_idx) {
+            const std::size_t pos{reg_idx * sizeof(__m128i)};
+            const __m128i value{_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos))};
+            const __m128i expected{_mm_load_si128(reinterpret_cast<const __m128i *>(sse4_pattern.expected + pos))};
+            const __m128i ignored{_mm_load_si128(reinterpret_cast<const __m128i *>(sse4_pattern.ignored + pos))};
+            all_equal = _mm_and_si128(all_equal, _mm_or_si128(_mm_cmpeq_epi8(value, expected), ignored));
+        }
+        return 0 != _mm_test_all_ones(all_equal);
+    }
+
+    __attribute__((target("sse4.1")))
+    std::size_t decode_sse4(const byte *data, std::size_t frames_count, std::uint32_t *payloads)
+    {
+        // payloads start at bytes 8, 20, 32 and 44 of a block, each one is
+        // moved to its lane with the bytes swapped
+        const __m128i shuffle_0{_mm_setr_epi8(11, 10, 9, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)};
+        const __m128i shuffle_1{_mm_setr_epi8(-1, -1, -1, -1, 7, 6, 5, 4, -1, -1, -1, -1, -1, -1, -1, -1)};
+        const __m128i shuffle_2{_mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 3, 2, 1, 0, 15, 14, 13, 12)};
+
+        const std::size_t block_frames{4};
+        std::size_t frame_idx{0};
+        for(; frame_idx + block_frames <= frames_count; frame_idx += block_frames) {
+            const byte *block{data + frame_idx * codec::regular_length};
+            if(!check_sse4_block(block)) {
+                break;
+            }
+            if(nullptr != payloads) {
+                const __m128i reg_0{_mm_loadu_si128(reinterpret_cast<const __m128i *>(block))};
+                const __m128i reg_1{_mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16))};
+                const __m128i reg_2{_mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 32))};
+                const __m128i values{_mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(reg_0, shuffle_0),
+                                                               _mm_shuffle_epi8(reg_1, shuffle_1)),
+                                                  _mm_shuffle_epi8(reg_2, shuffle_2))};
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(payloads + frame_idx), values);
+            }
+        }
+
+        std::uint32_t *tail_payloads{nullptr == payloads ? nullptr : payloads + frame_idx};
+        return frame_idx + decode_scalar(data + frame_idx * codec::regular_length, frames_count - frame_idx, tail_payloads);
+    }
+
+    __attribute__((target("avx2")))
+    bool check_avx2_block(const byte *data)
+    {
+        __m256i all_equal{_mm256_set1_epi8(-1)};
+        for(std::size_t reg_idx = 0; reg_idx < 3; ++reg_idx) {
+            const std::size_t pos{reg_idx * sizeof(__m256i)};
+            const __m256i value{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos))};
+            const __m256i expected{_mm256_load_si256(reinterpret_cast<const __m256i *>(avx2_pattern.expected + pos))};
+            const __m256i ignored{_mm256_load_si256(reinterpret_cast<const __m256i *>(avx2_pattern.ignored + pos))};
+            all_equal = _mm256_and_si256(all_equal, _mm256_or_si256(_mm256_cmpeq_epi8(value, expected), ignored));
+        }
+        return -1 == _mm256_movemask_epi8(all_equal);
+    }
+
+    __attribute__((target("avx2")))
+    std::size_t decode_avx2(const byte *data, std::size_t frames_count, std::uint32_t *payloads)
+    {
+        // payloads are dwords 2, 5, 8, 11, 14, 17, 20 and 23 of a block:
+        // the first register has two of them, the second and the third have three
+        const __m256i permute_0{_mm256_setr_epi32(2, 5, 0, 0, 0, 0, 0, 0)};
+        const __m256i permute_1{_mm256_setr_epi32(0, 0, 0, 3, 6, 0, 0, 0)};
+        const __m256i permute_2{_mm256_setr_epi32(0, 0, 0, 0, 0, 1, 4, 7)};
+        const __m256i swap_bytes{_mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                                  3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)};
+
+        const std::size_t block_frames{8};
+        std::size_t frame_idx{0};
+        for(; frame_idx + block_frames <= frames_count; frame_idx += block_frames) {
+            const byte *block{data + frame_idx * codec::regular_length};
+            if(!check_avx2_block(block)) {
+                break;
+            }
+            if(nullptr != payloads) {
+                const __m256i reg_0{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(block))};
+                const __m256i reg_1{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32))};
+                const __m256i reg_2{_mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 64))};
+                __m256i values{_mm256_permutevar8x32_epi32(reg_0, permute_0)};
+                values = _mm256_blend_epi32(values, _mm256_permutevar8x32_epi32(reg_1, permute_1), 0x1c);
+                values = _mm256_blend_epi32(values, _mm256_permutevar8x32_epi32(reg_2, permute_2), 0xe0);
+                values = _mm256_shuffle_epi8(values, swap_bytes);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(payloads + frame_idx), values);
+            }
+        }
+
+        std::uint32_t *tail_payloads{nullptr == payloads ? nullptr : payloads + frame_idx};
+        return frame_idx + decode_sse4(data + frame_idx * codec::regular_length, frames_count - frame_idx, tail_payloads);
+    }
+
+#endif
+
+    decode_func_t get_decode_func(bulk_decoder_impl impl)
+    {
+        switch(impl) {
+        case bulk_decoder_impl::scalar:
+            return decode_scalar;
+#ifdef PROTO_X86_SIMD
+        case bulk_decoder_impl::sse4:
+            return decode_sse4;
+        case bulk_decoder_impl::avx2:
+            return decode_avx2;
+#else
+        default:
+            break;
+#endif
+        }
+        throw std::invalid_argument{"Bulk decoder implementation is not supported"};
+    }
+
+    decode_func_t choose_decode_func()
+    {
+        for(const auto impl : {bulk_decoder_impl::avx2, bulk_decoder_impl::sse4}) {
+            if(is_supported(impl)) {
+                return get_decode_func(impl);
+            }
+        }
+        return decode_scalar;
+    }
+
+    bulk_decode_result make_result(std::size_t valid_frames, std::size_t frames_count) noexcept
+    {
+        return {valid_frames, valid_frames == frames_count ? bulk_decode_result::no_error
+                                                           : valid_frames * codec::regular_length};
+    }
+
+}
+
+namespace proto {
+
+    constexpr std::size_t bulk_decode_result::no_error;
+
+    bulk_decode_result decode_regular_frames(const byte *data, std::size_t frames_count, std::uint32_t *payloads)
+    {
+        static const decode_func_t decode_func{choose_decode_func()};
+        return make_result(decode_func(data, frames_count, payloads), frames_count);
+    }
+
+    bool is_supported(bulk_decoder_impl impl) noexcept
+    {
+        switch(impl) {
+        case bulk_decoder_impl::scalar:
+            return true;
+#ifdef PROTO_X86_SIMD
+        case bulk_decoder_impl::sse4:
+            return __builtin_cpu_supports("sse4.1");
+        case bulk_decoder_impl::avx2:
+            return __builtin_cpu_supports("avx2");
+#else
+        default:
+            break;
+#endif
+        }
+        return false;
+    }
+
+    bulk_decode_result decode_regular_frames(bulk_decoder_impl impl, const byte *data,
+                                             std::size_t frames_count, std::uint32_t *payloads)
+    {
+        return make_result(get_decode_func(impl)(data, frames_count, payloads), frames_count);
+    }
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "codec.h"
+
+namespace proto {
+
+    struct bulk_decode_result {
+        static constexpr std::size_t no_error{static_cast<std::size_t>(-1)};
+
+        // well-formed frames before the first malformed one
+        std::size_t valid_frames;
+        // byte offset of the first malformed frame, no_error if all frames are valid
+        std::size_t error_offset;
+
+        bool ok() const noexcept
+        {
+            return no_error == error_offset;
+        }
+    };
+
+    /*
+     * Checks prefixes and types of 'frames_count' regular frames laid out
+     * back to back in 'data' and extracts their payloads into 'payloads'
+     * (if it is not nullptr). Decoding stops at the first malformed frame,
+     * only payloads of the valid frames are written.
+     * Uses AVX2 or SSE4.1 when the CPU supports them.
+     */
+    bulk_decode_result decode_regular_frames(const byte *data, std::size_t frames_count, std::uint32_t *payloads);
+
+    // Implementations, exposed for tests
+    enum class bulk_decoder_impl {
+        scalar,
+        sse4,
+        avx2
+    };
+
+    bool is_supported(bulk_decoder_impl impl) noexcept;
+    bulk_decode_result decode_regular_frames(bulk_decoder_impl impl, const byte *data,
+                                             std::size_t frames_count, std::uint32_t *payloads);
+
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace proto {
+
+    using byte = std::uint8_t;
+    using bytes = std::vector<byte>;
+
+    enum class message_type : std::uint32_t {
+        init = 0,
+        regular,
+        typed,
+        batch
+    };
+
+    // Types of typed message values, numbers are big-endian
+    enum class value_type : std::uint32_t {
+        uint32 = 0,
+        uint64,
+        int64,
+        float64,
+        string,
+        blob
+    };
+
+    /*
+     * Allocation free encoding and decoding of frames in caller provided
+     * storage. All integers are big-endian.
+     * init and regular frames:
+     * |*****prefix:"msg#"*****|*****type:uint32*****|*****value:uint32*****|
+     * |                                             |
+     * |----------------header_length----------------|
+     *
+     * typed frames:
+     * |*****header*****|*****value_type:uint32*****|*****length:uint32*****|*****value*****|
+     * |                                                                    |
+     * |-------------------------typed_header_length------------------------|
+     *
+     * batch frames, payloads of regular frames packed together:
+     * |*****header*****|*****count:uint32*****|*****payload:uint32*****|...
+     * |                                       |
+     * |----------batch_header_length----------|
+     */
+
+    namespace codec {
+
+        constexpr std::size_t prefix_length{4};
+        constexpr std::size_t header_length{prefix_length + sizeof(message_type)};
+        constexpr std::size_t init_length{header_length + sizeof(std::uint32_t)};
+        constexpr std::size_t regular_length{header_length + sizeof(std::uint32_t)};
+        constexpr std::size_t typed_header_length{header_length + sizeof(value_type) + sizeof(std::uint32_t)};
+        constexpr std::size_t batch_header_length{header_length + sizeof(std::uint32_t)};
+
+        constexpr std::size_t batch_length(std::size_t count) noexcept
+        {
+            return batch_header_length + count * sizeof(std::uint32_t);
+        }
+
+        // "msg#" read as a big-endian uint32
+        constexpr std::uint32_t prefix_value{0x6d736723};
+
+        using init_frame = std::array<byte, init_length>;
+        using regular_frame = std::array<byte, regular_length>;
+
+        // compilers turn the shifts into a single load and byte swap
+        constexpr std::uint32_t load_uint32(const byte *data) noexcept
+        {
+            return static_cast<std::uint32_t>(data[0]) << 24
+                    | static_cast<std::uint32_t>(data[1]) << 16
+                    | static_cast<std::uint32_t>(data[2]) << 8
+                    | static_cast<std::uint32_t>(data[3]);
+        }
+
+        inline void store_uint32(byte *data, std::uint32_t value) noexcept
+        {
+            data[0] = static_cast<byte>(value >> 24);
+            data[1] = static_cast<byte>(value >> 16);
+            data[2] = static_cast<byte>(value >> 8);
+            data[3] = static_cast<byte>(value);
+        }
+
+        constexpr std::uint64_t load_uint64(const byte *data) noexcept
+        {
+            return static_cast<std::uint64_t>(load_uint32(data)) << 32 | load_uint32(data + sizeof(std::uint32_t));
+        }
+
+        inline void store_uint64(byte *data, std::uint64_t value) noexcept
+        {
+            store_uint32(data, static_cast<std::uint32_t>(value >> 32));
+            store_uint32(data + sizeof(std::uint32_t), static_cast<std::uint32_t>(value));
+        }
+
+        constexpr bool is_valid(value_type type) noexcept
+        {
+            return static_cast<std::uint32_t>(type) <= static_cast<std::uint32_t>(value_type::blob);
+        }
+
+        // length of values of fixed size types, 0 for strings and blobs
+        constexpr std::size_t fixed_value_length(value_type type) noexcept
+        {
+            return value_type::uint32 == type ? sizeof(std::uint32_t)
+                    : value_type::uint64 == type || value_type::int64 == type || value_type::float64 == type
+                      ? sizeof(std::uint64_t) : 0;
+        }
+
+        constexpr bool check_prefix(const byte *data) noexcept
+        {
+            return prefix_value == load_uint32(data);
+        }
+
+        constexpr bool check_header(const byte *data, message_type type) noexcept
+        {
+            return check_prefix(data) && static_cast<std::uint32_t>(type) == load_uint32(data + prefix_length);
+        }
+
+        constexpr message_type load_type(const byte *data) noexcept
+        {
+            return static_cast<message_type>(load_uint32(data + prefix_length));
+        }
+
+        // value of a frame which header is already checked
+        constexpr std::uint32_t load_value(const byte *data) noexcept
+        {
+            return load_uint32(data + header_length);
+        }
+
+        inline void store_header(byte *data, message_type type) noexcept
+        {
+            store_uint32(data, prefix_value);
+            store_uint32(data + prefix_length, static_cast<std::uint32_t>(type));
+        }
+
+        // 'data' must have room for init_length bytes
+        inline void store_init(byte *data, std::uint32_t client_id) noexcept
+        {
+            store_header(data, message_type::init);
+            store_uint32(data + header_length, client_id);
+        }
+
+        // 'data' must have room for regular_length bytes
+        inline void store_regular(byte *data, std::uint32_t payload) noexcept
+        {
+            store_header(data, message_type::regular);
+            store_uint32(data + header_length, payload);
+        }
+
+        // 'data' must have room for typed_header_length bytes, the value follows the header
+        inline void store_typed_header(byte *data, value_type type, std::uint32_t value_length) noexcept
+        {
+            store_header(data, message_type::typed);
+            store_uint32(data + header_length, static_cast<std::uint32_t>(type));
+            store_uint32(data + header_length + sizeof(value_type), value_length);
+        }
+
+        constexpr value_type load_value_type(const byte *data) noexcept
+        {
+            return static_cast<value_type>(load_uint32(data + header_length));
+        }
+
+        constexpr std::uint32_t load_value_length(const byte *data) noexcept
+        {
+            return load_uint32(data + header_length + sizeof(value_type));
+        }
+
+        // 'data' must have room for batch_length(count) bytes
+        inline void store_batch(byte *data, const std::uint32_t *payloads, std::size_t count) noexcept
+        {
+            store_header(data, message_type::batch);
+            store_uint32(data + header_length, static_cast<std::uint32_t>(count));
+            for(std::size_t idx = 0; idx < count; ++idx) {
+                store_uint32(data + batch_header_length + idx * sizeof(std::uint32_t), payloads[idx]);
+            }
+        }
+
+        constexpr std::uint32_t load_batch_count(const byte *data) noexcept
+        {
+            return load_uint32(data + header_length);
+        }
+
+        inline init_frame make_init_frame(std::uint32_t client_id) noexcept
+        {
+            init_frame frame;
+            store_init(frame.data(), client_id);
+            return frame;
+        }
+
+        inline regular_frame make_regular_frame(std::uint32_t payload) noexcept
+        {
+            regular_frame frame;
+            store_regular(frame.data(), payload);
+            return frame;
+        }
+
+        // Returns false if there are too few bytes or the header is not of the 'type'
+        constexpr bool decode(const byte *data, std::size_t size, message_type type, std::uint32_t &value) noexcept
+        {
+            if(size < header_length + sizeof(std::uint32_t) || !check_header(data, type)) {
+                return false;
+            }
+            value = load_value(data);
+            return true;
+        }
+
+    }
+
+}
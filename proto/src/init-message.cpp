@@ -11,11 +11,6 @@ namespace proto {
         : base_message(std::move(data))
     { }
 
-    std::size_t init_message::message_length() noexcept
-    {
-        return base_message::message_length() + sizeof(client_id_t);
-    }
-
     std::uint32_t init_message::client_id() const noexcept
     {
         return client_id_;
@@ -24,7 +24,10 @@ namespace proto {
 
     public:
         client_id_t client_id() const noexcept;
-        static std::size_t message_length() noexcept;
+        static constexpr std::size_t message_length() noexcept
+        {
+            return codec::init_length;
+        }
 
     public:
         void save();
@@ -13,11 +13,6 @@ namespace proto {
         : base_message(std::move(data))
     { }
 
-    std::size_t regular_message::message_length() noexcept
-    {
-        return base_message::message_length() + sizeof(payload_t);
-    }
-
     std::uint32_t regular_message::payload() const noexcept
     {
         return payload_;
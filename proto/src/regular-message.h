@@ -24,7 +24,10 @@ namespace proto {
 
     public:
         payload_t payload() const noexcept;
-        static std::size_t message_length() noexcept;
+        static constexpr std::size_t message_length() noexcept
+        {
+            return codec::regular_length;
+        }
 
     public:
         void save();
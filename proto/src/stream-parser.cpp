@@ -0,0 +1,189 @@
+#include "stream-parser.h"
+
+#include <algorithm>
+
+namespace proto {
+
+    constexpr std::size_t stream_parser::default_max_value_length;
+
+    stream_parser::stream_parser(std::size_t max_value_length, bool collect_values)
+        : max_value_length_{max_value_length}
+        , collect_values_{collect_values}
+    { }
+
+    std::size_t stream_parser::feed(const byte *data, std::size_t size)
+    {
+        if(state::complete == state_) {
+            reset();
+        }
+
+        std::size_t pos{0};
+        while(pos < size) {
+            switch(state_) {
+            case state::header:
+                pos += read_header(data + pos, size - pos, codec::header_length);
+                break;
+            case state::extended_header:
+                pos += read_header(data + pos, size - pos, message_type::typed == frame_.type
+                                                           ? codec::typed_header_length
+                                                           : codec::batch_header_length);
+                break;
+            case state::value:
+                pos += read_value(data + pos, size - pos);
+                break;
+            case state::complete:
+            case state::failed:
+                return pos;
+            }
+        }
+        return pos;
+    }
+
+    stream_parser::state stream_parser::current_state() const noexcept
+    {
+        return state_;
+    }
+
+    bool stream_parser::complete() const noexcept
+    {
+        return state::complete == state_;
+    }
+
+    bool stream_parser::at_frame_start() const noexcept
+    {
+        return state::complete == state_ || (state::header == state_ && 0 == frame_pos_);
+    }
+
+    bool stream_parser::failed() const noexcept
+    {
+        return state::failed == state_;
+    }
+
+    const frame_info &stream_parser::frame() const noexcept
+    {
+        return frame_;
+    }
+
+    std::size_t stream_parser::frame_pos() const noexcept
+    {
+        return frame_pos_;
+    }
+
+    const std::string &stream_parser::error() const noexcept
+    {
+        return error_;
+    }
+
+    void stream_parser::reset()
+    {
+        state_ = state::header;
+        frame_pos_ = 0;
+        value_pos_ = 0;
+        value_buffer_.clear();
+        frame_ = frame_info{};
+        error_.clear();
+    }
+
+    std::size_t stream_parser::read_header(const byte *data, std::size_t size, std::size_t header_length)
+    {
+        const std::size_t count{std::min(size, header_length - frame_pos_)};
+        std::copy_n(data, count, header_.begin() + static_cast<std::ptrdiff_t>(frame_pos_));
+        frame_pos_ += count;
+        if(header_length == frame_pos_) {
+            if(state::header == state_) {
+                on_header();
+            } else if(message_type::typed == frame_.type) {
+                on_typed_header();
+            } else {
+                on_batch_header();
+            }
+        }
+        return count;
+    }
+
+    std::size_t stream_parser::read_value(const byte *data, std::size_t size)
+    {
+        const std::size_t count{std::min(size, frame_.value_length - value_pos_)};
+        if(0 == value_pos_ && count == frame_.value_length) {
+            frame_.value = data;
+        } else if(collect_values_) {
+            value_buffer_.insert(value_buffer_.end(), data, data + count);
+            frame_.value = value_buffer_.data();
+        }
+        value_pos_ += count;
+        frame_pos_ += count;
+        if(frame_.value_length == value_pos_) {
+            state_ = state::complete;
+        }
+        return count;
+    }
+
+    void stream_parser::on_header()
+    {
+        if(!codec::check_prefix(header_.data())) {
+            fail("Invalid message prefix");
+            return;
+        }
+        frame_.type = codec::load_type(header_.data());
+        switch(frame_.type) {
+        case message_type::init:
+        case message_type::regular:
+            frame_.kind = value_type::uint32;
+            frame_.value_length = sizeof(std::uint32_t);
+            frame_.length = codec::header_length + frame_.value_length;
+            state_ = state::value;
+            break;
+        case message_type::typed:
+        case message_type::batch:
+            state_ = state::extended_header;
+            break;
+        default:
+            fail("Unknown message type " + std::to_string(static_cast<std::uint32_t>(frame_.type)));
+            break;
+        }
+    }
+
+    void stream_parser::on_typed_header()
+    {
+        frame_.kind = codec::load_value_type(header_.data());
+        frame_.value_length = codec::load_value_length(header_.data());
+        frame_.length = codec::typed_header_length + frame_.value_length;
+        const std::size_t fixed_length{codec::fixed_value_length(frame_.kind)};
+        if(!codec::is_valid(frame_.kind)) {
+            fail("Unknown value type " + std::to_string(static_cast<std::uint32_t>(frame_.kind)));
+        } else if(0 != fixed_length && fixed_length != frame_.value_length) {
+            fail("Invalid value length " + std::to_string(frame_.value_length));
+        } else {
+            start_value();
+        }
+    }
+
+    void stream_parser::on_batch_header()
+    {
+        frame_.kind = value_type::uint32;
+        frame_.value_length = static_cast<std::size_t>(codec::load_batch_count(header_.data())) * sizeof(std::uint32_t);
+        frame_.length = codec::batch_header_length + frame_.value_length;
+        start_value();
+    }
+
+    void stream_parser::start_value()
+    {
+        if(frame_.value_length > max_value_length_) {
+            fail("Value is too long: " + std::to_string(frame_.value_length) + " bytes");
+        } else if(0 == frame_.value_length) {
+            state_ = state::complete;
+        } else {
+            if(collect_values_) {
+                value_buffer_.reserve(frame_.value_length);
+            }
+            state_ = state::value;
+        }
+    }
+
+    void stream_parser::fail(const std::string &error)
+    {
+        state_ = state::failed;
+        error_ = error;
+    }
+
+}
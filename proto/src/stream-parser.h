@@ -0,0 +1,87 @@
+#pragma once
+
+#include "codec.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace proto {
+
+    // Description of a parsed frame
+    struct frame_info {
+        message_type type;
+        // uint32 for init, regular and batch frames,
+        // the value of a batch is its big-endian payloads
+        value_type kind;
+        // whole frame with the header
+        std::size_t length;
+        // points into the fed data if the value was not split between feeds,
+        // otherwise into the parser buffer or nullptr if values are not collected
+        const byte *value;
+        std::size_t value_length;
+    };
+
+    /*
+     * Resumable parser of a stream of frames. Data is fed in pieces of any
+     * size, every byte is looked at once: a frame split between pieces is
+     * continued from the point where the previous piece ended. Only headers
+     * and split values (if they are collected) are copied, so memory used
+     * for one frame is bounded by max_value_length.
+     */
+    class stream_parser {
+    public:
+        static constexpr std::size_t default_max_value_length{64 * 1024};
+
+        enum class state {
+            header,
+            extended_header,    // the rest of typed or batch header
+            value,
+            complete,
+            failed
+        };
+
+    public:
+        explicit stream_parser(std::size_t max_value_length = default_max_value_length,
+                               bool collect_values = true);
+
+    public:
+        // Consumes bytes until the end of the current frame or the end of data,
+        // returns the number of consumed bytes. After a complete frame
+        // the next feed starts a new one.
+        std::size_t feed(const byte *data, std::size_t size);
+
+        state current_state() const noexcept;
+        bool complete() const noexcept;
+        // true if the next fed byte starts a new frame
+        bool at_frame_start() const noexcept;
+        bool failed() const noexcept;
+        // valid when the frame is complete until the next feed
+        const frame_info &frame() const noexcept;
+        // bytes of the current frame consumed so far
+        std::size_t frame_pos() const noexcept;
+        const std::string &error() const noexcept;
+        void reset();
+
+    private:
+        std::size_t read_header(const byte *data, std::size_t size, std::size_t header_length);
+        std::size_t read_value(const byte *data, std::size_t size);
+        void on_header();
+        void on_typed_header();
+        void on_batch_header();
+        void start_value();
+        void fail(const std::string &error);
+
+    private:
+        const std::size_t max_value_length_;
+        const bool collect_values_;
+        state state_{state::header};
+        std::array<byte, codec::typed_header_length> header_;
+        std::size_t frame_pos_{0};
+        std::size_t value_pos_{0};
+        bytes value_buffer_;
+        frame_info frame_{};
+        std::string error_;
+    };
+
+}
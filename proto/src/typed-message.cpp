@@ -0,0 +1,178 @@
+#include "typed-message.h"
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+    using namespace proto;
+
+    bytes make_fixed_value(std::uint64_t value, std::size_t length)
+    {
+        bytes data(length);
+        if(sizeof(std::uint32_t) == length) {
+            codec::store_uint32(data.data(), static_cast<std::uint32_t>(value));
+        } else {
+            codec::store_uint64(data.data(), value);
+        }
+        return data;
+    }
+
+    typed_message make_saved_message(value_type kind, bytes value)
+    {
+        typed_message msg{kind, std::move(value)};
+        msg.save();
+        return msg;
+    }
+
+    double to_float64(std::uint64_t bits) noexcept
+    {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+}
+
+namespace proto {
+
+    typed_message::typed_message(value_type kind, bytes value)
+        : base_message(message_type::typed)
+        , kind_{kind}
+        , value_{std::move(value)}
+    { }
+
+    typed_message::typed_message(bytes data)
+        : base_message(std::move(data))
+    { }
+
+    value_type typed_message::kind() const noexcept
+    {
+        return kind_;
+    }
+
+    const bytes &typed_message::value() const noexcept
+    {
+        return value_;
+    }
+
+    std::uint32_t typed_message::as_uint32() const
+    {
+        check_kind(value_type::uint32);
+        return codec::load_uint32(value_.data());
+    }
+
+    std::uint64_t typed_message::as_uint64() const
+    {
+        check_kind(value_type::uint64);
+        return codec::load_uint64(value_.data());
+    }
+
+    std::int64_t typed_message::as_int64() const
+    {
+        check_kind(value_type::int64);
+        return static_cast<std::int64_t>(codec::load_uint64(value_.data()));
+    }
+
+    double typed_message::as_float64() const
+    {
+        check_kind(value_type::float64);
+        return to_float64(codec::load_uint64(value_.data()));
+    }
+
+    std::string typed_message::as_string() const
+    {
+        check_kind(value_type::string);
+        return std::string(value_.cbegin(), value_.cend());
+    }
+
+    void typed_message::save()
+    {
+        base_message::save();
+        save_uint32(static_cast<std::uint32_t>(kind_));
+        save_uint32(static_cast<std::uint32_t>(value_.size()));
+        save_bytes(value_);
+    }
+
+    void typed_message::load()
+    {
+        base_message::load();
+        kind_ = static_cast<value_type>(load_uint32());
+        if(!codec::is_valid(kind_)) {
+            throw std::runtime_error{"Unknown value type"};
+        }
+        const std::uint32_t value_length{load_uint32()};
+        const std::size_t fixed_length{codec::fixed_value_length(kind_)};
+        if(0 != fixed_length && fixed_length != value_length) {
+            throw std::runtime_error{"Invalid value length"};
+        }
+        value_ = load_bytes(value_length);
+    }
+
+    void typed_message::check_kind(value_type kind) const
+    {
+        if(kind != kind_) {
+            throw std::runtime_error{"Typed message has another value type"};
+        }
+    }
+
+    typed_message make_uint32_message(std::uint32_t value)
+    {
+        return make_saved_message(value_type::uint32, make_fixed_value(value, sizeof(value)));
+    }
+
+    typed_message make_uint64_message(std::uint64_t value)
+    {
+        return make_saved_message(value_type::uint64, make_fixed_value(value, sizeof(value)));
+    }
+
+    typed_message make_int64_message(std::int64_t value)
+    {
+        return make_saved_message(value_type::int64, make_fixed_value(static_cast<std::uint64_t>(value), sizeof(value)));
+    }
+
+    typed_message make_float64_message(double value)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return make_saved_message(value_type::float64, make_fixed_value(bits, sizeof(bits)));
+    }
+
+    typed_message make_string_message(const std::string &value)
+    {
+        return make_saved_message(value_type::string, bytes(value.cbegin(), value.cend()));
+    }
+
+    typed_message make_blob_message(bytes value)
+    {
+        return make_saved_message(value_type::blob, std::move(value));
+    }
+
+    std::string format_value(value_type kind, const byte *value, std::size_t value_length)
+    {
+        std::ostringstream out;
+        switch(kind) {
+        case value_type::uint32:
+            out << codec::load_uint32(value);
+            break;
+        case value_type::uint64:
+            out << codec::load_uint64(value);
+            break;
+        case value_type::int64:
+            out << static_cast<std::int64_t>(codec::load_uint64(value));
+            break;
+        case value_type::float64:
+            out << to_float64(codec::load_uint64(value));
+            break;
+        case value_type::string:
+            out.write(reinterpret_cast<const char *>(value), static_cast<std::streamsize>(value_length));
+            break;
+        case value_type::blob:
+            out << "<blob of " << value_length << " bytes>";
+            break;
+        }
+        return out.str();
+    }
+
+}
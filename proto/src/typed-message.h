@@ -0,0 +1,60 @@
+#pragma once
+
+#include "base-message.h"
+
+namespace proto {
+
+    /*
+     * typed_message
+     * |*****base_message*****|*****value_type:uint32*****|*****length:uint32*****|*****value*****|
+     * |                                                                                         |
+     * |-------------------------------------message_length--------------------------------------|
+     */
+
+    class typed_message
+        : public base_message
+    {
+    public:
+        typed_message(value_type kind, bytes value);
+        explicit typed_message(bytes data);
+        typed_message(typed_message &&rhs) = default;
+
+    public:
+        value_type kind() const noexcept;
+        // raw value bytes, numbers are big-endian
+        const bytes &value() const noexcept;
+        static constexpr std::size_t message_length(std::size_t value_length) noexcept
+        {
+            return codec::typed_header_length + value_length;
+        }
+
+        // throw std::runtime_error if the value has another type
+        std::uint32_t as_uint32() const;
+        std::uint64_t as_uint64() const;
+        std::int64_t as_int64() const;
+        double as_float64() const;
+        std::string as_string() const;
+
+    public:
+        void save();
+        void load();
+
+    private:
+        void check_kind(value_type kind) const;
+
+    private:
+        value_type kind_;
+        bytes value_;
+    };
+
+    typed_message make_uint32_message(std::uint32_t value);
+    typed_message make_uint64_message(std::uint64_t value);
+    typed_message make_int64_message(std::int64_t value);
+    typed_message make_float64_message(double value);
+    typed_message make_string_message(const std::string &value);
+    typed_message make_blob_message(bytes value);
+
+    // Human readable value for logs, blobs are shown by their length
+    std::string format_value(value_type kind, const byte *value, std::size_t value_length);
+
+}
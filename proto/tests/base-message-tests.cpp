@@ -55,3 +55,23 @@ TEST(base_message, LoadFromInvalidStream)
     base_message msg{std::move(bytes)};
     EXPECT_THROW(msg.load(), std::runtime_error);
 }
+
+TEST(base_message, CheckHeader)
+{
+    foreach_message_type([](message_type type){
+        base_message msg{type};
+        msg.save();
+        EXPECT_TRUE(base_message::check_header(msg.as_bytes().data(), type));
+    });
+}
+
+TEST(base_message, CheckInvalidHeader)
+{
+    base_message msg{message_type::regular};
+    msg.save();
+    EXPECT_FALSE(base_message::check_header(msg.as_bytes().data(), message_type::init));
+
+    bytes data{msg.as_bytes()};
+    data.front() = 'M';
+    EXPECT_FALSE(base_message::check_header(data.data(), message_type::regular));
+}
@@ -0,0 +1,39 @@
+#include "../src/batch-message.h"
+
+#include <gtest/gtest.h>
+
+using namespace proto;
+
+TEST(batch_message, MessageLength)
+{
+    // base_message prefix size + count + payloads
+    ASSERT_EQ(base_message::message_length() + sizeof(std::uint32_t) + 3 * sizeof(batch_message::payload_t),
+              batch_message::message_length(3));
+}
+
+TEST(batch_message, SaveToAndLoadFromStream)
+{
+    const auto msg{make_batch_message({1024, 7, 0xffffffff})};
+    EXPECT_EQ(batch_message::message_length(3), msg.as_bytes().size());
+    batch_message new_msg{msg.as_bytes()};
+    new_msg.load();
+    EXPECT_EQ(message_type::batch, new_msg.type());
+    EXPECT_EQ(msg.payloads(), new_msg.payloads());
+}
+
+TEST(batch_message, MatchesCodec)
+{
+    const batch_message::payloads_t payloads{5, 6};
+    bytes data(codec::batch_length(payloads.size()));
+    codec::store_batch(data.data(), payloads.data(), payloads.size());
+    EXPECT_EQ(make_batch_message(payloads).as_bytes(), data);
+    EXPECT_EQ(2u, codec::load_batch_count(data.data()));
+}
+
+TEST(batch_message, LoadFromInvalidStream)
+{
+    bytes data{make_batch_message({1, 2}).as_bytes()};
+    data.pop_back();
+    batch_message msg{std::move(data)};
+    EXPECT_THROW(msg.load(), std::runtime_error);
+}
@@ -0,0 +1,91 @@
+#include "../src/bulk-decoder.h"
+#include "../src/base-message.h"
+
+#include <functional>
+
+#include <gtest/gtest.h>
+
+using namespace proto;
+
+namespace {
+
+    const std::size_t frames_count{37};
+
+    bytes make_frames(std::size_t count)
+    {
+        bytes data(count * codec::regular_length);
+        for(std::size_t frame_idx = 0; frame_idx < count; ++frame_idx) {
+            codec::store_regular(data.data() + frame_idx * codec::regular_length,
+                                 static_cast<std::uint32_t>(0x01020304 * (frame_idx + 1)));
+        }
+        return data;
+    }
+
+    void foreach_supported_impl(const std::function<void(bulk_decoder_impl impl)> &func)
+    {
+        for(const auto impl : {bulk_decoder_impl::scalar, bulk_decoder_impl::sse4, bulk_decoder_impl::avx2}) {
+            if(is_supported(impl)) {
+                SCOPED_TRACE(static_cast<int>(impl));
+                func(impl);
+            }
+        }
+    }
+
+}
+
+TEST(bulk_decoder, DecodeValidFrames)
+{
+    const auto data{make_frames(frames_count)};
+    foreach_supported_impl([&data](bulk_decoder_impl impl){
+        std::vector<std::uint32_t> payloads(frames_count);
+        const auto result{decode_regular_frames(impl, data.data(), frames_count, payloads.data())};
+        ASSERT_TRUE(result.ok());
+        EXPECT_EQ(frames_count, result.valid_frames);
+        for(std::size_t frame_idx = 0; frame_idx < frames_count; ++frame_idx) {
+            EXPECT_EQ(static_cast<std::uint32_t>(0x01020304 * (frame_idx + 1)), payloads[frame_idx]);
+        }
+    });
+}
+
+TEST(bulk_decoder, ValidateOnly)
+{
+    const auto data{make_frames(frames_count)};
+    foreach_supported_impl([&data](bulk_decoder_impl impl){
+        EXPECT_TRUE(decode_regular_frames(impl, data.data(), frames_count, nullptr).ok());
+    });
+}
+
+TEST(bulk_decoder, ReportFirstMalformedFrame)
+{
+    // every byte of the header of every frame position is broken once
+    for(std::size_t bad_frame = 0; bad_frame < frames_count; ++bad_frame) {
+        for(std::size_t bad_byte = 0; bad_byte < codec::header_length; ++bad_byte) {
+            auto data{make_frames(frames_count)};
+            data[bad_frame * codec::regular_length + bad_byte] ^= 0x20;
+            foreach_supported_impl([&](bulk_decoder_impl impl){
+                std::vector<std::uint32_t> payloads(frames_count);
+                const auto result{decode_regular_frames(impl, data.data(), frames_count, payloads.data())};
+                ASSERT_FALSE(result.ok());
+                EXPECT_EQ(bad_frame, result.valid_frames);
+                EXPECT_EQ(bad_frame * codec::regular_length, result.error_offset);
+                for(std::size_t frame_idx = 0; frame_idx < bad_frame; ++frame_idx) {
+                    EXPECT_EQ(static_cast<std::uint32_t>(0x01020304 * (frame_idx + 1)), payloads[frame_idx]);
+                }
+            });
+        }
+    }
+}
+
+TEST(bulk_decoder, RejectInitFrames)
+{
+    auto data{make_frames(frames_count)};
+    codec::store_init(data.data() + 9 * codec::regular_length, 1);
+    const auto result{decode_regular_frames(data.data(), frames_count, nullptr)};
+    EXPECT_EQ(9u, result.valid_frames);
+    EXPECT_EQ(9 * codec::regular_length, result.error_offset);
+}
+
+TEST(bulk_decoder, EmptyInput)
+{
+    EXPECT_TRUE(decode_regular_frames(nullptr, 0, nullptr).ok());
+}
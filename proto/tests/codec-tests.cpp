@@ -0,0 +1,58 @@
+#include "../src/codec.h"
+#include "../src/init-message.h"
+#include "../src/regular-message.h"
+
+#include <gtest/gtest.h>
+
+using namespace proto;
+
+namespace {
+
+    constexpr byte regular_bytes[]{'m', 's', 'g', '#', 0, 0, 0, 1, 0, 0, 4, 0};
+
+    static_assert(12 == codec::init_length, "init frame length");
+    static_assert(12 == codec::regular_length, "regular frame length");
+    static_assert(codec::check_header(regular_bytes, message_type::regular), "compile-time header check");
+    static_assert(1024 == codec::load_value(regular_bytes), "compile-time decoding");
+
+}
+
+TEST(codec, MessageLengths)
+{
+    EXPECT_EQ(base_message::message_length(), codec::header_length);
+    EXPECT_EQ(init_message::message_length(), codec::init_length);
+    EXPECT_EQ(regular_message::message_length(), codec::regular_length);
+}
+
+TEST(codec, EncodeAsMessages)
+{
+    const auto init_msg{make_init_message(42)};
+    const auto init_frame{codec::make_init_frame(42)};
+    EXPECT_EQ(init_msg.as_bytes(), bytes(init_frame.cbegin(), init_frame.cend()));
+
+    const auto regular_msg{make_message<regular_message>(1024)};
+    const auto regular_frame{codec::make_regular_frame(1024)};
+    EXPECT_EQ(regular_msg.as_bytes(), bytes(regular_frame.cbegin(), regular_frame.cend()));
+}
+
+TEST(codec, Decode)
+{
+    const auto frame{codec::make_regular_frame(0xdeadbeef)};
+    std::uint32_t payload{0};
+    ASSERT_TRUE(codec::decode(frame.data(), frame.size(), message_type::regular, payload));
+    EXPECT_EQ(0xdeadbeef, payload);
+    EXPECT_EQ(message_type::regular, codec::load_type(frame.data()));
+}
+
+TEST(codec, DecodeInvalid)
+{
+    std::uint32_t value{0};
+    const auto frame{codec::make_init_frame(7)};
+    EXPECT_FALSE(codec::decode(frame.data(), frame.size(), message_type::regular, value));
+    EXPECT_FALSE(codec::decode(frame.data(), frame.size() - 1, message_type::init, value));
+
+    auto broken{frame};
+    broken[3] = '$';
+    EXPECT_FALSE(codec::check_prefix(broken.data()));
+    EXPECT_FALSE(codec::decode(broken.data(), broken.size(), message_type::init, value));
+}
@@ -0,0 +1,168 @@
+#include "../src/stream-parser.h"
+#include "../src/init-message.h"
+#include "../src/regular-message.h"
+#include "../src/typed-message.h"
+#include "../src/batch-message.h"
+
+#include <gtest/gtest.h>
+
+using namespace proto;
+
+namespace {
+
+    struct parsed_frame {
+        message_type type;
+        value_type kind;
+        std::size_t length;
+        bytes value;
+    };
+
+    bytes make_stream()
+    {
+        bytes stream;
+        for(const auto &msg_bytes : {make_init_message(3).as_bytes(),
+                                     make_message<regular_message>(1024).as_bytes(),
+                                     make_string_message("variable length").as_bytes(),
+                                     make_blob_message(bytes{}).as_bytes(),
+                                     make_float64_message(0.5).as_bytes(),
+                                     make_message<regular_message>(7).as_bytes()}) {
+            stream.insert(stream.end(), msg_bytes.cbegin(), msg_bytes.cend());
+        }
+        return stream;
+    }
+
+    // Feeds the stream by pieces of 'piece_size' bytes
+    std::vector<parsed_frame> parse(stream_parser &parser, const bytes &stream, std::size_t piece_size)
+    {
+        std::vector<parsed_frame> frames;
+        for(std::size_t piece_pos = 0; piece_pos < stream.size(); piece_pos += piece_size) {
+            const std::size_t size{std::min(piece_size, stream.size() - piece_pos)};
+            std::size_t pos{0};
+            while(pos < size) {
+                pos += parser.feed(stream.data() + piece_pos + pos, size - pos);
+                if(parser.failed()) {
+                    return frames;
+                }
+                if(parser.complete()) {
+                    const auto &frame{parser.frame()};
+                    bytes value;
+                    if(nullptr != frame.value) {
+                        value.assign(frame.value, frame.value + frame.value_length);
+                    }
+                    frames.push_back({frame.type, frame.kind, frame.length, std::move(value)});
+                }
+            }
+        }
+        return frames;
+    }
+
+}
+
+TEST(stream_parser, ParseSplitFrames)
+{
+    const auto stream{make_stream()};
+    for(std::size_t piece_size = 1; piece_size <= stream.size(); ++piece_size) {
+        SCOPED_TRACE(piece_size);
+        stream_parser parser;
+        const auto frames{parse(parser, stream, piece_size)};
+        ASSERT_EQ(6u, frames.size());
+        EXPECT_FALSE(parser.failed());
+
+        EXPECT_EQ(message_type::init, frames[0].type);
+        EXPECT_EQ(3u, codec::load_uint32(frames[0].value.data()));
+        EXPECT_EQ(message_type::regular, frames[1].type);
+        EXPECT_EQ(codec::regular_length, frames[1].length);
+        EXPECT_EQ(1024u, codec::load_uint32(frames[1].value.data()));
+        EXPECT_EQ(message_type::typed, frames[2].type);
+        EXPECT_EQ(value_type::string, frames[2].kind);
+        EXPECT_EQ("variable length", std::string(frames[2].value.cbegin(), frames[2].value.cend()));
+        EXPECT_EQ(value_type::blob, frames[3].kind);
+        EXPECT_TRUE(frames[3].value.empty());
+        EXPECT_EQ(value_type::float64, frames[4].kind);
+        EXPECT_EQ(7u, codec::load_uint32(frames[5].value.data()));
+    }
+}
+
+TEST(stream_parser, ValueIsNotCopiedIfNotSplit)
+{
+    const auto msg{make_string_message("in place")};
+    stream_parser parser;
+    EXPECT_EQ(msg.as_bytes().size(), parser.feed(msg.as_bytes().data(), msg.as_bytes().size()));
+    ASSERT_TRUE(parser.complete());
+    EXPECT_EQ(msg.as_bytes().data() + codec::typed_header_length, parser.frame().value);
+}
+
+TEST(stream_parser, DoNotCollectValues)
+{
+    const auto msg{make_string_message("split value")};
+    const auto &data{msg.as_bytes()};
+    stream_parser parser{stream_parser::default_max_value_length, false};
+    const std::size_t half{codec::typed_header_length + 3};
+    EXPECT_EQ(half, parser.feed(data.data(), half));
+    EXPECT_EQ(half, parser.frame_pos());
+    EXPECT_EQ(data.size() - half, parser.feed(data.data() + half, data.size() - half));
+    ASSERT_TRUE(parser.complete());
+    EXPECT_EQ(nullptr, parser.frame().value);
+    EXPECT_EQ(data.size(), parser.frame().length);
+}
+
+TEST(stream_parser, RejectInvalidFrames)
+{
+    {
+        auto data{make_message<regular_message>(1).as_bytes()};
+        data[0] = 'M';
+        stream_parser parser;
+        parser.feed(data.data(), data.size());
+        EXPECT_TRUE(parser.failed());
+    }
+    {
+        bytes data(codec::header_length);
+        codec::store_header(data.data(), static_cast<message_type>(100));
+        stream_parser parser;
+        parser.feed(data.data(), data.size());
+        EXPECT_TRUE(parser.failed());
+    }
+    {
+        bytes data(codec::typed_header_length);
+        codec::store_typed_header(data.data(), value_type::uint64, 3);
+        stream_parser parser;
+        parser.feed(data.data(), data.size());
+        EXPECT_TRUE(parser.failed());
+    }
+}
+
+TEST(stream_parser, BoundValueLength)
+{
+    const auto msg{make_blob_message(bytes(100))};
+    stream_parser parser{99};
+    EXPECT_EQ(codec::typed_header_length, parser.feed(msg.as_bytes().data(), msg.as_bytes().size()));
+    EXPECT_TRUE(parser.failed());
+    EXPECT_FALSE(parser.error().empty());
+}
+
+TEST(stream_parser, ParseBatch)
+{
+    const auto msg{make_batch_message({1, 2, 3})};
+    const auto &data{msg.as_bytes()};
+    for(std::size_t split = 1; split < data.size(); ++split) {
+        stream_parser parser;
+        EXPECT_EQ(split, parser.feed(data.data(), split));
+        EXPECT_EQ(data.size() - split, parser.feed(data.data() + split, data.size() - split));
+        ASSERT_TRUE(parser.complete());
+        const auto &frame{parser.frame()};
+        EXPECT_EQ(message_type::batch, frame.type);
+        EXPECT_EQ(data.size(), frame.length);
+        ASSERT_EQ(3 * sizeof(std::uint32_t), frame.value_length);
+        EXPECT_EQ(3u, codec::load_uint32(frame.value + 2 * sizeof(std::uint32_t)));
+    }
+}
+
+TEST(stream_parser, BoundBatchLength)
+{
+    bytes data(codec::batch_header_length);
+    codec::store_header(data.data(), message_type::batch);
+    codec::store_uint32(data.data() + codec::header_length, 1000);
+    stream_parser parser{3999};
+    parser.feed(data.data(), data.size());
+    EXPECT_TRUE(parser.failed());
+}
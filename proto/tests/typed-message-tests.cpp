@@ -0,0 +1,65 @@
+#include "../src/typed-message.h"
+
+#include <gtest/gtest.h>
+
+using namespace proto;
+
+TEST(typed_message, MessageLength)
+{
+    ASSERT_EQ(base_message::message_length() + sizeof(value_type) + sizeof(std::uint32_t) + 5,
+              typed_message::message_length(5));
+}
+
+TEST(typed_message, SaveToAndLoadFromStream)
+{
+    {
+        typed_message msg{make_uint64_message(0x0102030405060708)};
+        typed_message new_msg{msg.as_bytes()};
+        new_msg.load();
+        EXPECT_EQ(message_type::typed, new_msg.type());
+        EXPECT_EQ(0x0102030405060708u, new_msg.as_uint64());
+    }
+    {
+        typed_message msg{make_int64_message(-42)};
+        typed_message new_msg{msg.as_bytes()};
+        new_msg.load();
+        EXPECT_EQ(-42, new_msg.as_int64());
+    }
+    {
+        typed_message msg{make_float64_message(2.5)};
+        typed_message new_msg{msg.as_bytes()};
+        new_msg.load();
+        EXPECT_DOUBLE_EQ(2.5, new_msg.as_float64());
+    }
+    {
+        typed_message msg{make_string_message("hello")};
+        EXPECT_EQ(typed_message::message_length(5), msg.as_bytes().size());
+        typed_message new_msg{msg.as_bytes()};
+        new_msg.load();
+        EXPECT_EQ("hello", new_msg.as_string());
+        EXPECT_THROW(new_msg.as_uint32(), std::runtime_error);
+    }
+    {
+        typed_message msg{make_blob_message(bytes{1, 2, 3})};
+        typed_message new_msg{msg.as_bytes()};
+        new_msg.load();
+        EXPECT_EQ(value_type::blob, new_msg.kind());
+        EXPECT_EQ((bytes{1, 2, 3}), new_msg.value());
+    }
+}
+
+TEST(typed_message, LoadFromInvalidStream)
+{
+    bytes data{make_string_message("hello").as_bytes()};
+    data.pop_back();
+    typed_message msg{std::move(data)};
+    EXPECT_THROW(msg.load(), std::runtime_error);
+}
+
+TEST(typed_message, FormatValue)
+{
+    const auto msg{make_uint32_message(7)};
+    EXPECT_EQ("7", format_value(msg.kind(), msg.value().data(), msg.value().size()));
+    const auto str_msg{make_string_message("abc")};
+    EXPECT_EQ("abc", format_value(str_msg.kind(), str_msg.value().data(), str_msg.value().size()));
+}
@@ -2,7 +2,7 @@
 
 void foreach_message_type(const std::function<void(message_type type)> &func)
 {
-    for(const auto type : {message_type::init, message_type::regular}) {
+    for(const auto type : {message_type::init, message_type::regular, message_type::typed, message_type::batch}) {
         func(type);
     }
 }
@@ -0,0 +1,74 @@
+#include "./tcp-receiver/tcp-receiver.h"
+
+#include <common/src/async-appender.h>
+
+#include <signal.h>
+#include <iostream>
+#include <boost/program_options.hpp>
+
+boost::program_options::variables_map parse_command_line(int argc, const char* const *argv)
+{
+    namespace po = boost::program_options;
+    po::variables_map vm;
+    po::options_description desc{"Options"};
+
+    try {
+        desc.add_options()
+        ("help,h", "Help message")
+        ("port,p", po::value<std::uint16_t>()->required(), "Port to listen")
+        ("compression,c", po::value<std::string>()->default_value("none"),
+         "Compression of received streams: none, lz4 or zstd")
+        ("mode,m", po::value<std::string>()->default_value("sink"), "sink - drop data, echo - send frames back")
+        ("latency,l", po::bool_switch(), "Measure latency by timestamps of Client --load --timestamps")
+        ("connections", po::value<std::size_t>()->default_value(0),
+         "Exit after this count of connections is closed, 0 - run until SIGINT or SIGTERM");
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    } catch (const po::required_option &ex) {
+        if(vm.count("help")) {
+            std::cout << desc << "\n" << std::endl;
+        } else {
+            throw ex;
+        }
+    }
+    return vm;
+}
+
+tcp_receiver::receiver_mode read_receiver_mode(const std::string &mode)
+{
+    if("sink" == mode) {
+        return tcp_receiver::receiver_mode::sink;
+    }
+    if("echo" == mode) {
+        return tcp_receiver::receiver_mode::echo;
+    }
+    throw std::invalid_argument{"Unknown receiver mode: " + mode};
+}
+
+int main(int argc, char **argv)
+{
+    signal(SIGPIPE, SIG_IGN);
+    const common::async_logging logging;
+    try {
+        const auto params{parse_command_line(argc, argv)};
+        if(params.count("help")) {
+            return 0;
+        }
+
+        const std::uint16_t port{params["port"].as<std::uint16_t>()};
+        tcp_receiver::receiver_options options;
+        options.compression = common::read_compression_type(params["compression"].as<std::string>());
+        options.mode = read_receiver_mode(params["mode"].as<std::string>());
+        options.latency = params["latency"].as<bool>();
+        options.expected_connections = params["connections"].as<std::size_t>();
+
+        tcp_receiver::tcp_receiver receiver{port, options};
+        receiver.start();
+        receiver.stop();
+    } catch (const std::exception &ex) {
+        std::cerr << "Receiver failed with error: " << ex.what() << std::endl;
+    } catch (...) {
+        std::cerr << "Receiver failed with unknown error" << std::endl;
+    }
+    return 0;
+}
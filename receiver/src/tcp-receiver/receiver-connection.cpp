@@ -0,0 +1,193 @@
+#include "receiver-connection.h"
+#include <proto/src/codec.h>
+
+#include <chrono>
+
+#include <log4cplus/loggingmacros.h>
+
+namespace tcp_receiver {
+
+    void receiver_stats::merge(const receiver_stats &other)
+    {
+        received_bytes += other.received_bytes;
+        decoded_bytes += other.decoded_bytes;
+        frames += other.frames;
+        payloads += other.payloads;
+        latency_ns.merge(other.latency_ns);
+    }
+
+    receiver_connection::receiver_connection(event_base *base,
+                                             evutil_socket_t socket,
+                                             const std::string &address,
+                                             const receiver_options &options,
+                                             close_op_t close_op,
+                                             log4cplus::Logger &logger)
+        : address_{address}
+        , options_{options}
+        , close_op_{std::move(close_op)}
+        , buffer_{common::bufferevent_ptr(bufferevent_socket_new(base, socket, BEV_OPT_CLOSE_ON_FREE))}
+        , decompressor_{common::make_decompressor(options.compression)}
+        , decoded_{common::evbuffer_ptr(evbuffer_new())}
+        , logger_{logger}
+    { }
+
+    void receiver_connection::start()
+    {
+        check_null(buffer_, "Invalid connection bufferevent");
+        check_null(decoded_, "Can not create buffer for decoded data");
+
+        const auto on_read = [](bufferevent */*bev*/, void *ctx)
+        {
+            auto *self{static_cast<receiver_connection *>(ctx)};
+            self->on_read();
+        };
+
+        const auto on_event = [](bufferevent */*bev*/, short what, void *ctx)
+        {
+            auto *self{static_cast<receiver_connection *>(ctx)};
+            self->on_next_event(what);
+        };
+
+        bufferevent_setcb(buffer_.get(), on_read, nullptr, on_event, this);
+        const short events = receiver_mode::echo == options_.mode ? EV_READ | EV_WRITE : EV_READ;
+        check_result_code(bufferevent_enable(buffer_.get(), events), "Can not enable connection");
+    }
+
+    void receiver_connection::stop()
+    {
+        if(buffer_) {
+            bufferevent_disable(buffer_.get(), EV_READ | EV_WRITE);
+            buffer_.reset();
+        }
+    }
+
+    const receiver_stats &receiver_connection::stats() const noexcept
+    {
+        return stats_;
+    }
+
+    void receiver_connection::on_read()
+    {
+        auto *input{bufferevent_get_input(buffer_.get())};
+        const std::size_t received{evbuffer_get_length(input)};
+        stats_.received_bytes += received;
+        try {
+            if(decompressor_) {
+                const int chunks_count{evbuffer_peek(input, -1, nullptr, nullptr, 0)};
+                chunks_.resize(static_cast<std::size_t>(chunks_count));
+                evbuffer_peek(input, -1, nullptr, chunks_.data(), chunks_count);
+                for(const auto &chunk : chunks_) {
+                    decompressor_->decompress(chunk.iov_base, chunk.iov_len, decoded_.get());
+                }
+                check_result_code(evbuffer_drain(input, received), "Can not drain received data");
+            } else {
+                check_result_code(evbuffer_add_buffer(decoded_.get(), input), "Can not move received data");
+            }
+            parse();
+        } catch (const std::exception &ex) {
+            LOG4CPLUS_ERROR(logger_, "Invalid stream from " << address_ << ": " << ex.what());
+            close();
+        }
+    }
+
+    void receiver_connection::parse()
+    {
+        auto *decoded{decoded_.get()};
+        const std::size_t decoded_length{evbuffer_get_length(decoded)};
+        stats_.decoded_bytes += decoded_length;
+
+        const int chunks_count{evbuffer_peek(decoded, -1, nullptr, nullptr, 0)};
+        chunks_.resize(static_cast<std::size_t>(chunks_count));
+        evbuffer_peek(decoded, -1, nullptr, chunks_.data(), chunks_count);
+        for(const auto &chunk : chunks_) {
+            const auto *data{static_cast<const proto::byte *>(chunk.iov_base)};
+            std::size_t left{chunk.iov_len};
+            while(0 != left) {
+                const std::size_t consumed{parser_.feed(data, left)};
+                if(parser_.failed()) {
+                    throw std::runtime_error{parser_.error()};
+                }
+                if(parser_.complete()) {
+                    on_frame();
+                }
+                data += consumed;
+                left -= consumed;
+            }
+        }
+        // split values are copied by the parser
+        if(receiver_mode::echo == options_.mode) {
+            check_result_code(bufferevent_write_buffer(buffer_.get(), decoded), "Can not echo parsed data");
+        } else {
+            check_result_code(evbuffer_drain(decoded, decoded_length), "Can not drain parsed data");
+        }
+    }
+
+    void receiver_connection::on_frame()
+    {
+        const auto &frame{parser_.frame()};
+        ++stats_.frames;
+        switch(frame.type) {
+        case proto::message_type::init:
+            if(nullptr != frame.value) {
+                LOG4CPLUS_INFO(logger_, "Client " << proto::codec::load_uint32(frame.value)
+                               << " is forwarded by " << address_);
+            }
+            break;
+        case proto::message_type::regular:
+            ++stats_.payloads;
+            break;
+        case proto::message_type::typed:
+            ++stats_.payloads;
+            if(options_.latency && proto::value_type::uint64 == frame.kind && nullptr != frame.value) {
+                record_latency(proto::codec::load_uint64(frame.value));
+            }
+            break;
+        case proto::message_type::batch:
+            stats_.payloads += frame.value_length / sizeof(std::uint32_t);
+            break;
+        }
+    }
+
+    void receiver_connection::record_latency(std::uint64_t sent_at_ns)
+    {
+        const auto now_ns{static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                         std::chrono::steady_clock::now().time_since_epoch()).count())};
+        // values that are not timestamps of this host are ignored
+        if(now_ns >= sent_at_ns) {
+            stats_.latency_ns.record(now_ns - sent_at_ns);
+        }
+    }
+
+    void receiver_connection::on_next_event(short what)
+    {
+        if(what & BEV_EVENT_EOF || what & BEV_EVENT_ERROR) {
+            close();
+        }
+    }
+
+    void receiver_connection::close()
+    {
+        LOG4CPLUS_INFO(logger_, "Connection from " << address_ << " is closed, received bytes: "
+                       << stats_.received_bytes << ", decoded bytes: " << stats_.decoded_bytes
+                       << ", frames: " << stats_.frames << ", payloads: " << stats_.payloads
+                       << (parser_.at_frame_start() ? "" : ", the last frame is incomplete"));
+        if(0 != stats_.latency_ns.count()) {
+            LOG4CPLUS_INFO(logger_, "Latency from " << address_ << " (us): p50 "
+                           << stats_.latency_ns.value_at_percentile(50) / 1000.0
+                           << ", p99 " << stats_.latency_ns.value_at_percentile(99) / 1000.0
+                           << ", p99.9 " << stats_.latency_ns.value_at_percentile(99.9) / 1000.0
+                           << ", max " << stats_.latency_ns.max() / 1000.0);
+        }
+        stop();
+        // destroys this object, must be the last call
+        close_op_();
+    }
+
+    void receiver_connection::check_result_code(int result_code, const std::string &error_msg)
+    {
+        if(-1 == result_code) {
+            throw std::runtime_error{error_msg};
+        }
+    }
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <common/src/types.h>
+#include <common/src/utils.h>
+#include <common/src/compression.h>
+#include <common/src/latency-histogram.h>
+#include <proto/src/stream-parser.h>
+
+#include <functional>
+#include <vector>
+
+namespace tcp_receiver {
+
+    enum class receiver_mode {
+        sink,   // received data is dropped
+        echo    // decompressed frames are sent back
+    };
+
+    struct receiver_options {
+        common::compression_type compression{common::compression_type::none};
+        receiver_mode mode{receiver_mode::sink};
+        // typed uint64 values are send times of the client in steady clock nanoseconds
+        bool latency{false};
+        // the receiver stops after this count of closed connections, 0 - never
+        std::size_t expected_connections{0};
+    };
+
+    // Counters of one accepted connection or of all of them
+    struct receiver_stats {
+        std::uint64_t received_bytes{0};
+        std::uint64_t decoded_bytes{0};
+        std::uint64_t frames{0};
+        std::uint64_t payloads{0};
+        // one-way latency from the client, if it is measured
+        common::latency_histogram latency_ns;
+
+        void merge(const receiver_stats &other);
+    };
+
+    /*
+     * Connection from the balancer. The stream is decompressed (if it is
+     * compressed) into a buffer of frames that is parsed as data arrives,
+     * counters are logged when the connection is closed. Latency is measured
+     * against the steady clock, so the client has to run on the same host.
+     */
+    class receiver_connection {
+        using close_op_t = std::function<void()>;
+
+    public:
+        receiver_connection(event_base *base,
+                            evutil_socket_t socket,
+                            const std::string &address,
+                            const receiver_options &options,
+                            close_op_t close_op,
+                            log4cplus::Logger &logger);
+
+    public:
+        void start();
+        void stop();
+        const receiver_stats &stats() const noexcept;
+
+    private:
+        void on_read();
+        void on_next_event(short what);
+        void parse();
+        void on_frame();
+        void record_latency(std::uint64_t sent_at_ns);
+        void close();
+        void check_result_code(int result_code, const std::string &error_msg);
+
+        template<typename t, typename deleter_t>
+        void check_null(const std::unique_ptr<t, deleter_t> &ptr, const std::string &error_msg)
+        {
+            if(!ptr) {
+                throw std::runtime_error{error_msg};
+            }
+        }
+
+    private:
+        const std::string address_;
+        const receiver_options &options_;
+        const close_op_t close_op_;
+        common::bufferevent_ptr buffer_;
+        std::unique_ptr<common::decompressor> decompressor_;
+        common::evbuffer_ptr decoded_;
+        proto::stream_parser parser_;
+        std::vector<evbuffer_iovec> chunks_;
+        receiver_stats stats_;
+        log4cplus::Logger &logger_;
+    };
+
+}
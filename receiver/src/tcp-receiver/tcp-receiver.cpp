@@ -0,0 +1,133 @@
+#include "tcp-receiver.h"
+#include <common/src/utils.h>
+
+#include <signal.h>
+#include <iostream>
+#include <log4cplus/loggingmacros.h>
+
+namespace tcp_receiver {
+
+    tcp_receiver::tcp_receiver(std::uint16_t port, const receiver_options &options)
+        : port_{port}
+        , options_{options}
+        , logger_{common::make_logger("tcp_receiver")}
+    { }
+
+    void tcp_receiver::start()
+    {
+        LOG4CPLUS_INFO(logger_, "Start receiver on port: " << port_
+                       << ", compression: " << common::compression_name(options_.compression)
+                       << (receiver_mode::echo == options_.mode ? ", echo" : ""));
+
+        eb_ = common::event_base_ptr(event_base_new());
+        check_null(eb_, "Can not create new event_base");
+
+        const sockaddr_in sock{common::make_sockaddr(INADDR_ANY, port_)};
+
+        const auto accept_conn_cb{
+            [] (evconnlistener */*listener*/, evutil_socket_t socket, sockaddr *address, int /*socklen*/, void *ctx) {
+                auto self{static_cast<tcp_receiver*>(ctx)};
+                self->start_accept(socket, common::address_from_sockaddr(address));
+            }
+        };
+
+        listener_ = common::listener_ptr(
+                    evconnlistener_new_bind(eb_.get(), accept_conn_cb, this, LEV_OPT_CLOSE_ON_FREE|LEV_OPT_REUSEABLE,
+                                            -1, reinterpret_cast<const sockaddr*>(&sock), sizeof(sock))
+                    );
+        check_null(listener_, "Can not create new listener");
+
+        const auto on_signal = [](evutil_socket_t /*signal*/, short /*what*/, void *ctx)
+        {
+            auto *self{static_cast<tcp_receiver *>(ctx)};
+            event_base_loopbreak(self->eb_.get());
+        };
+        sigint_event_ = common::event_ptr(evsignal_new(eb_.get(), SIGINT, on_signal, this));
+        check_null(sigint_event_, "Can not create SIGINT handler");
+        check_result_code(evsignal_add(sigint_event_.get(), nullptr), "Can not add SIGINT handler");
+        sigterm_event_ = common::event_ptr(evsignal_new(eb_.get(), SIGTERM, on_signal, this));
+        check_null(sigterm_event_, "Can not create SIGTERM handler");
+        check_result_code(evsignal_add(sigterm_event_.get(), nullptr), "Can not add SIGTERM handler");
+
+        check_result_code(event_base_dispatch(eb_.get()), "Can not run event loop");
+        print_summary();
+    }
+
+    void tcp_receiver::stop()
+    {
+        if(listener_) {
+            evconnlistener_disable(listener_.get());
+            listener_.reset();
+        }
+
+        for(const auto &connection : connections_) {
+            connection->stop();
+        }
+        connections_.clear();
+        sigint_event_.reset();
+        sigterm_event_.reset();
+
+        if(eb_) {
+            event_base_loopbreak(eb_.get());
+            eb_.reset();
+        }
+    }
+
+    void tcp_receiver::start_accept(evutil_socket_t socket, const std::string &address)
+    {
+        LOG4CPLUS_INFO(logger_, "New connection was accepted, address: " << address);
+        const auto connection_it{connections_.emplace(connections_.end())};
+        const auto close_op{[this, connection_it]() {
+            on_connection_closed((*connection_it)->stats());
+            connections_.erase(connection_it);
+        }};
+        *connection_it = std::make_unique<receiver_connection>(eb_.get(), socket, address, options_,
+                                                               close_op, logger_);
+        try {
+            (*connection_it)->start();
+        } catch (const std::exception &ex) {
+            LOG4CPLUS_ERROR(logger_, ex.what());
+            connections_.erase(connection_it);
+        }
+    }
+
+    void tcp_receiver::on_connection_closed(const receiver_stats &stats)
+    {
+        total_.merge(stats);
+        ++closed_connections_;
+        if(0 != options_.expected_connections && closed_connections_ >= options_.expected_connections) {
+            event_base_loopbreak(eb_.get());
+        }
+    }
+
+    void tcp_receiver::print_summary() const
+    {
+        std::cout << "Connections: " << closed_connections_ << " closed, " << connections_.size() << " open" << std::endl
+                  << "Received " << total_.received_bytes << " byte(s), decoded " << total_.decoded_bytes
+                  << " byte(s), frames: " << total_.frames << ", payloads: " << total_.payloads << std::endl;
+        const auto &latency{total_.latency_ns};
+        if(0 != latency.count()) {
+            std::cout << "Latency (us) of " << latency.count() << " message(s): p50 "
+                      << latency.value_at_percentile(50) / 1000.0
+                      << ", p99 " << latency.value_at_percentile(99) / 1000.0
+                      << ", p99.9 " << latency.value_at_percentile(99.9) / 1000.0
+                      << ", max " << latency.max() / 1000.0
+                      << ", mean " << latency.mean() / 1000.0 << std::endl;
+        }
+    }
+
+    void tcp_receiver::check_result_code(int result_code, const std::string &error_msg)
+    {
+        if(-1 == result_code) {
+            log_error_stop_and_throw(error_msg);
+        }
+    }
+
+    void tcp_receiver::log_error_stop_and_throw (const std::string &error_msg)
+    {
+        LOG4CPLUS_ERROR(logger_, error_msg);
+        stop();
+        throw std::runtime_error{error_msg};
+    }
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "receiver-connection.h"
+#include <common/src/types.h>
+
+#include <list>
+#include <memory>
+
+namespace tcp_receiver {
+
+    /*
+     * Sink or echo backend for tests: accepts balancer connections, decompresses
+     * their streams and parses the frames, see receiver_connection. The loop runs
+     * until SIGINT or SIGTERM or until the expected connections are closed,
+     * then totals of all connections are printed.
+     */
+    class tcp_receiver {
+    public:
+        tcp_receiver(std::uint16_t port, const receiver_options &options);
+        void start();
+        void stop();
+
+    private:
+        void start_accept(evutil_socket_t socket, const std::string &address);
+        void on_connection_closed(const receiver_stats &stats);
+        void print_summary() const;
+
+        template<typename t, typename deleter_t>
+        void check_null(const std::unique_ptr<t, deleter_t> &ptr, const std::string &error_msg)
+        {
+            if(!ptr) {
+                log_error_stop_and_throw(error_msg);
+            }
+        }
+
+        void check_result_code(int result_code, const std::string &error_msg);
+        void log_error_stop_and_throw(const std::string &error_msg);
+
+    private:
+        const std::uint16_t port_;
+        const receiver_options options_;
+        log4cplus::Logger logger_;
+        common::event_base_ptr eb_;
+        common::listener_ptr listener_;
+        common::event_ptr sigint_event_;
+        common::event_ptr sigterm_event_;
+        receiver_stats total_;
+        std::size_t closed_connections_{0};
+        std::list<std::unique_ptr<receiver_connection>> connections_;
+    };
+
+}